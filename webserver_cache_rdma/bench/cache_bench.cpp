@@ -0,0 +1,116 @@
+// Cache hits from N threads at once, each thread drawing keys from a hot
+// set that fits in the cache plus a few misses that it then puts. Compares
+// the single-lock design LRUCache had before sharding (one shard, LRU, an
+// exclusive lock on every hit) with the sharded cache, and both with SIEVE,
+// whose hits take the shard lock shared. Prints million lookups per second.
+//
+//   cache_bench [milliseconds per run] [threads...]
+#include "../src/headers/cache/lru_cache.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kHotKeys = 4096;
+constexpr std::size_t kBodyBytes = 1024;
+constexpr unsigned kMissPercent = 5;
+
+struct Design {
+  const char* label;
+  std::size_t shards;
+  const char* policy;
+};
+
+constexpr Design kDesigns[] = {
+  {"single lock (lru, 1 shard)", 1, "lru"},
+  {"sharded lru, 16 shards", 16, "lru"},
+  {"sieve, 1 shard", 1, "sieve"},
+  {"sieve, 16 shards", 16, "sieve"},
+};
+
+std::vector<std::string> make_keys(std::size_t n, const char* prefix) {
+  std::vector<std::string> keys;
+  keys.reserve(n);
+  for (std::size_t i = 0; i < n; ++i) keys.push_back(prefix + std::to_string(i) + ".html");
+  return keys;
+}
+
+double mops(const Design& d, unsigned threads, int millis, const std::vector<std::string>& hot,
+            const std::vector<std::string>& cold) {
+  // Room for the hot set with some slack in every shard, so misses evict
+  // mostly cold entries.
+  LRUCache cache(kHotKeys * kBodyBytes * 2, d.shards, d.policy);
+  LRUCache::Entry e;
+  e.body = std::make_shared<std::vector<uint8_t>>(kBodyBytes, 'x');
+  e.size = kBodyBytes;
+  e.etag = "\"bench\"";
+  for (const auto& k : hot) cache.put(k, e);
+
+  std::atomic<bool> go{false}, stop{false};
+  std::atomic<unsigned long long> total{0};
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; ++t) {
+    pool.emplace_back([&, t] {
+      std::uint32_t seed = 2463534242u + t * 7919u;
+      LRUCache::Entry out;
+      unsigned long long n = 0;
+      while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+      while (!stop.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < 256; ++i) {
+          seed ^= seed << 13;
+          seed ^= seed >> 17;
+          seed ^= seed << 5;
+          if (seed % 100 < kMissPercent) {
+            const std::string& k = cold[seed % cold.size()];
+            if (!cache.get(k, out)) cache.put(k, e);
+          } else {
+            cache.get(hot[seed % hot.size()], out);
+          }
+        }
+        n += 256;
+      }
+      total.fetch_add(n, std::memory_order_relaxed);
+    });
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+  stop.store(true, std::memory_order_relaxed);
+  for (auto& th : pool) th.join();
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return static_cast<double>(total.load()) / secs / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int millis = argc > 1 ? std::atoi(argv[1]) : 300;
+  std::vector<unsigned> thread_counts;
+  for (int i = 2; i < argc; ++i) thread_counts.push_back(static_cast<unsigned>(std::atoi(argv[i])));
+  if (thread_counts.empty()) thread_counts = {1, 2, 4, 8, 16, 32, 64};
+
+  const auto hot = make_keys(kHotKeys, "/hot/");
+  const auto cold = make_keys(kHotKeys * 16, "/cold/");
+  std::printf("%zu hot keys of %zu bytes, %u%% misses, %d ms per run, %u hardware threads\n", kHotKeys, kBodyBytes,
+              kMissPercent, millis, std::thread::hardware_concurrency());
+  std::printf("%-28s", "Mlookups/s        threads:");
+  for (unsigned t : thread_counts) std::printf("%8u", t);
+  std::printf("\n");
+  for (const Design& d : kDesigns) {
+    std::printf("%-28s", d.label);
+    for (unsigned t : thread_counts) {
+      std::printf("%8.2f", mops(d, t, millis, hot, cold));
+      std::fflush(stdout);
+    }
+    std::printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,103 @@
+// What a request costs in metrics, from 1 to 64 threads: three counter
+// updates (requests_total, responses_2xx, bytes_served), first as adjacent
+// std::atomics in one struct, as Metrics held them before per-thread
+// counters, then as the Metrics Counters, then with a latency histogram
+// record on top. Prints million requests per second over all threads.
+//
+//   metrics_bench [milliseconds per run] [threads...]
+#include "../src/headers/util/metrics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct SharedCounters {
+  std::atomic<unsigned long long> requests_total{0};
+  std::atomic<unsigned long long> responses_2xx{0};
+  std::atomic<unsigned long long> bytes_served{0};
+};
+
+SharedCounters g_shared;
+
+void shared_atomics(unsigned long long i) {
+  g_shared.requests_total.fetch_add(1, std::memory_order_relaxed);
+  g_shared.responses_2xx.fetch_add(1, std::memory_order_relaxed);
+  g_shared.bytes_served.fetch_add(1024 + (i & 255), std::memory_order_relaxed);
+}
+
+void counters(unsigned long long i) {
+  auto& m = Metrics::instance();
+  m.requests_total.fetch_add(1, std::memory_order_relaxed);
+  m.responses_2xx.fetch_add(1, std::memory_order_relaxed);
+  m.bytes_served.fetch_add(1024 + (i & 255), std::memory_order_relaxed);
+}
+
+void counters_and_histogram(unsigned long long i) {
+  counters(i);
+  Metrics::instance().http_ttfb[Metrics::http_series(true, "GET", 200)].record(20 + (i & 1023));
+}
+
+template <class F>
+double mops(unsigned threads, int millis, F body) {
+  std::atomic<bool> go{false}, stop{false};
+  std::atomic<unsigned long long> total{0};
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < threads; ++t) {
+    pool.emplace_back([&] {
+      unsigned long long n = 0;
+      while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+      while (!stop.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < 1024; ++i) body(n + static_cast<unsigned long long>(i));
+        n += 1024;
+      }
+      total.fetch_add(n, std::memory_order_relaxed);
+    });
+  }
+  const auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
+  std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+  stop.store(true, std::memory_order_relaxed);
+  for (auto& th : pool) th.join();
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return static_cast<double>(total.load()) / secs / 1e6;
+}
+
+template <class F>
+void row(const char* label, const std::vector<unsigned>& thread_counts, int millis, F body) {
+  std::printf("%-26s", label);
+  for (unsigned t : thread_counts) {
+    std::printf("%8.1f", mops(t, millis, body));
+    std::fflush(stdout);
+  }
+  std::printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  const int millis = argc > 1 ? std::atoi(argv[1]) : 300;
+  std::vector<unsigned> thread_counts;
+  for (int i = 2; i < argc; ++i) thread_counts.push_back(static_cast<unsigned>(std::atoi(argv[i])));
+  if (thread_counts.empty()) thread_counts = {1, 2, 4, 8, 16, 32, 64};
+
+  std::printf("%d ms per run, %u hardware threads\n", millis, std::thread::hardware_concurrency());
+  std::printf("%-26s", "Mrequests/s      threads:");
+  for (unsigned t : thread_counts) std::printf("%8u", t);
+  std::printf("\n");
+  row("shared std::atomic", thread_counts, millis, shared_atomics);
+  row("per-thread Counter", thread_counts, millis, counters);
+  row("Counter + Histogram", thread_counts, millis, counters_and_histogram);
+
+  // Every thread above added to the same Metrics; the sums must agree.
+  const auto& m = Metrics::instance();
+  if (m.requests_total.load() != m.responses_2xx.load()) {
+    std::fprintf(stderr, "counter sums disagree\n");
+    return 1;
+  }
+  return 0;
+}
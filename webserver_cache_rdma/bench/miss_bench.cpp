@@ -0,0 +1,157 @@
+// The cache-miss read path on its own: requesters that each keep one read
+// in flight, opening the next file as the last one completes, as parked
+// sessions do. Files are dropped from the page cache after every read
+// (POSIX_FADV_DONTNEED) so each read goes to the disk; pass --warm to
+// leave them cached. Compares the loader pool at a few sizes and, with
+// --io-uring (build with ENABLE_IO_URING=ON), the io_uring reader. Prints
+// thousand reads per second. The files live in $TMPDIR (default /var/tmp);
+// on tmpfs every read is warm whatever the flag says.
+//
+//   miss_bench [--io-uring] [--warm] [milliseconds per run] [in flight...]
+#include "../src/headers/fs/file_load_pool.hpp"
+#include "../src/headers/fs/uring_reader.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kFiles = 512;
+constexpr std::size_t kFileBytes = 64 * 1024;
+
+struct Requesters {
+  AsyncFileReader& reader;
+  const std::vector<std::string>& files;
+  bool cold;
+  std::atomic<bool> stop{false};
+  std::atomic<unsigned> next{0};
+  std::atomic<unsigned> live{0};
+  std::atomic<unsigned long long> reads{0};
+
+  void issue() {
+    FileOpenResult opened = open_file(files[next.fetch_add(1, std::memory_order_relaxed) % files.size()]);
+    auto file = opened.file;
+    reader.read(std::move(opened), [this, file](FileReadResult fr) {
+      if (cold && file) ::posix_fadvise(file->fd(), 0, 0, POSIX_FADV_DONTNEED);
+      if (fr.ok) reads.fetch_add(1, std::memory_order_relaxed);
+      if (stop.load(std::memory_order_relaxed)) {
+        live.fetch_sub(1, std::memory_order_release);
+        return;
+      }
+      issue();
+    });
+  }
+};
+
+double kreads(AsyncFileReader& reader, unsigned in_flight, int millis, const std::vector<std::string>& files,
+              bool cold) {
+  Requesters r{reader, files, cold};
+  r.live.store(in_flight);
+  const auto start = std::chrono::steady_clock::now();
+  for (unsigned i = 0; i < in_flight; ++i) r.issue();
+  std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+  r.stop.store(true, std::memory_order_relaxed);
+  const double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  const unsigned long long reads = r.reads.load(std::memory_order_relaxed);
+  while (r.live.load(std::memory_order_acquire) > 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  return static_cast<double>(reads) / secs / 1e3;
+}
+
+struct Reader {
+  std::string label;
+  std::function<std::shared_ptr<AsyncFileReader>()> make;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+  bool use_uring = false;
+  bool cold = true;
+  std::vector<int> numbers;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--io-uring") == 0) use_uring = true;
+    else if (std::strcmp(argv[i], "--warm") == 0) cold = false;
+    else numbers.push_back(std::atoi(argv[i]));
+  }
+  const int millis = numbers.empty() ? 300 : numbers[0];
+  std::vector<unsigned> depths;
+  for (std::size_t i = 1; i < numbers.size(); ++i) depths.push_back(static_cast<unsigned>(numbers[i]));
+  if (depths.empty()) depths = {1, 4, 16, 64, 256};
+
+  const char* tmp = std::getenv("TMPDIR");
+  std::string dir = std::string(tmp && *tmp ? tmp : "/var/tmp") + "/miss_bench.XXXXXX";
+  if (!::mkdtemp(dir.data())) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  std::vector<std::string> files;
+  const std::string body(kFileBytes, 'x');
+  for (std::size_t i = 0; i < kFiles; ++i) {
+    files.push_back(dir + "/f" + std::to_string(i));
+    std::ofstream(files.back(), std::ios::binary) << body;
+  }
+
+  boost::asio::io_context ioc(1);
+  auto guard = boost::asio::make_work_guard(ioc);
+  std::thread worker([&ioc] { ioc.run(); });
+
+  std::vector<Reader> readers = {
+    {"loader threads, 2", [] { return std::make_shared<FileLoadPool>(2, 1024); }},
+    {"loader threads, 8", [] { return std::make_shared<FileLoadPool>(8, 1024); }},
+    {"loader threads, 32", [] { return std::make_shared<FileLoadPool>(32, 1024); }},
+  };
+  if (use_uring) {
+    if (!io_uring_available()) std::fprintf(stderr, "--io-uring ignored: built without ENABLE_IO_URING\n");
+    else {
+      readers.push_back({"io_uring, 256 entries", [&ioc]() -> std::shared_ptr<AsyncFileReader> {
+        std::string err;
+        auto r = UringReader::create(ioc, 256, err);
+        if (!r) std::fprintf(stderr, "io_uring unavailable: %s\n", err.c_str());
+        return r;
+      }});
+    }
+  }
+
+  std::printf("%zu files of %zu KiB in %s, %s, %d ms per run, %u hardware threads\n", kFiles, kFileBytes / 1024,
+              dir.c_str(), cold ? "dropped from the page cache after each read" : "warm", millis,
+              std::thread::hardware_concurrency());
+  std::printf("%-28s", "Kreads/s        in flight:");
+  for (unsigned d : depths) std::printf("%8u", d);
+  std::printf("\n");
+  for (const Reader& r : readers) {
+    auto reader = r.make();
+    if (!reader) continue;
+    std::printf("%-28s", r.label.c_str());
+    for (unsigned d : depths) {
+      std::printf("%8.1f", kreads(*reader, d, millis, files, cold));
+      std::fflush(stdout);
+    }
+    std::printf("\n");
+    // On the thread that runs its completions, which may still be
+    // finishing the last batch.
+    std::promise<void> gone;
+    boost::asio::post(ioc, [&reader, &gone] {
+      reader.reset();
+      gone.set_value();
+    });
+    gone.get_future().wait();
+  }
+
+  guard.reset();
+  ioc.stop();
+  worker.join();
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,88 @@
+#include "../../headers/cache/compression.hpp"
+
+#ifdef ENABLE_CACHE_COMPRESSION
+#include <zlib.h>
+#endif
+
+bool cache_compression_available() {
+#ifdef ENABLE_CACHE_COMPRESSION
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool is_compressible_type(const std::string& mime) {
+  return mime.compare(0, 5, "text/") == 0 ||
+         mime.find("javascript") != std::string::npos ||
+         mime.find("json") != std::string::npos ||
+         mime.find("xml") != std::string::npos;
+}
+
+#ifdef ENABLE_CACHE_COMPRESSION
+
+// windowBits 15 + 16 selects the gzip wrapper, so the stored bytes are a
+// valid "Content-Encoding: gzip" body.
+static constexpr int kGzipWindowBits = 15 + 16;
+
+bool compress_entry(const LRUCache::Entry& e, LRUCache::Entry& out) {
+  if (!e.body || e.body->empty() || e.gzip) return false;
+
+  z_stream zs{};
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, kGzipWindowBits, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    return false;
+  }
+
+  const auto& in = *e.body;
+  auto buf = std::make_shared<std::vector<uint8_t>>(deflateBound(&zs, static_cast<uLong>(in.size())));
+  zs.next_in = const_cast<Bytef*>(in.data());
+  zs.avail_in = static_cast<uInt>(in.size());
+  zs.next_out = buf->data();
+  zs.avail_out = static_cast<uInt>(buf->size());
+  int rc = deflate(&zs, Z_FINISH);
+  const auto produced = static_cast<std::size_t>(zs.total_out);
+  deflateEnd(&zs);
+  if (rc != Z_STREAM_END) return false;
+
+  if (produced > in.size() - in.size() / 8) return false;
+  buf->resize(produced);
+  buf->shrink_to_fit();
+
+  out = e;
+  out.body = std::move(buf);
+  out.gzip = true;
+  out.head.reset();
+  return true;
+}
+
+bool inflate_entry(LRUCache::Entry& e) {
+  if (!e.gzip) return true;
+  if (!e.body) return false;
+
+  z_stream zs{};
+  if (inflateInit2(&zs, kGzipWindowBits) != Z_OK) return false;
+
+  auto buf = std::make_shared<std::vector<uint8_t>>(e.size);
+  zs.next_in = e.body->data();
+  zs.avail_in = static_cast<uInt>(e.body->size());
+  zs.next_out = buf->data();
+  zs.avail_out = static_cast<uInt>(buf->size());
+  int rc = inflate(&zs, Z_FINISH);
+  const auto produced = static_cast<std::size_t>(zs.total_out);
+  inflateEnd(&zs);
+  if (rc != Z_STREAM_END || produced != e.size) return false;
+
+  e.body = std::move(buf);
+  e.gzip = false;
+  e.head.reset(); // rendered for the gzip form
+  e.head_304.reset();
+  return true;
+}
+
+#else
+
+bool compress_entry(const LRUCache::Entry&, LRUCache::Entry&) { return false; }
+
+bool inflate_entry(LRUCache::Entry& e) { return !e.gzip; }
+
+#endif
@@ -0,0 +1,171 @@
+#include "../../headers/cache/eviction_policy.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+void NodeList::push_front(PolicyNode* n) {
+  n->prev = nullptr;
+  n->next = head_;
+  if (head_) head_->prev = n;
+  head_ = n;
+  if (!tail_) tail_ = n;
+  bytes_ += n->charge;
+}
+
+void NodeList::remove(PolicyNode* n) {
+  if (n->prev) n->prev->next = n->next; else head_ = n->next;
+  if (n->next) n->next->prev = n->prev; else tail_ = n->prev;
+  n->prev = n->next = nullptr;
+  bytes_ -= n->charge;
+}
+
+std::unique_ptr<EvictionPolicy> make_eviction_policy(const std::string& name, std::size_t capacity_bytes) {
+  if (name == "lru") return std::make_unique<LruPolicy>();
+  if (name == "sieve") return std::make_unique<SievePolicy>();
+  if (name == "wtinylfu") return std::make_unique<WTinyLfuPolicy>(capacity_bytes);
+  if (name == "gdsf") return std::make_unique<GdsfPolicy>();
+  throw std::invalid_argument("unknown cache policy: " + name);
+}
+
+// ---- SIEVE ----
+
+void SievePolicy::on_insert(PolicyNode* n) {
+  n->visited.store(false, std::memory_order_relaxed);
+  list_.push_front(n);
+}
+
+void SievePolicy::on_erase(PolicyNode* n) {
+  if (hand_ == n) hand_ = n->prev;
+  list_.remove(n);
+}
+
+PolicyNode* SievePolicy::victim() {
+  PolicyNode* p = hand_ ? hand_ : list_.back();
+  if (!p) return nullptr;
+  // Terminates: every step clears a bit, so at most one full lap.
+  while (p->visited.exchange(false, std::memory_order_relaxed)) {
+    p = p->prev ? p->prev : list_.back();
+  }
+  hand_ = p;
+  return p;
+}
+
+// ---- W-TinyLFU ----
+
+FrequencySketch::FrequencySketch(std::size_t expected_items) {
+  std::size_t width = 1024;
+  while (width < expected_items) width <<= 1;
+  table_.assign(width * kRows, 0);
+  mask_ = width - 1;
+  sample_size_ = width * 10;
+}
+
+std::size_t FrequencySketch::index(std::size_t hash, int row) const {
+  static constexpr std::uint64_t kSeeds[kRows] = {
+    0x9E3779B97F4A7C15ull, 0xC2B2AE3D27D4EB4Full, 0x165667B19E3779F9ull, 0xD6E8FEB86659FD93ull};
+  std::uint64_t h = (static_cast<std::uint64_t>(hash) + kSeeds[row]) * kSeeds[(row + 1) % kRows];
+  h ^= h >> 32;
+  return static_cast<std::size_t>(row) * (mask_ + 1) + (static_cast<std::size_t>(h) & mask_);
+}
+
+void FrequencySketch::increment(std::size_t hash) {
+  bool added = false;
+  for (int r = 0; r < kRows; ++r) {
+    auto& c = table_[index(hash, r)];
+    if (c < kMax) { ++c; added = true; }
+  }
+  if (added && ++additions_ >= sample_size_) age();
+}
+
+std::uint32_t FrequencySketch::estimate(std::size_t hash) const {
+  std::uint8_t m = kMax;
+  for (int r = 0; r < kRows; ++r) m = std::min(m, table_[index(hash, r)]);
+  return m;
+}
+
+// Halving keeps the sketch tracking recent popularity rather than all time.
+void FrequencySketch::age() {
+  for (auto& c : table_) c >>= 1;
+  additions_ /= 2;
+}
+
+WTinyLfuPolicy::WTinyLfuPolicy(std::size_t capacity_bytes)
+  : window_capacity_(std::max<std::size_t>(capacity_bytes / 100, 1)),
+    // Sized for ~4 KiB average entries; collisions only make admission fuzzier.
+    sketch_(capacity_bytes / 4096) {}
+
+void WTinyLfuPolicy::on_insert(PolicyNode* n) {
+  n->queue = Window;
+  window_.push_front(n);
+}
+
+void WTinyLfuPolicy::on_hit(PolicyNode* n) {
+  auto& l = list_of(n);
+  l.remove(n);
+  l.push_front(n);
+}
+
+void WTinyLfuPolicy::on_erase(PolicyNode* n) {
+  list_of(n).remove(n);
+}
+
+PolicyNode* WTinyLfuPolicy::victim() {
+  // Drain the window into main while it is over budget; each window
+  // candidate either displaces main's LRU entry or is itself rejected.
+  while (window_.bytes() > window_capacity_ && !window_.empty()) {
+    PolicyNode* candidate = window_.back();
+    PolicyNode* incumbent = main_.back();
+    if (!incumbent) {
+      window_.remove(candidate);
+      candidate->queue = Main;
+      main_.push_front(candidate);
+      continue;
+    }
+    if (sketch_.estimate(candidate->hash) > sketch_.estimate(incumbent->hash)) {
+      window_.remove(candidate);
+      candidate->queue = Main;
+      main_.push_front(candidate);
+      return incumbent;
+    }
+    return candidate;
+  }
+  if (!main_.empty()) return main_.back();
+  return window_.back();
+}
+
+// ---- GDSF ----
+
+double GdsfPolicy::priority_of(const PolicyNode* n) const {
+  // +1 so zero-byte entries (segment manifests) still rank sensibly.
+  return inflation_ + static_cast<double>(n->freq) / static_cast<double>(n->charge + 1);
+}
+
+void GdsfPolicy::place(PolicyNode* n) {
+  n->priority = priority_of(n);
+  order_.emplace(n->priority, n);
+}
+
+void GdsfPolicy::on_insert(PolicyNode* n) {
+  n->freq = 1;
+  place(n);
+}
+
+void GdsfPolicy::on_hit(PolicyNode* n) {
+  // Re-keys the node in place: a hit allocates nothing.
+  auto node = order_.extract({n->priority, n});
+  ++n->freq;
+  n->priority = priority_of(n);
+  node.value().first = n->priority;
+  order_.insert(std::move(node));
+}
+
+void GdsfPolicy::on_erase(PolicyNode* n) {
+  order_.erase({n->priority, n});
+}
+
+PolicyNode* GdsfPolicy::victim() {
+  if (order_.empty()) return nullptr;
+  auto* n = order_.begin()->second;
+  inflation_ = n->priority;
+  return n;
+}
@@ -1,47 +1,185 @@
 #include "../../headers/cache/lru_cache.hpp"
+#include "../../headers/util/metrics.hpp"
 
 #include <mutex>
+#include <functional>
+
+LRUCache::LRUCache(std::size_t capacity_bytes, std::size_t shards, const std::string& policy)
+  : capacity_bytes_(capacity_bytes) {
+  if (shards == 0) shards = 1;
+  shards_.reserve(shards);
+  for (std::size_t i = 0; i < shards; ++i) {
+    auto s = std::make_unique<Shard>();
+    s->capacity_bytes = capacity_bytes / shards;
+    s->policy = make_eviction_policy(policy, s->capacity_bytes);
+    shards_.push_back(std::move(s));
+  }
+  Metrics::instance().cache_policy.store(shards_[0]->policy->name(), std::memory_order_relaxed);
+}
+
+LRUCache::Shard& LRUCache::shard_for(std::size_t hash) const {
+  if (shards_.size() == 1) return *shards_[0];
+  // Fibonacci mix so weak low bits of std::hash still spread, then map the
+  // top 32 bits onto [0, n) with a multiply instead of a modulo.
+  std::uint64_t h = static_cast<std::uint64_t>(hash) * 0x9E3779B97F4A7C15ull;
+  std::uint64_t idx = ((h >> 32) * static_cast<std::uint64_t>(shards_.size())) >> 32;
+  return *shards_[static_cast<std::size_t>(idx)];
+}
 
 bool LRUCache::get(const std::string& key, Entry& out) {
-  std::unique_lock lock(mtx_);
-  auto it = map_.find(key);
-  if (it == map_.end()) return false;
-  lru_.splice(lru_.begin(), lru_, it->second);
-  out = it->second->value;
+  auto& m = Metrics::instance();
+  const std::size_t hash = std::hash<std::string>{}(key);
+  Shard& s = shard_for(hash);
+
+  // Policies whose hits only flip an atomic (SIEVE) let readers share the lock.
+  if (s.policy->concurrent_hits()) {
+    std::shared_lock lock(s.mtx);
+    auto it = s.map.find(key);
+    if (it == s.map.end()) {
+      m.cache_lookup_misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    s.policy->on_hit(it->second.get());
+    out = it->second->value;
+  } else {
+    std::unique_lock lock(s.mtx);
+    s.policy->on_access(hash);
+    auto it = s.map.find(key);
+    if (it == s.map.end()) {
+      m.cache_lookup_misses.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    s.policy->on_hit(it->second.get());
+    out = it->second->value;
+  }
+  m.cache_lookup_hits.fetch_add(1, std::memory_order_relaxed);
+  m.cache_hit_bytes.fetch_add(charge(out), std::memory_order_relaxed);
   return true;
 }
 
 void LRUCache::put(const std::string& key, const Entry& e) {
-  std::unique_lock lock(mtx_);
-  auto it = map_.find(key);
-  if (it != map_.end()) {
-    used_bytes_ -= it->second->value.size;
-    it->second->value = e;
-    used_bytes_ += e.size;
-    lru_.splice(lru_.begin(), lru_, it->second);
-  } else {
-    lru_.push_front(Node{key, e});
-    map_[key] = lru_.begin();
-    used_bytes_ += e.size;
+  const std::size_t hash = std::hash<std::string>{}(key);
+  Shard& s = shard_for(hash);
+  std::unique_lock lock(s.mtx);
+  s.insert(key, hash, e);
+}
+
+std::uint64_t LRUCache::epoch(const std::string& key) const {
+  return shard_for(std::hash<std::string>{}(key)).epoch.load(std::memory_order_acquire);
+}
+
+bool LRUCache::put(const std::string& key, const Entry& e, std::uint64_t epoch) {
+  const std::size_t hash = std::hash<std::string>{}(key);
+  Shard& s = shard_for(hash);
+  std::unique_lock lock(s.mtx);
+  if (s.epoch.load(std::memory_order_relaxed) != epoch) {
+    Metrics::instance().cache_stale_loads.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  s.insert(key, hash, e);
+  return true;
+}
+
+void LRUCache::erase(const std::string& key) {
+  Shard& s = shard_for(std::hash<std::string>{}(key));
+  std::unique_lock lock(s.mtx);
+  s.epoch.fetch_add(1, std::memory_order_release);
+  auto it = s.map.find(key);
+  if (it == s.map.end()) return;
+  s.remove(it->second.get());
+}
+
+void LRUCache::erase_file(const std::string& key) {
+  Entry manifest;
+  {
+    Shard& s = shard_for(std::hash<std::string>{}(key));
+    std::unique_lock lock(s.mtx);
+    s.epoch.fetch_add(1, std::memory_order_release);
+    auto it = s.map.find(key);
+    if (it == s.map.end()) return;
+    manifest = it->second->value;
+    s.remove(it->second.get());
+  }
+  if (manifest.segment_size == 0) return;
+  const std::size_t segments = (manifest.size + manifest.segment_size - 1) / manifest.segment_size;
+  for (std::size_t i = 0; i < segments; ++i) erase(segment_key(key, i));
+}
+
+void LRUCache::erase_prefix(const std::string& prefix) {
+  for (auto& s : shards_) {
+    std::unique_lock lock(s->mtx);
+    s->epoch.fetch_add(1, std::memory_order_release);
+    std::vector<Node*> doomed;
+    for (auto& [key, node] : s->map) {
+      if (key.compare(0, prefix.size(), prefix) == 0) doomed.push_back(node.get());
+    }
+    for (auto* n : doomed) s->remove(n);
   }
+}
+
+void LRUCache::Shard::insert(const std::string& key, std::size_t hash, const Entry& e) {
+  auto it = map.find(key);
+  if (it != map.end()) {
+    // Replacement: re-insert so size-aware policies see the new charge.
+    remove(it->second.get());
+  }
+  auto node = std::make_unique<Node>();
+  node->key = key;
+  node->value = e;
+  node->hash = hash;
+  node->charge = charge(e);
+  Node* n = node.get();
+  map.emplace(key, std::move(node));
+  used_bytes += n->charge;
+  track(e, true);
+  policy->on_insert(n);
   evict_if_needed();
 }
 
-void LRUCache::evict_if_needed() {
-  while (used_bytes_ > capacity_bytes_ && !lru_.empty()) {
-    auto it = --lru_.end();
-    used_bytes_ -= it->value.size;
-    map_.erase(it->key);
-    lru_.erase(it);
+void LRUCache::Shard::remove(Node* n) {
+  policy->on_erase(n);
+  used_bytes -= n->charge;
+  track(n->value, false);
+  map.erase(map.find(n->key)); // destroys n
+}
+
+void LRUCache::Shard::evict_if_needed() {
+  while (used_bytes > capacity_bytes) {
+    auto* victim = static_cast<Node*>(policy->victim());
+    if (!victim) break;
+    remove(victim);
+    Metrics::instance().cache_evictions.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void LRUCache::track(const Entry& e, bool added) {
+  if (!e.gzip || !e.body) return;
+  auto& m = Metrics::instance();
+  if (added) {
+    m.cache_gzip_entries.fetch_add(1, std::memory_order_relaxed);
+    m.cache_gzip_stored_bytes.fetch_add(e.body->size(), std::memory_order_relaxed);
+    m.cache_gzip_original_bytes.fetch_add(e.size, std::memory_order_relaxed);
+  } else {
+    m.cache_gzip_entries.fetch_sub(1, std::memory_order_relaxed);
+    m.cache_gzip_stored_bytes.fetch_sub(e.body->size(), std::memory_order_relaxed);
+    m.cache_gzip_original_bytes.fetch_sub(e.size, std::memory_order_relaxed);
   }
 }
 
 std::size_t LRUCache::size_bytes() const {
-  std::shared_lock lock(mtx_);
-  return used_bytes_;
+  std::size_t total = 0;
+  for (const auto& s : shards_) {
+    std::shared_lock lock(s->mtx);
+    total += s->used_bytes;
+  }
+  return total;
 }
 
 std::size_t LRUCache::items() const {
-  std::shared_lock lock(mtx_);
-  return map_.size();
-}
\ No newline at end of file
+  std::size_t total = 0;
+  for (const auto& s : shards_) {
+    std::shared_lock lock(s->mtx);
+    total += s->map.size();
+  }
+  return total;
+}
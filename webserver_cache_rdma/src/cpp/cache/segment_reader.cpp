@@ -0,0 +1,159 @@
+#include "../../headers/cache/segment_reader.hpp"
+#include "../../headers/util/metrics.hpp"
+#include <algorithm>
+#include <cstring>
+
+SegmentReader::SegmentReader(std::shared_ptr<LRUCache> cache,
+                             std::shared_ptr<SingleFlight> flights,
+                             std::shared_ptr<AsyncFileReader> files,
+                             std::string key,
+                             std::string fs_path,
+                             LRUCache::Entry manifest,
+                             FileOpenResult opened)
+  : cache_(std::move(cache)),
+    flights_(std::move(flights)),
+    files_(std::move(files)),
+    key_(std::move(key)),
+    fs_path_(std::move(fs_path)),
+    manifest_(std::move(manifest)),
+    file_(std::move(opened)) {}
+
+bool SegmentReader::ensure_open(std::string& err) {
+  if (file_.ok) return true;
+  file_ = open_file(fs_path_);
+  if (!file_.ok) { err = file_.error; return false; }
+  if (!manifest_matches(manifest_, file_)) {
+    // The manifest is stale; drop it so the next request starts over.
+    cache_->erase_file(key_);
+    file_ = FileOpenResult{};
+    err = "File changed";
+    return false;
+  }
+  return true;
+}
+
+SegmentReader::Slice SegmentReader::slice(std::uint64_t offset, std::uint64_t max_len, BodyPart& out,
+                                          std::string& err) {
+  return resolve(offset, max_len, true, out, err);
+}
+
+SegmentReader::Slice SegmentReader::resolve(std::uint64_t offset, std::uint64_t max_len, bool allow_file,
+                                            BodyPart& out, std::string& err) {
+  const std::uint64_t seg = manifest_.segment_size;
+  if (seg == 0 || offset >= manifest_.size) { err = "Range outside file"; return Slice::failed; }
+
+  const std::size_t index = static_cast<std::size_t>(offset / seg);
+  const std::uint64_t seg_start = index * seg;
+  const std::size_t seg_len = static_cast<std::size_t>(std::min<std::uint64_t>(seg, manifest_.size - seg_start));
+  const std::uint64_t within = offset - seg_start;
+  const std::uint64_t len = std::min<std::uint64_t>(max_len, seg_len - within);
+
+  if (loaded_ && loaded_index_ == index) {
+    out = BodyPart::from_memory(loaded_, within, len);
+    return Slice::ready;
+  }
+  LRUCache::Entry e;
+  if (cache_->get(LRUCache::segment_key(key_, index), e) && e.etag == manifest_.etag && e.body &&
+      e.body->size() == seg_len) {
+    Metrics::instance().cache_segment_hits.fetch_add(1, std::memory_order_relaxed);
+    out = BodyPart::from_memory(e.body, within, len);
+    return Slice::ready;
+  }
+
+  if (!ensure_open(err)) return Slice::failed;
+  if (allow_file && seg_len > cache_->max_entry_bytes()) {
+    Metrics::instance().cache_segment_misses.fetch_add(1, std::memory_order_relaxed);
+    Metrics::instance().cache_miss_bytes.fetch_add(seg_len, std::memory_order_relaxed);
+    out = BodyPart::from_file(file_.file, offset, len);
+    return Slice::ready;
+  }
+  return Slice::missing;  // counted as a miss by load()
+}
+
+SegmentReader::Slice SegmentReader::copy(std::uint64_t offset, std::uint8_t* dst, std::size_t len,
+                                         std::size_t& copied, std::string& err) {
+  copied = 0;
+  while (copied < len) {
+    BodyPart piece;
+    const Slice s = resolve(offset + copied, len - copied, false, piece, err);
+    if (s != Slice::ready) return s;
+    const auto n = static_cast<std::size_t>(piece.length);
+    std::memcpy(dst + copied, piece.data->data() + piece.offset, n);
+    copied += n;
+  }
+  return Slice::ready;
+}
+
+void SegmentReader::load(std::uint64_t offset, std::function<void(const FlightResult&)> done) {
+  const std::uint64_t seg = manifest_.segment_size;
+  const std::size_t index = static_cast<std::size_t>(offset / seg);
+  const std::uint64_t seg_start = index * seg;
+  const std::size_t seg_len = static_cast<std::size_t>(std::min<std::uint64_t>(seg, manifest_.size - seg_start));
+  const std::string seg_key = LRUCache::segment_key(key_, index);
+  Metrics::instance().cache_segment_misses.fetch_add(1, std::memory_order_relaxed);
+  Metrics::instance().cache_miss_bytes.fetch_add(seg_len, std::memory_order_relaxed);
+
+  // Every reader waiting on the segment keeps it, leader or not.
+  auto self = shared_from_this();
+  auto finish = [self, index, done = std::move(done)](const FlightResult& loaded) {
+    if (!loaded.ok || self->keep(index, loaded)) {
+      done(loaded);
+      return;
+    }
+    FlightResult changed;
+    changed.error = "File changed";
+    done(changed);
+  };
+  if (!flights_->join(seg_key, finish)) return;
+
+  FlightResult failed;
+  const std::uint64_t epoch = cache_->epoch(seg_key);
+  if (!ensure_open(failed.error)) {
+    flights_->complete(seg_key, failed);
+    finish(failed);
+    return;
+  }
+  auto on_read = [self, seg_key, epoch, finish](FileReadResult fr) {
+    FlightResult loaded;
+    loaded.error = std::move(fr.error);
+    loaded.overloaded = fr.overloaded;
+    if (fr.ok) {
+      LRUCache::Entry& ne = loaded.entry;
+      ne.body = std::make_shared<std::vector<uint8_t>>(std::move(fr.data));
+      ne.size = ne.body->size();
+      ne.last_modified = self->manifest_.last_modified;
+      ne.etag = self->manifest_.etag;
+      self->cache_->put(seg_key, ne, epoch);
+      loaded.ok = true;
+    }
+    self->flights_->complete(seg_key, loaded);
+    finish(loaded);
+  };
+  if (files_) files_->read_range(file_, seg_start, seg_len, std::move(on_read));
+  else on_read(read_file(file_, seg_start, seg_len));
+}
+
+// A segment another reader loaded is only kept if it is of the same file.
+bool SegmentReader::keep(std::size_t index, const FlightResult& loaded) {
+  const std::uint64_t seg_start = index * manifest_.segment_size;
+  const std::uint64_t seg_len = std::min<std::uint64_t>(manifest_.segment_size, manifest_.size - seg_start);
+  if (loaded.entry.etag != manifest_.etag || !loaded.entry.body || loaded.entry.body->size() != seg_len) {
+    return false;
+  }
+  loaded_ = loaded.entry.body;
+  loaded_index_ = index;
+  return true;
+}
+
+bool manifest_matches(const LRUCache::Entry& manifest, const FileOpenResult& opened) {
+  return opened.ok && opened.size == manifest.size && opened.last_modified == manifest.last_modified;
+}
+
+LRUCache::Entry make_segment_manifest(std::size_t size, std::time_t mtime, std::size_t segment_size) {
+  LRUCache::Entry m;
+  m.size = size;
+  m.last_modified = mtime;
+  m.etag = make_etag(size, mtime);
+  m.segment_size = segment_size;
+  return m;
+}
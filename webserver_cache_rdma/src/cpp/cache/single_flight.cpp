@@ -0,0 +1,24 @@
+#include "../../headers/cache/single_flight.hpp"
+#include "../../headers/util/metrics.hpp"
+
+bool SingleFlight::join(const std::string& key, Waiter waiter) {
+  std::lock_guard<std::mutex> lock(mtx_);
+  auto [it, leader] = inflight_.try_emplace(key);
+  if (!leader) {
+    it->second.push_back(std::move(waiter));
+    Metrics::instance().cache_coalesced_loads.fetch_add(1, std::memory_order_relaxed);
+  }
+  return leader;
+}
+
+void SingleFlight::complete(const std::string& key, const FlightResult& result) {
+  std::vector<Waiter> waiters;
+  {
+    std::lock_guard<std::mutex> lock(mtx_);
+    auto it = inflight_.find(key);
+    if (it == inflight_.end()) return;
+    waiters = std::move(it->second);
+    inflight_.erase(it);
+  }
+  for (auto& w : waiters) w(result);
+}
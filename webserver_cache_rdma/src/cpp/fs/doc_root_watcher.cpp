@@ -0,0 +1,153 @@
+#include "../../headers/fs/doc_root_watcher.hpp"
+#include "../../headers/cache/lru_cache.hpp"
+#include "../../headers/http/encoding.hpp"
+#include "../../headers/util/logging.hpp"
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+DocRootWatcher::DocRootWatcher(boost::asio::io_context& ioc, const std::string& doc_root)
+  : root_(fs::weakly_canonical(fs::path(doc_root)).string()),
+    stream_(ioc) {}
+
+DocRootWatcher::~DocRootWatcher() {
+  boost::system::error_code ec;
+  stream_.close(ec);
+}
+
+#if defined(__linux__)
+
+static constexpr std::uint32_t kDirMask =
+  IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO |
+  IN_DELETE_SELF | IN_ONLYDIR;
+
+bool DocRootWatcher::start() {
+  int fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0) {
+    log_warn("inotify unavailable; cached files will not be revalidated");
+    return false;
+  }
+  stream_.assign(fd);
+  add_tree(root_, "");
+  do_read();
+  return true;
+}
+
+void DocRootWatcher::add_tree(const std::string& fs_dir, const std::string& url_dir) {
+  int wd = ::inotify_add_watch(stream_.native_handle(), fs_dir.c_str(), kDirMask);
+  if (wd < 0) {
+    log_warn("cannot watch {}: {}", fs_dir, std::strerror(errno));
+    return;
+  }
+  dirs_[wd] = url_dir;
+
+  std::error_code ec;
+  for (fs::directory_iterator it(fs_dir, ec), end; !ec && it != end; it.increment(ec)) {
+    std::error_code type_ec;
+    if (it->is_directory(type_ec) && !it->is_symlink(type_ec)) {
+      const std::string name = it->path().filename().string();
+      add_tree(it->path().string(), url_dir + "/" + name);
+    }
+  }
+}
+
+void DocRootWatcher::forget_tree(const std::string& url_dir) {
+  for (auto it = dirs_.begin(); it != dirs_.end();) {
+    const std::string& d = it->second;
+    if (d == url_dir || d.compare(0, url_dir.size() + 1, url_dir + "/") == 0) {
+      ::inotify_rm_watch(stream_.native_handle(), it->first);
+      it = dirs_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void DocRootWatcher::do_read() {
+  stream_.async_read_some(boost::asio::buffer(buf_),
+    [this](boost::system::error_code ec, std::size_t n) {
+      if (ec) {
+        if (ec != boost::asio::error::operation_aborted) {
+          log_warn("inotify read failed: {}", ec.message());
+        }
+        return;
+      }
+      on_events(n);
+      do_read();
+    });
+}
+
+void DocRootWatcher::on_events(std::size_t n) {
+  std::size_t off = 0;
+  while (off + sizeof(inotify_event) <= n) {
+    const auto* ev = reinterpret_cast<const inotify_event*>(buf_.data() + off);
+    off += sizeof(inotify_event) + ev->len;
+
+    if (ev->mask & IN_Q_OVERFLOW) {
+      // Events were dropped; we no longer know what changed.
+      notify("/", true);
+      continue;
+    }
+    auto dir = dirs_.find(ev->wd);
+    if (dir == dirs_.end()) continue;
+    if (ev->mask & IN_IGNORED) {
+      dirs_.erase(dir);
+      continue;
+    }
+    if (ev->len == 0) continue; // event on the watched directory itself
+
+    const std::string url = dir->second + "/" + ev->name;
+    if (ev->mask & IN_ISDIR) {
+      if (ev->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        forget_tree(url);
+      } else if (ev->mask & (IN_CREATE | IN_MOVED_TO)) {
+        add_tree(root_ + url, url);
+      }
+      notify(url, true);
+    } else {
+      notify(url, false);
+    }
+  }
+}
+
+#else
+
+bool DocRootWatcher::start() {
+  log_warn("doc root watching needs inotify (Linux); cached files will not be revalidated");
+  return false;
+}
+
+void DocRootWatcher::add_tree(const std::string&, const std::string&) {}
+void DocRootWatcher::forget_tree(const std::string&) {}
+void DocRootWatcher::do_read() {}
+void DocRootWatcher::on_events(std::size_t) {}
+
+#endif
+
+void DocRootWatcher::notify(const std::string& url_path, bool is_dir) {
+  for (const auto& l : listeners_) l(url_path, is_dir);
+}
+
+void invalidate_cached_path(LRUCache& cache, const std::string& url_path, bool is_dir) {
+  if (is_dir) {
+    cache.erase_prefix(url_path == "/" ? url_path : url_path + "/");
+    return;
+  }
+  cache.erase_file(url_path);
+  for (const auto& v : kPrecompressedVariants) {
+    cache.erase_file(LRUCache::variant_key(url_path, v.coding));
+    // "/app.js.br" changed: the cached "/app.js?br" is what is stale.
+    const std::string sfx = v.suffix;
+    if (url_path.size() > sfx.size() &&
+        url_path.compare(url_path.size() - sfx.size(), sfx.size(), sfx) == 0) {
+      cache.erase_file(LRUCache::variant_key(url_path.substr(0, url_path.size() - sfx.size()), v.coding));
+    }
+  }
+}
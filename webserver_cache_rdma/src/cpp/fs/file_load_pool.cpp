@@ -0,0 +1,87 @@
+#include "../../headers/fs/file_load_pool.hpp"
+#include "../../headers/util/metrics.hpp"
+
+static unsigned long long micros_since(std::chrono::steady_clock::time_point t) {
+  return static_cast<unsigned long long>(
+    std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - t).count());
+}
+
+FileLoadPool::FileLoadPool(unsigned threads, std::size_t max_queued) : max_queued_(max_queued) {
+  threads_.reserve(threads);
+  for (unsigned i = 0; i < threads; ++i) {
+    threads_.emplace_back([this] { run(); });
+  }
+}
+
+FileLoadPool::~FileLoadPool() {
+  stop();
+}
+
+void FileLoadPool::stop() {
+  std::deque<Job> dropped;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (stopping_) return;
+    stopping_ = true;
+    dropped.swap(queue_);
+  }
+  Metrics::instance().file_load_queue_depth.fetch_sub(dropped.size(), std::memory_order_relaxed);
+  cv_.notify_all();
+  for (auto& t : threads_) t.join();
+
+  // Every caller is waiting on its callback (a parked session, a single
+  // flight and its followers), so the reads that never started still end.
+  for (auto& job : dropped) {
+    FileReadResult fr;
+    fr.error = "Operation aborted";
+    job.done(std::move(fr));
+  }
+}
+
+void FileLoadPool::read_range(FileOpenResult opened, std::uint64_t offset, std::size_t len, Callback done) {
+  Job job{std::move(opened), offset, len, std::move(done), std::chrono::steady_clock::now()};
+  FileReadResult fr;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (stopping_) {
+      fr.error = "Operation aborted";
+    } else if (queue_.size() < max_queued_) {
+      queue_.push_back(std::move(job));
+      Metrics::instance().file_load_queue_depth.fetch_add(1, std::memory_order_relaxed);
+      cv_.notify_one();
+      return;
+    } else {
+      // Reading it here instead would block an io_context worker or an
+      // RDMA poller on the disk, the stall the pool exists to avoid.
+      Metrics::instance().file_loads_rejected.fetch_add(1, std::memory_order_relaxed);
+      fr.error = "Too many file loads queued";
+      fr.overloaded = true;
+    }
+  }
+  job.done(std::move(fr));
+}
+
+void FileLoadPool::run() {
+  for (;;) {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lk(mtx_);
+      cv_.wait(lk, [this] { return stopping_ || !queue_.empty(); });
+      if (stopping_) return;
+      job = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    Metrics::instance().file_load_queue_depth.fetch_sub(1, std::memory_order_relaxed);
+    Metrics::instance().file_load_wait_us.fetch_add(micros_since(job.queued_at), std::memory_order_relaxed);
+    load(job);
+  }
+}
+
+void FileLoadPool::load(Job& job) {
+  const auto started = std::chrono::steady_clock::now();
+  FileReadResult fr = read_file(job.opened, job.offset, job.len);
+  auto& m = Metrics::instance();
+  m.file_loads.fetch_add(1, std::memory_order_relaxed);
+  m.file_load_read_us.fetch_add(micros_since(started), std::memory_order_relaxed);
+  job.done(std::move(fr));
+}
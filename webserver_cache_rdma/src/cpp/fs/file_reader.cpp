@@ -1,36 +1,81 @@
 #include "../../headers/fs/file_reader.hpp"
-#include <filesystem>
-#include <fstream>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
-namespace fs = std::filesystem;
+OpenFile::~OpenFile() {
+  if (fd_ >= 0) ::close(fd_);
+}
 
-FileReadResult read_file(const std::string& path) {
+FileOpenResult open_file(const std::string& path) {
+  FileOpenResult r;
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    r.ok = false; r.error = (errno == ENOENT) ? "File not found" : "Open failed";
+    return r;
+  }
+  auto file = std::make_shared<OpenFile>(fd);
+
+  struct stat st{};
+  if (::fstat(fd, &st) != 0) {
+    r.ok = false; r.error = "Stat failed";
+    return r;
+  }
+  if (!S_ISREG(st.st_mode)) {
+    r.ok = false; r.error = "File not found";
+    return r;
+  }
+
+  r.ok = true;
+  r.file = std::move(file);
+  r.size = static_cast<std::size_t>(st.st_size);
+  r.last_modified = st.st_mtime;
+  return r;
+}
+
+FileReadResult read_file(const FileOpenResult& opened) {
+  return read_file(opened, 0, opened.size);
+}
+
+FileReadResult read_file(const FileOpenResult& opened, std::uint64_t offset, std::size_t len) {
   FileReadResult r;
+  if (!opened.ok || !opened.file) {
+    r.ok = false; r.error = opened.error.empty() ? "Open failed" : opened.error;
+    return r;
+  }
 
   try {
-    fs::path p(path);
-    if (!fs::exists(p) || !fs::is_regular_file(p)) {
-      r.ok = false; r.error = "File not found";
-      return r;
-    }
-    auto fsize = fs::file_size(p);
-    r.data.resize(static_cast<std::size_t>(fsize));
-
-    std::ifstream ifs(path, std::ios::binary);
-    if (!ifs) { r.ok = false; r.error = "Open failed"; return r; }
-    if (!r.data.empty()) {
-      ifs.read(reinterpret_cast<char*>(r.data.data()), static_cast<std::streamsize>(r.data.size()));
-      if (!ifs) { r.ok = false; r.error = "Read failed"; return r; }
-    }
-
-    auto ftime = fs::last_write_time(p).time_since_epoch();
-    auto secs = std::chrono::duration_cast<std::chrono::seconds>(ftime).count();
-    r.last_modified = static_cast<std::time_t>(secs);
-
-    r.ok = true;
-    return r;
+    r.data.resize(len);
   } catch (const std::exception& ex) {
     r.ok = false; r.error = ex.what();
     return r;
   }
-}
\ No newline at end of file
+
+  if (!read_file_range(*opened.file, offset, r.data.data(), r.data.size())) {
+    r.ok = false; r.error = "Read failed";
+    r.data.clear();
+    return r;
+  }
+
+  r.last_modified = opened.last_modified;
+  r.ok = true;
+  return r;
+}
+
+bool read_file_range(const OpenFile& file, std::uint64_t offset, uint8_t* dst, std::size_t len) {
+  std::size_t done = 0;
+  while (done < len) {
+    auto n = ::pread(file.fd(), dst + done, len - done, static_cast<off_t>(offset + done));
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    done += static_cast<std::size_t>(n);
+  }
+  return true;
+}
+
+FileReadResult read_file(const std::string& path) {
+  return read_file(open_file(path));
+}
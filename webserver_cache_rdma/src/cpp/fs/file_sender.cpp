@@ -0,0 +1,24 @@
+#include "../../headers/fs/file_sender.hpp"
+#include <algorithm>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/sendfile.h>
+#else
+#include <sys/socket.h>
+#endif
+
+long send_file_some(int out_fd, int in_fd, std::uint64_t offset, std::size_t count) {
+#if defined(__linux__)
+  off_t off = static_cast<off_t>(offset);
+  return static_cast<long>(::sendfile(out_fd, in_fd, &off, count));
+#else
+  // Portable fallback: bounce through a small stack buffer.
+  char buf[16384];
+  auto want = std::min(count, sizeof(buf));
+  auto n = ::pread(in_fd, buf, want, static_cast<off_t>(offset));
+  if (n <= 0) return static_cast<long>(n);
+  return static_cast<long>(::send(out_fd, buf, static_cast<std::size_t>(n), 0));
+#endif
+}
@@ -0,0 +1,136 @@
+#include "../../headers/fs/path_resolver.hpp"
+#include "../../headers/http/encoding.hpp"
+#include "../../headers/util/metrics.hpp"
+#include <mutex>
+
+namespace fs = std::filesystem;
+
+PathResolver::PathResolver(const std::string& doc_root,
+                           bool cache_results,
+                           std::size_t negative_entries,
+                           std::chrono::milliseconds negative_ttl)
+  : doc_root_(doc_root),
+    cache_results_(cache_results),
+    negative_capacity_(negative_ttl.count() > 0 ? negative_entries : 0),
+    negative_ttl_(negative_ttl) {
+  std::error_code ec;
+  root_ = fs::weakly_canonical(fs::path(doc_root), ec);
+  if (ec || !fs::is_directory(root_, ec)) {
+    cache_results_ = false;
+    negative_capacity_ = 0;
+  }
+}
+
+std::shared_ptr<const PathMapResult> PathResolver::resolve(std::string_view url_path) {
+  if (!cache_results_ && negative_capacity_ == 0) {
+    return std::make_shared<const PathMapResult>(map_url_to_fs(doc_root_, url_path));
+  }
+
+  auto& m = Metrics::instance();
+  // Per-thread scratch: a repeat request then resolves without allocating.
+  thread_local std::string sanitized;
+  sanitize_url_path(url_path, sanitized);
+  {
+    std::shared_lock lock(mtx_);
+    auto it = map_.find(sanitized);
+    if (it != map_.end()) {
+      m.path_cache_hits.fetch_add(1, std::memory_order_relaxed);
+      return it->second;
+    }
+    std::shared_ptr<const PathMapResult> neg;
+    if (lookup_negative(sanitized, neg)) {
+      m.negative_cache_hits.fetch_add(1, std::memory_order_relaxed);
+      return neg;
+    }
+  }
+  m.path_cache_misses.fetch_add(1, std::memory_order_relaxed);
+
+  auto r = std::make_shared<const PathMapResult>(map_sanitized_to_fs(root_, sanitized));
+  if (r->ok && r->exists) {
+    // A symlink anywhere on the path can be re-pointed without an event
+    // under this URL, so such mappings are redone every time.
+    if (cache_results_ && !r->via_symlink) {
+      std::unique_lock lock(mtx_);
+      map_.emplace(sanitized, r);
+    }
+  } else if (negative_capacity_ > 0) {
+    remember_negative(sanitized, r);
+  }
+  return r;
+}
+
+bool PathResolver::lookup_negative(const std::string& sanitized, std::shared_ptr<const PathMapResult>& out) const {
+  if (negative_capacity_ == 0) return false;
+  auto it = negative_.find(sanitized);
+  if (it == negative_.end() || it->second.expires <= Clock::now()) return false;
+  out = it->second.result;
+  return true;
+}
+
+void PathResolver::remember_negative(const std::string& sanitized, std::shared_ptr<const PathMapResult> r) {
+  std::unique_lock lock(mtx_);
+  auto it = negative_.find(sanitized);
+  if (it != negative_.end()) erase_negative_locked(it);  // expired; re-queue as newest
+  while (negative_.size() >= negative_capacity_) {
+    erase_negative_locked(negative_.find(negative_order_.back()));
+  }
+  negative_order_.push_front(sanitized);
+  negative_.emplace(sanitized, Negative{std::move(r), Clock::now() + negative_ttl_, negative_order_.begin()});
+}
+
+void PathResolver::erase_negative_locked(std::unordered_map<std::string, Negative>::iterator it) {
+  negative_order_.erase(it->second.pos);
+  negative_.erase(it);
+}
+
+void PathResolver::forget_file_locked(const std::string& url_path) {
+  map_.erase(url_path);
+  if (auto it = negative_.find(url_path); it != negative_.end()) erase_negative_locked(it);
+  // "/" is served from "/index.html"
+  if (url_path == "/index.html") {
+    map_.erase("/");
+    if (auto it = negative_.find("/"); it != negative_.end()) erase_negative_locked(it);
+  }
+}
+
+void PathResolver::invalidate(const std::string& url_path, bool is_dir) {
+  std::unique_lock lock(mtx_);
+  if (!is_dir) {
+    forget_file_locked(url_path);
+    // "/app.js.br" appeared or went away: "/app.js" lists its siblings.
+    for (const auto& v : kPrecompressedVariants) {
+      const std::string_view sfx = v.suffix;
+      if (url_path.size() > sfx.size() &&
+          url_path.compare(url_path.size() - sfx.size(), sfx.size(), sfx) == 0) {
+        forget_file_locked(url_path.substr(0, url_path.size() - sfx.size()));
+      }
+    }
+    return;
+  }
+  if (url_path == "/") {
+    map_.clear();
+    negative_.clear();
+    negative_order_.clear();
+    return;
+  }
+  // A directory replaced by a symlink (or vice versa) can re-point anything
+  // below it, so drop the whole subtree.
+  const std::string prefix = url_path + "/";
+  auto under = [&](const std::string& k) {
+    return k == url_path || k.compare(0, prefix.size(), prefix) == 0;
+  };
+  for (auto it = map_.begin(); it != map_.end();) {
+    if (under(it->first)) it = map_.erase(it);
+    else ++it;
+  }
+  for (auto it = negative_.begin(); it != negative_.end();) {
+    auto next = std::next(it);
+    if (under(it->first)) erase_negative_locked(it);
+    it = next;
+  }
+}
+
+std::size_t PathResolver::size() const {
+  std::shared_lock lock(mtx_);
+  return map_.size();
+}
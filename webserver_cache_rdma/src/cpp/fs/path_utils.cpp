@@ -1,37 +1,41 @@
 #include "../../headers/fs/path_utils.hpp"
+#include "../../headers/cache/lru_cache.hpp"
+#include "../../headers/http/encoding.hpp"
 #include <filesystem>
 #include <string>
-#include <vector>
 
 namespace fs = std::filesystem;
 
-static std::string sanitize(const std::string& url_path) {
-  auto p = url_path;
-  auto qpos = p.find_first_of("?#");
-  if (qpos != std::string::npos) p = p.substr(0, qpos);
-  if (p.empty() || p[0] != '/') p = "/" + p;
+std::string sanitize_url_path(std::string_view url_path) {
+  std::string out;
+  sanitize_url_path(url_path, out);
+  return out;
+}
 
-  std::string out = "/";
-  std::vector<std::string> parts;
-  std::size_t i = 1;
+void sanitize_url_path(std::string_view url_path, std::string& out) {
+  const std::string_view p = url_path.substr(0, url_path.find_first_of("?#"));
+
+  // `out` doubles as the segment stack: ".." truncates back to the last '/'.
+  out.clear();
+  out.reserve(p.size() + 1);
+  std::size_t i = 0;
   while (i <= p.size()) {
     auto j = p.find('/', i);
-    if (j == std::string::npos) j = p.size();
-    auto part = p.substr(i, j - i);
-    if (!part.empty() && part != ".") {
-      if (part == "..") { if (!parts.empty()) parts.pop_back(); }
-      else { parts.push_back(part); }
+    if (j == std::string_view::npos) j = p.size();
+    const auto part = p.substr(i, j - i);
+    if (part == "..") {
+      auto cut = out.rfind('/');
+      out.erase(cut == std::string::npos ? 0 : cut);
+    } else if (!part.empty() && part != ".") {
+      out += '/';
+      out += part;
     }
     i = j + 1;
   }
-  for (size_t k = 0; k < parts.size(); ++k) {
-    out += parts[k];
-    if (k + 1 < parts.size()) out += "/";
-  }
-  return out;
+  if (out.empty()) out = "/";
 }
 
-PathMapResult map_url_to_fs(const std::string& doc_root, const std::string& url_path) {
+PathMapResult map_url_to_fs(const std::string& doc_root, std::string_view url_path) {
   PathMapResult r;
 
   try {
@@ -39,23 +43,50 @@ PathMapResult map_url_to_fs(const std::string& doc_root, const std::string& url_
     if (!fs::exists(root) || !fs::is_directory(root)) {
       r.ok = false; r.exists = false; r.error = "Document root not found"; return r;
     }
+    return map_sanitized_to_fs(root, sanitize_url_path(url_path));
+  } catch (const std::exception& ex) {
+    r.ok = false; r.exists = false; r.error = ex.what();
+    return r;
+  }
+}
 
-    std::string sanitized = sanitize(url_path);
+PathMapResult map_sanitized_to_fs(const std::filesystem::path& root, const std::string& sanitized) {
+  PathMapResult r;
+
+  try {
     fs::path rel = sanitized.substr(1);
     if (rel.empty()) rel = "index.html";
 
     fs::path target = root / rel;
     fs::path canon = fs::weakly_canonical(target);
 
-    auto canon_root = root;
-    if (canon.string().compare(0, canon_root.string().size(), canon_root.string()) != 0) {
+    // Inside means the root itself or below "root/": a bare prefix test
+    // would let a symlink reach a sibling such as "/srv/www2".
+    const std::string& root_str = root.native();
+    const std::string& canon_str = canon.native();
+    const bool inside = canon_str.compare(0, root_str.size(), root_str) == 0 &&
+                        (canon_str.size() == root_str.size() || root_str.back() == '/' ||
+                         canon_str[root_str.size()] == '/');
+    if (!inside) {
       r.ok = false; r.exists = false; r.error = "Path traversal"; return r;
     }
 
     r.ok = true;
     r.exists = fs::exists(canon) && fs::is_regular_file(canon);
     r.fs_path = canon.string();
-    r.cache_key = sanitized == "/" ? "/index.html" : sanitized;
+    r.via_symlink = canon != target;
+    // Keyed by the real file, so the watcher's event on a symlink's target
+    // invalidates what was cached through the link.
+    r.cache_key = r.via_symlink ? "/" + canon.lexically_relative(root).generic_string()
+                                : sanitized == "/" ? "/index.html" : sanitized;
+    if (r.exists) {
+      for (const auto& v : kPrecompressedVariants) {
+        std::string sibling = r.fs_path + v.suffix;
+        std::error_code ec;
+        if (!fs::is_regular_file(sibling, ec)) continue;
+        r.variants.push_back({v.coding, LRUCache::variant_key(r.cache_key, v.coding), std::move(sibling)});
+      }
+    }
 
     return r;
   } catch (const std::exception& ex) {
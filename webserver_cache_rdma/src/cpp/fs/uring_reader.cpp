@@ -0,0 +1,322 @@
+#include "../../headers/fs/uring_reader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#ifdef ENABLE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+bool io_uring_available() {
+#ifdef ENABLE_IO_URING
+  return true;
+#else
+  return false;
+#endif
+}
+
+struct UringReader::Op {
+  FileOpenResult opened;
+  std::uint64_t offset = 0;  // of result.data[0] in the file
+  FileReadResult result;
+  std::size_t done = 0;
+  Callback cb;
+};
+
+#ifdef ENABLE_IO_URING
+
+// The shared rings as mapped from the kernel. Head/tail indices are
+// written by one side and read by the other, hence the acquire/release.
+struct UringReader::Ring {
+  int fd = -1;
+  void* sq_map = MAP_FAILED;
+  std::size_t sq_map_size = 0;
+  void* cq_map = MAP_FAILED;
+  std::size_t cq_map_size = 0;
+  io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+  std::size_t sqes_size = 0;
+
+  unsigned* sq_head = nullptr;
+  unsigned* sq_tail = nullptr;
+  unsigned* sq_mask = nullptr;
+  unsigned* sq_array = nullptr;
+  unsigned sq_entries = 0;
+  unsigned* cq_head = nullptr;
+  unsigned* cq_tail = nullptr;
+  unsigned* cq_mask = nullptr;
+  io_uring_cqe* cqes = nullptr;
+
+  ~Ring() {
+    if (sqes != MAP_FAILED) ::munmap(sqes, sqes_size);
+    if (cq_map != MAP_FAILED && cq_map != sq_map) ::munmap(cq_map, cq_map_size);
+    if (sq_map != MAP_FAILED) ::munmap(sq_map, sq_map_size);
+    if (fd >= 0) ::close(fd);
+  }
+};
+
+static int uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+std::unique_ptr<UringReader> UringReader::create(boost::asio::io_context& ioc, unsigned entries, std::string& error,
+                                                 std::size_t max_read) {
+  auto ring = std::make_unique<Ring>();
+  io_uring_params p{};
+  ring->fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+  if (ring->fd < 0) {
+    error = std::string("io_uring_setup: ") + std::strerror(errno);
+    return nullptr;
+  }
+
+  ring->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ring->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) ring->sq_map_size = ring->cq_map_size = std::max(ring->sq_map_size, ring->cq_map_size);
+
+  ring->sq_map = ::mmap(nullptr, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                        ring->fd, IORING_OFF_SQ_RING);
+  if (ring->sq_map == MAP_FAILED) {
+    error = std::string("io_uring mmap: ") + std::strerror(errno);
+    return nullptr;
+  }
+  ring->cq_map = single_mmap
+    ? ring->sq_map
+    : ::mmap(nullptr, ring->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+             ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+  ring->sqes = static_cast<io_uring_sqe*>(::mmap(nullptr, ring->sqes_size, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES));
+  if (ring->cq_map == MAP_FAILED || ring->sqes == MAP_FAILED) {
+    error = std::string("io_uring mmap: ") + std::strerror(errno);
+    return nullptr;
+  }
+
+  auto* sq = static_cast<char*>(ring->sq_map);
+  auto* cq = static_cast<char*>(ring->cq_map);
+  ring->sq_head = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+  ring->sq_tail = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+  ring->sq_mask = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+  ring->sq_array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+  ring->sq_entries = p.sq_entries;
+  ring->cq_head = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+  ring->cq_tail = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+  ring->cq_mask = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+  ring->cqes = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+
+  int efd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (efd < 0) {
+    error = std::string("eventfd: ") + std::strerror(errno);
+    return nullptr;
+  }
+  if (::syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_EVENTFD, &efd, 1) != 0) {
+    error = std::string("io_uring_register: ") + std::strerror(errno);
+    ::close(efd);
+    return nullptr;
+  }
+
+  max_read = std::clamp<std::size_t>(max_read, 1, std::size_t{1} << 30);  // sqe.len is 32 bits
+  std::unique_ptr<UringReader> reader(new UringReader(ioc, std::move(ring), efd, max_read));
+  reader->wait_for_completions();
+  return reader;
+}
+
+UringReader::UringReader(boost::asio::io_context& ioc, std::unique_ptr<Ring> ring, int event_fd, std::size_t max_read)
+  : ring_(std::move(ring)), max_read_(max_read), event_(ioc, event_fd) {}
+
+UringReader::~UringReader() {
+  boost::system::error_code ig;
+  event_.cancel(ig);
+  // The kernel may still write into buffers owned by in-flight ops.
+  for (;;) {
+    {
+      std::lock_guard<std::mutex> lk(sq_mutex_);
+      if (in_flight_ == 0) break;
+    }
+    uring_enter(ring_->fd, 0, 1, IORING_ENTER_GETEVENTS);
+    reap();
+  }
+}
+
+void UringReader::read_range(FileOpenResult opened, std::uint64_t offset, std::size_t len, Callback done) {
+  if (!opened.ok || !opened.file) {
+    done(read_file(opened, offset, len));
+    return;
+  }
+
+  auto* op = new Op;
+  op->opened = std::move(opened);
+  op->offset = offset;
+  op->cb = std::move(done);
+  try {
+    op->result.data.resize(len);
+  } catch (const std::exception& ex) {
+    op->result.error = ex.what();
+    finish(op, false, nullptr);
+    return;
+  }
+  if (len == 0) {
+    finish(op, true, nullptr);
+    return;
+  }
+  if (!submit(op)) read_inline(op);
+}
+
+// Returns false only if the kernel refused the read with nothing in flight,
+// so no completion would ever come to retry it.
+bool UringReader::submit(Op* op) {
+  std::lock_guard<std::mutex> lk(sq_mutex_);
+  if (!backlog_.empty() || in_flight_ >= ring_->sq_entries) {
+    backlog_.push_back(op);
+    return true;
+  }
+  const int err = enqueue_locked(op);
+  if (err == 0) return true;
+  if (in_flight_ > 0 && (err == EAGAIN || err == EBUSY)) {
+    backlog_.push_back(op);
+    return true;
+  }
+  return false;
+}
+
+// Hands the queued reads to the ring as completions free its slots.
+void UringReader::submit_backlog() {
+  std::deque<Op*> refused;
+  {
+    std::lock_guard<std::mutex> lk(sq_mutex_);
+    while (!backlog_.empty() && in_flight_ < ring_->sq_entries) {
+      if (enqueue_locked(backlog_.front()) != 0) break;
+      backlog_.pop_front();
+    }
+    if (in_flight_ == 0) refused.swap(backlog_);
+  }
+  for (Op* op : refused) read_inline(op);
+}
+
+// The last resort when the ring will not take a read at all.
+void UringReader::read_inline(Op* op) {
+  const bool ok = read_file_range(*op->opened.file, op->offset + op->done, op->result.data.data() + op->done,
+                                  op->result.data.size() - op->done);
+  finish(op, ok, "Read failed");
+}
+
+// Puts one READ for the rest of `op` on the ring; 0 or an errno.
+int UringReader::enqueue_locked(Op* op) {
+  Ring& r = *ring_;
+  const unsigned tail = *r.sq_tail;
+  if (tail - __atomic_load_n(r.sq_head, __ATOMIC_ACQUIRE) >= r.sq_entries) return EBUSY;
+
+  const unsigned idx = tail & *r.sq_mask;
+  io_uring_sqe& sqe = r.sqes[idx];
+  sqe = io_uring_sqe{};
+  sqe.opcode = IORING_OP_READ;
+  sqe.fd = op->opened.file->fd();
+  sqe.addr = reinterpret_cast<std::uint64_t>(op->result.data.data() + op->done);
+  sqe.len = static_cast<std::uint32_t>(std::min(op->result.data.size() - op->done, max_read_));
+  sqe.off = op->offset + op->done;
+  sqe.user_data = reinterpret_cast<std::uint64_t>(op);
+  r.sq_array[idx] = idx;
+  __atomic_store_n(r.sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+  int n;
+  do {
+    n = uring_enter(r.fd, 1, 0, 0);
+  } while (n < 0 && errno == EINTR);
+  if (n != 1) {
+    // Not consumed; without SQPOLL the kernel only reads SQEs in enter().
+    __atomic_store_n(r.sq_tail, tail, __ATOMIC_RELEASE);
+    return n < 0 ? errno : EAGAIN;
+  }
+  ++in_flight_;
+  return 0;
+}
+
+void UringReader::wait_for_completions() {
+  event_.async_wait(boost::asio::posix::stream_descriptor::wait_read,
+    [this](const boost::system::error_code& ec) {
+      if (ec) return;
+      reap();
+      wait_for_completions();
+    });
+}
+
+void UringReader::reap() {
+  std::uint64_t signalled;
+  while (::read(event_.native_handle(), &signalled, sizeof(signalled)) < 0 && errno == EINTR) {}
+
+  Ring& r = *ring_;
+  std::vector<std::pair<Op*, int>> done;
+  unsigned head = *r.cq_head;
+  const unsigned tail = __atomic_load_n(r.cq_tail, __ATOMIC_ACQUIRE);
+  for (; head != tail; ++head) {
+    const io_uring_cqe& cqe = r.cqes[head & *r.cq_mask];
+    done.emplace_back(reinterpret_cast<Op*>(cqe.user_data), cqe.res);
+  }
+  __atomic_store_n(r.cq_head, head, __ATOMIC_RELEASE);
+  {
+    std::lock_guard<std::mutex> lk(sq_mutex_);
+    in_flight_ -= done.size();
+  }
+
+  for (auto [op, res] : done) {
+    if (res == -EINTR || res == -EAGAIN) res = 0;  // retry below from the same offset
+    else if (res <= 0) {
+      // 0 means the file shrank under us; the size was fixed at open.
+      finish(op, false, "Read failed");
+      continue;
+    }
+    op->done += static_cast<std::size_t>(res);
+    if (op->done == op->result.data.size()) {
+      finish(op, true, nullptr);
+    } else if (!submit(op)) {
+      read_inline(op);
+    }
+  }
+  submit_backlog();
+}
+
+void UringReader::finish(Op* op, bool ok, const char* error) {
+  std::unique_ptr<Op> owned(op);
+  op->result.ok = ok;
+  if (ok) {
+    op->result.last_modified = op->opened.last_modified;
+  } else if (op->result.error.empty()) {
+    op->result.error = error ? error : "Read failed";
+  }
+  if (!ok) op->result.data.clear();
+  op->cb(std::move(op->result));
+}
+
+#else // !ENABLE_IO_URING
+
+struct UringReader::Ring {};
+
+std::unique_ptr<UringReader> UringReader::create(boost::asio::io_context&, unsigned, std::string& error,
+                                                 std::size_t) {
+  error = "built without ENABLE_IO_URING";
+  return nullptr;
+}
+
+UringReader::UringReader(boost::asio::io_context& ioc, std::unique_ptr<Ring> ring, int event_fd, std::size_t max_read)
+  : ring_(std::move(ring)), max_read_(max_read), event_(ioc, event_fd) {}
+
+UringReader::~UringReader() = default;
+
+void UringReader::read_range(FileOpenResult opened, std::uint64_t offset, std::size_t len, Callback done) {
+  done(read_file(opened, offset, len));
+}
+
+bool UringReader::submit(Op*) { return false; }
+int UringReader::enqueue_locked(Op*) { return ENOSYS; }
+void UringReader::submit_backlog() {}
+void UringReader::read_inline(Op*) {}
+void UringReader::wait_for_completions() {}
+void UringReader::reap() {}
+void UringReader::finish(Op*, bool, const char*) {}
+
+#endif // ENABLE_IO_URING
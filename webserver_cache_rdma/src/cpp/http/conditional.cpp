@@ -0,0 +1,42 @@
+#include "../../headers/http/conditional.hpp"
+#include "../../headers/util/time.hpp"
+#include <string_view>
+
+static std::string_view opaque_tag(std::string_view tag) {
+  return tag.compare(0, 2, "W/") == 0 ? tag.substr(2) : tag;
+}
+
+static bool etag_list_matches(std::string_view list, std::string_view etag) {
+  const std::string_view want = opaque_tag(etag);
+  std::size_t i = 0;
+  while (i < list.size()) {
+    while (i < list.size() && (list[i] == ' ' || list[i] == '\t' || list[i] == ',')) ++i;
+    if (i >= list.size()) break;
+    if (list[i] == '*') return true;
+
+    std::size_t start = i;
+    if (list.compare(i, 2, "W/") == 0) i += 2;
+    if (i < list.size() && list[i] == '"') {
+      auto close = list.find('"', i + 1);
+      if (close == std::string_view::npos) return false;
+      i = close + 1;
+    } else {
+      while (i < list.size() && list[i] != ',') ++i;
+    }
+    if (opaque_tag(list.substr(start, i - start)) == want) return true;
+  }
+  return false;
+}
+
+bool is_not_modified(const HttpRequest& req, const std::string& etag, std::time_t last_modified) {
+  if (!(req.method == "GET" || req.method == "HEAD")) return false;
+
+  const std::string_view inm = req.header("if-none-match");
+  if (!inm.empty()) return etag_list_matches(inm, etag);
+
+  const std::string_view ims = req.header("if-modified-since");
+  if (ims.empty()) return false;
+  std::time_t since = 0;
+  if (!parse_http_date(ims, since)) return false;
+  return last_modified <= since;
+}
@@ -0,0 +1,45 @@
+#include "../../headers/http/encoding.hpp"
+#include "../../headers/http/headers.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+
+static std::string_view trim(std::string_view s) {
+  std::size_t b = 0, e = s.size();
+  while (b < e && std::isspace(static_cast<unsigned char>(s[b]))) ++b;
+  while (e > b && std::isspace(static_cast<unsigned char>(s[e - 1]))) --e;
+  return s.substr(b, e - b);
+}
+
+double encoding_quality(std::string_view accept_encoding, std::string_view coding) {
+  double wildcard = -1.0;
+  std::size_t i = 0;
+  while (i <= accept_encoding.size()) {
+    auto comma = accept_encoding.find(',', i);
+    if (comma == std::string_view::npos) comma = accept_encoding.size();
+    const std::string_view item = accept_encoding.substr(i, comma - i);
+    i = comma + 1;
+
+    auto semi = item.find(';');
+    const std::string_view name = trim(item.substr(0, semi));
+    if (name.empty()) continue;
+
+    // The q parameter need not come first ("gzip;level=9;q=0").
+    double q = 1.0;
+    for (std::size_t p = semi; p != std::string_view::npos;) {
+      const std::size_t next = item.find(';', p + 1);
+      const std::string_view param = trim(item.substr(p + 1, next == std::string_view::npos ? next : next - p - 1));
+      p = next;
+      if (param.size() > 2 && (param[0] == 'q' || param[0] == 'Q') && param[1] == '=') {
+        // strtod needs a terminator; q-values are at most "1.000".
+        char num[8]{};
+        param.substr(2, sizeof(num) - 1).copy(num, sizeof(num) - 1);
+        q = std::clamp(std::strtod(num, nullptr), 0.0, 1.0);
+      }
+    }
+
+    if (header_iequals(name, coding)) return q;
+    if (name == "*") wildcard = q;
+  }
+  return wildcard > 0.0 ? wildcard : 0.0;
+}
@@ -1,100 +1,118 @@
 #include "../../headers/http/parser.hpp"
 #include "../../headers/http/headers.hpp"
-#include <cctype>
+#include "../../headers/http/scan.hpp"
 #include <algorithm>
+#include <cstring>
+#include <string_view>
+
+HttpParser::HttpParser(std::size_t max_start_line, std::size_t max_headers_bytes, std::size_t max_header_fields)
+  : capacity_(max_start_line + max_headers_bytes + 4),
+    max_start_line_(max_start_line),
+    max_headers_bytes_(max_headers_bytes),
+    max_header_fields_(max_header_fields),
+    scan_(scan_kernels()) {}
 
 void HttpParser::reset() {
-  buf_.clear();
+  begin_ = end_ = scanned_ = 0;
+  live_ = false;
 }
 
-ParseResult HttpParser::parse(const char *data, std::size_t n) {
-  buf_.append(data, n);
+void HttpParser::release_buffer() {
+  if (!buf_ || live_ || end_ != begin_) return;
+  buf_.reset();
+  begin_ = end_ = scanned_ = 0;
+}
 
-  if (buf_.size() > (max_start_line_ + max_headers_bytes_ + 4)) {
-    return {ParseState::BadRequest, {}};
-  }
+void HttpParser::compact() {
+  if (live_ || begin_ == 0) return;
+  const std::size_t n = end_ - begin_;
+  if (n > 0) std::memmove(buf_.get(), buf_.get() + begin_, n);
+  scanned_ -= begin_;
+  begin_ = 0;
+  end_ = n;
+}
 
-  HttpRequest req;
-  if (!try_parse(req)) {
-    if (buf_.size() > (max_start_line_ + max_headers_bytes_ + 4)) {
-      return {ParseState::BadRequest, {}};
-    }
-    return {ParseState::Incomplete, {}};
+ParseState HttpParser::next(HttpRequest& out) {
+  if (!buf_) return ParseState::Incomplete;
+  // Tolerate the stray CRLF some clients send between requests.
+  while (end_ - begin_ >= 2 && buf_[begin_] == '\r' && buf_[begin_ + 1] == '\n') begin_ += 2;
+  if (scanned_ < begin_) scanned_ = begin_;
+
+  // Resume the terminator search where the last partial read left off.
+  const char* head = buf_.get() + begin_;
+  const char* end = buf_.get() + end_;
+  const std::size_t from = scanned_ - begin_ >= 3 ? scanned_ - begin_ - 3 : 0;
+  const char* term = scan_.find_head_end(head + from, end);
+  if (term == end) {
+    scanned_ = end_;
+    if (end_ - begin_ >= capacity_) return ParseState::BadRequest;  // head larger than allowed
+    return ParseState::Incomplete;
   }
-  return {ParseState::Done, req};
-}
 
-static bool is_token_char(char c) {
-  static const std::string tspecials = "()<>@,;:\\\"/[]?={} \t";
-  return c > 31 && c < 127 && tspecials.find(c) == std::string::npos;
+  const auto pos = static_cast<std::size_t>(term - head);
+  begin_ += pos + 4;
+  scanned_ = begin_;
+  const ParseState st = parse_head(head, pos, out);
+  if (st == ParseState::Done) live_ = true;
+  return st;
 }
 
-bool HttpParser::try_parse(HttpRequest &out) {
-  auto pos = buf_.find("\r\n\r\n");
-  if (pos == std::string::npos) return false;
-
-  std::string head = buf_.substr(0, pos);
-  buf_.erase(0, pos + 4);
+static std::string_view trim_ows(std::string_view s) {
+  std::size_t b = 0, e = s.size();
+  while (b < e && (s[b] == ' ' || s[b] == '\t')) ++b;
+  while (e > b && (s[e - 1] == ' ' || s[e - 1] == '\t')) --e;
+  return s.substr(b, e - b);
+}
 
-  std::vector<std::string> lines;
-  std::size_t start = 0;
-  while (true) {
-    auto e = head.find("\r\n", start);
-    if (e == std::string::npos) {
-      lines.push_back(head.substr(start));
-      break;
-    }
-    lines.push_back(head.substr(start, e - start));
-    start = e + 2;
-  }
-  if (lines.empty()) return false;
+ParseState HttpParser::parse_head(const char* p, std::size_t len, HttpRequest& out) const {
+  const char* const end = p + len;
+  out.header_count = 0;
+  out.more_headers.clear();
 
-  const std::string &rl = lines[0];
-  if (rl.size() > max_start_line_) return false;
+  const char* eol = scan_.find_crlf(p, end);
+  const std::string_view rl(p, static_cast<std::size_t>(eol - p));
+  if (rl.size() > max_start_line_) return ParseState::BadRequest;
 
   auto s1 = rl.find(' ');
-  auto s2 = rl.find(' ', s1 == std::string::npos ? 0 : s1 + 1);
-  if (s1 == std::string::npos || s2 == std::string::npos) return false;
+  auto s2 = rl.find(' ', s1 == std::string_view::npos ? 0 : s1 + 1);
+  if (s1 == std::string_view::npos || s2 == std::string_view::npos) return ParseState::BadRequest;
 
   out.method = rl.substr(0, s1);
   out.target = rl.substr(s1 + 1, s2 - s1 - 1);
   out.version = rl.substr(s2 + 1);
 
-  if (out.method.empty() || out.target.empty() || out.version.find("HTTP/") != 0) return false;
-  for (char c: out.method) if (!is_token_char(c)) return false;
+  if (out.method.empty() || out.target.empty() || out.version.compare(0, 5, "HTTP/") != 0) return ParseState::BadRequest;
+  const char* method_end = out.method.data() + out.method.size();
+  if (scan_.skip_token(out.method.data(), method_end) != method_end) return ParseState::BadRequest;
 
-  std::unordered_map<std::string, std::string> headers;
   std::size_t total_bytes = 0;
-  for (std::size_t i = 1; i < lines.size(); ++i) {
-    const std::string &line = lines[i];
-    total_bytes += line.size();
-    if (total_bytes > max_headers_bytes_) return false;
-
-    if (line.empty()) continue;
-    auto colon = line.find(':');
-    if (colon == std::string::npos) return false;
-
-    std::string name = line.substr(0, colon);
-    std::string value = line.substr(colon + 1);
-    auto ltrim = [](std::string &s) {
-      s.erase(s.begin(), std::find_if(s.begin(), s.end(), [](unsigned char ch) { return !std::isspace(ch); }));
-    };
-    auto rtrim = [](std::string &s) {
-      s.erase(std::find_if(s.rbegin(), s.rend(), [](unsigned char ch) { return !std::isspace(ch); }).base(), s.end());
-    };
-    ltrim(value);
-    rtrim(value);
-    std::string lname = header_lower(name);
-    headers[lname] = value;
+  while (eol != end) {
+    const char* line = eol + 2;
+    eol = scan_.find_crlf(line, end);
+    total_bytes += static_cast<std::size_t>(eol - line);
+    if (total_bytes > max_headers_bytes_) return ParseState::BadRequest;
+
+    if (line == eol) continue;
+    // field-name is a token directly followed by ':' (RFC 7230 3.2.4).
+    const char* colon = scan_.skip_token(line, eol);
+    if (colon == line || colon == eol || *colon != ':') return ParseState::BadRequest;
+    if (out.header_count == max_header_fields_) return ParseState::TooManyHeaders;
+    const HeaderField field{
+      std::string_view(line, static_cast<std::size_t>(colon - line)),
+      trim_ows(std::string_view(colon + 1, static_cast<std::size_t>(eol - colon - 1)))};
+    if (out.header_count < HttpRequest::kInlineHeaders) {
+      out.headers[out.header_count] = field;
+    } else {
+      out.more_headers.push_back(field);
+    }
+    ++out.header_count;
   }
-  out.headers = std::move(headers);
 
-  auto conn = out.header("connection");
+  const auto conn = out.header("connection");
   if (out.version == "HTTP/1.1") {
-    out.keep_alive = !(conn == "close" || conn == "Close");
+    out.keep_alive = !header_iequals(conn, "close");
   } else {
-    out.keep_alive = (conn == "keep-alive" || conn == "Keep-Alive");
+    out.keep_alive = header_iequals(conn, "keep-alive");
   }
-
-  return true;
+  return ParseState::Done;
 }
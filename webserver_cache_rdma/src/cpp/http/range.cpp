@@ -0,0 +1,82 @@
+#include "../../headers/http/range.hpp"
+#include <cctype>
+
+static std::string_view trim(std::string_view s) {
+  std::size_t b = 0, e = s.size();
+  while (b < e && std::isspace(static_cast<unsigned char>(s[b]))) ++b;
+  while (e > b && std::isspace(static_cast<unsigned char>(s[e - 1]))) --e;
+  return s.substr(b, e - b);
+}
+
+static bool parse_u64(std::string_view s, std::uint64_t& out) {
+  if (s.empty() || s.size() > 19) return false;
+  std::uint64_t v = 0;
+  for (char c : s) {
+    if (c < '0' || c > '9') return false;
+    v = v * 10 + static_cast<std::uint64_t>(c - '0');
+  }
+  out = v;
+  return true;
+}
+
+RangeResult parse_range(std::string_view value, std::uint64_t size,
+                        std::vector<ByteRange>& out, std::size_t max_ranges) {
+  out.clear();
+  // Ignoring the header means ignoring all of it, ranges parsed so far too.
+  const auto ignored = [&out] {
+    out.clear();
+    return RangeResult::None;
+  };
+  const std::string_view v = trim(value);
+  if (v.compare(0, 6, "bytes=") != 0) return RangeResult::None;
+
+  bool any_valid = false;
+  std::size_t i = 6;
+  while (i <= v.size()) {
+    auto comma = v.find(',', i);
+    if (comma == std::string_view::npos) comma = v.size();
+    const std::string_view spec = trim(v.substr(i, comma - i));
+    i = comma + 1;
+    if (spec.empty()) continue;
+
+    auto dash = spec.find('-');
+    if (dash == std::string_view::npos) return ignored();
+    const std::string_view a = trim(spec.substr(0, dash));
+    const std::string_view b = trim(spec.substr(dash + 1));
+
+    ByteRange r;
+    if (a.empty()) {
+      // Suffix range: the last N bytes.
+      std::uint64_t n = 0;
+      if (!parse_u64(b, n)) return ignored();
+      any_valid = true;
+      if (n == 0 || size == 0) continue;
+      r.first = n >= size ? 0 : size - n;
+      r.last = size - 1;
+    } else {
+      std::uint64_t first = 0, last = 0;
+      if (!parse_u64(a, first)) return ignored();
+      if (b.empty()) {
+        last = size ? size - 1 : 0;
+      } else if (!parse_u64(b, last) || last < first) {
+        return ignored();
+      }
+      any_valid = true;
+      if (first >= size) continue;
+      r.first = first;
+      r.last = last >= size ? size - 1 : last;
+    }
+
+    out.push_back(r);
+    if (out.size() > max_ranges) return ignored();
+  }
+
+  if (!any_valid) return RangeResult::None;
+  return out.empty() ? RangeResult::Unsatisfiable : RangeResult::Satisfiable;
+}
+
+bool if_range_matches(std::string_view value, const std::string& etag, const std::string& last_modified) {
+  const std::string_view v = trim(value);
+  if (v.empty()) return true;
+  return v == etag || v == last_modified;
+}
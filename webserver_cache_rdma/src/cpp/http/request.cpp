@@ -1,8 +1,13 @@
 #include "../../headers/http/request.hpp"
 #include "../../headers/http/headers.hpp"
+#include <algorithm>
 
-std::string HttpRequest::header(const std::string& name) const {
-  auto it = headers.find(header_lower(name));
-  if (it != headers.end()) return it->second;
+std::string_view HttpRequest::header(std::string_view name) const {
+  for (std::size_t i = more_headers.size(); i-- > 0;) {
+    if (header_iequals(more_headers[i].name, name)) return more_headers[i].value;
+  }
+  for (std::size_t i = std::min(header_count, kInlineHeaders); i-- > 0;) {
+    if (header_iequals(headers[i].name, name)) return headers[i].value;
+  }
   return {};
-}
\ No newline at end of file
+}
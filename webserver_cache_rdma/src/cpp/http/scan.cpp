@@ -0,0 +1,199 @@
+#include "../../headers/http/scan.hpp"
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define HTTP_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// ---- scalar ----
+
+static const char* find_head_end_scalar(const char* p, const char* end) {
+  while (end - p >= 4) {
+    const void* cr = std::memchr(p, '\r', static_cast<std::size_t>(end - p - 3));
+    if (!cr) break;
+    p = static_cast<const char*>(cr);
+    if (p[1] == '\n' && p[2] == '\r' && p[3] == '\n') return p;
+    ++p;
+  }
+  return end;
+}
+
+static const char* find_crlf_scalar(const char* p, const char* end) {
+  while (end - p >= 2) {
+    const void* cr = std::memchr(p, '\r', static_cast<std::size_t>(end - p - 1));
+    if (!cr) break;
+    p = static_cast<const char*>(cr);
+    if (p[1] == '\n') return p;
+    ++p;
+  }
+  return end;
+}
+
+static const char* skip_token_scalar(const char* p, const char* end) {
+  while (p < end && is_token_char(*p)) ++p;
+  return p;
+}
+
+static const ScanKernels kScalar{"scalar", find_head_end_scalar, find_crlf_scalar, skip_token_scalar};
+
+#ifdef HTTP_SCAN_X86
+
+// ---- SSE4.2 ----
+// PCMPESTRI does substring and character-range matching 16 bytes at a time.
+
+// Skips 16-byte blocks that cannot hold the start of `needle` and returns
+// where the match, if any, begins; the scalar scan confirms and finishes.
+__attribute__((target("sse4.2")))
+static const char* skip_to_needle_sse42(const char* p, const char* end, const char* needle, int len) {
+  const __m128i n = _mm_loadu_si128(reinterpret_cast<const __m128i*>(needle));
+  while (end - p >= 16) {
+    const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const int i = _mm_cmpestri(n, len, h, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ORDERED);
+    if (i == 16) {
+      p += 16;
+    } else if (i <= 16 - len) {
+      return p + i;
+    } else {
+      p += i;  // needle may continue past this block; re-examine from its start
+    }
+  }
+  return p;
+}
+
+__attribute__((target("sse4.2")))
+static const char* find_head_end_sse42(const char* p, const char* end) {
+  alignas(16) static const char needle[16] = "\r\n\r\n";
+  return find_head_end_scalar(skip_to_needle_sse42(p, end, needle, 4), end);
+}
+
+__attribute__((target("sse4.2")))
+static const char* find_crlf_sse42(const char* p, const char* end) {
+  alignas(16) static const char needle[16] = "\r\n";
+  return find_crlf_scalar(skip_to_needle_sse42(p, end, needle, 2), end);
+}
+
+__attribute__((target("sse4.2")))
+static const char* skip_token_sse42(const char* p, const char* end) {
+  // Ranges covering every non-tchar byte. '{'..0xFF also catches '|' and
+  // '~', which are tchars, so each hit is confirmed with is_token_char().
+  static const char ranges[16] = {
+    '\x00', ' ', '"', '"', '(', ')', ',', ',', '/', '/', ':', '@', '[', ']', '{', '\xff'};
+  const __m128i r = _mm_loadu_si128(reinterpret_cast<const __m128i*>(ranges));
+  while (end - p >= 16) {
+    const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const int i = _mm_cmpestri(r, 16, h, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+    if (i == 16) {
+      p += 16;
+      continue;
+    }
+    p += i;
+    if (!is_token_char(*p)) return p;
+    ++p;
+  }
+  return skip_token_scalar(p, end);
+}
+
+static const ScanKernels kSse42{"sse4.2", find_head_end_sse42, find_crlf_sse42, skip_token_sse42};
+
+// ---- AVX2 ----
+// Compares 32 shifted windows at once; movemask turns matches into bits.
+
+__attribute__((target("avx2")))
+static const char* find_head_end_avx2(const char* p, const char* end) {
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  while (end - p >= 35) {
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+    const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+    const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 3));
+    const __m256i m = _mm256_and_si256(
+      _mm256_and_si256(_mm256_cmpeq_epi8(a, cr), _mm256_cmpeq_epi8(b, lf)),
+      _mm256_and_si256(_mm256_cmpeq_epi8(c, cr), _mm256_cmpeq_epi8(d, lf)));
+    const auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+    if (bits) return p + __builtin_ctz(bits);
+    p += 32;
+  }
+  return find_head_end_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* find_crlf_avx2(const char* p, const char* end) {
+  const __m256i cr = _mm256_set1_epi8('\r');
+  const __m256i lf = _mm256_set1_epi8('\n');
+  while (end - p >= 33) {
+    const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+    const __m256i m = _mm256_and_si256(_mm256_cmpeq_epi8(a, cr), _mm256_cmpeq_epi8(b, lf));
+    const auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(m));
+    if (bits) return p + __builtin_ctz(bits);
+    p += 32;
+  }
+  return find_crlf_scalar(p, end);
+}
+
+// tchar membership as a nibble lookup: c is a tchar iff lo[c & 15] and
+// high_bit[c >> 4] share a bit. Bytes >= 0x80 have no bit in high_bit.
+struct TokenTables {
+  alignas(16) std::uint8_t lo[16];
+  alignas(16) std::uint8_t high_bit[16];
+};
+
+static constexpr TokenTables make_token_tables() {
+  TokenTables t{};
+  for (int c = 0; c < 128; ++c) {
+    if (is_token_char(static_cast<char>(c))) t.lo[c & 15] |= static_cast<std::uint8_t>(1u << (c >> 4));
+  }
+  for (int h = 0; h < 8; ++h) t.high_bit[h] = static_cast<std::uint8_t>(1u << h);
+  return t;
+}
+
+static constexpr TokenTables kTokenTables = make_token_tables();
+
+__attribute__((target("avx2")))
+static const char* skip_token_avx2(const char* p, const char* end) {
+  const __m256i lo_lut = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kTokenTables.lo)));
+  const __m256i hi_lut = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(kTokenTables.high_bit)));
+  const __m256i nibble = _mm256_set1_epi8(0x0F);
+  const __m256i zero = _mm256_setzero_si256();
+  while (end - p >= 32) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const __m256i lo = _mm256_shuffle_epi8(lo_lut, _mm256_and_si256(v, nibble));
+    const __m256i hi = _mm256_shuffle_epi8(hi_lut, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+    const __m256i bad = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), zero);
+    const auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(bad));
+    if (bits) return p + __builtin_ctz(bits);
+    p += 32;
+  }
+  return skip_token_scalar(p, end);
+}
+
+static const ScanKernels kAvx2{"avx2", find_head_end_avx2, find_crlf_avx2, skip_token_avx2};
+
+#endif // HTTP_SCAN_X86
+
+static const ScanKernels& select_kernels() {
+#ifdef HTTP_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) return kAvx2;
+  if (__builtin_cpu_supports("sse4.2")) return kSse42;
+#endif
+  return kScalar;
+}
+
+const ScanKernels& scan_kernels() {
+  static const ScanKernels& k = select_kernels();
+  return k;
+}
+
+std::vector<const ScanKernels*> available_scan_kernels() {
+  std::vector<const ScanKernels*> all{&kScalar};
+#ifdef HTTP_SCAN_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse4.2")) all.push_back(&kSse42);
+  if (__builtin_cpu_supports("avx2")) all.push_back(&kAvx2);
+#endif
+  return all;
+}
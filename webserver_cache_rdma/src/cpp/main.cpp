@@ -1,20 +1,49 @@
 #include <boost/asio.hpp>
 #include <fmt/core.h>
+#include <algorithm>
 #include <thread>
 #include <vector>
 #include <string>
 #include <cstdlib>
+#include <memory>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 #include "../headers/server.hpp"
 #include "../headers/signals.hpp"
 #include "../headers/util/config.hpp"
 #include "../headers/util/metrics.hpp"
+#include "../headers/util/logging.hpp"
 #include "../headers/cache/lru_cache.hpp"
+#include "../headers/cache/single_flight.hpp"
+#include "../headers/cache/compression.hpp"
+#include "../headers/fs/doc_root_watcher.hpp"
+#include "../headers/fs/path_resolver.hpp"
+#include "../headers/fs/file_load_pool.hpp"
+#include "../headers/fs/uring_reader.hpp"
+#include "../headers/http/scan.hpp"
 
 #ifdef ENABLE_RDMA
 #include "../headers/rdma/rdma_server.hpp"
 #endif
 
+// Best effort: an unpinned worker still works, it just may migrate.
+static void pin_to_core(unsigned index) {
+#ifdef __linux__
+  const unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(index % cpus, &set);
+  if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+    log_warn("could not pin worker {} to a core", index);
+  }
+#else
+  (void)index;
+#endif
+}
+
 int main(int argc, char** argv) {
   try {
     Config cfg = parse_args(argc, argv);
@@ -22,15 +51,73 @@ int main(int argc, char** argv) {
       cfg.threads = std::max(1u, std::thread::hardware_concurrency());
     }
 
-    fmt::print("[info] Starting webserver port={}, threads={}, doc_root='{}', mem_cache={} MB, timeouts: read={}ms write={}ms keepalive={}ms\n",
-               cfg.port, cfg.threads, cfg.doc_root, cfg.cache_mem_mb,
-               cfg.read_timeout_ms, cfg.write_timeout_ms, cfg.keepalive_timeout_ms);
+    LogLevel level;
+    if (!parse_log_level(cfg.log_level, level)) {
+      throw std::invalid_argument("unknown log level: " + cfg.log_level);
+    }
+    Logger& logger = Logger::instance();
+    logger.set_level(level);
+    logger.set_rate_limit(cfg.log_rate_limit);
+    std::string log_err;
+    if (!logger.start(cfg.access_log, log_err)) {
+      throw std::runtime_error("cannot open access log " + log_err);
+    }
+
+    log_info("Starting webserver port={}, threads={}, doc_root='{}', mem_cache={} MB x {} shards ({}), timeouts: read={}ms write={}ms keepalive={}ms",
+             cfg.port, cfg.threads, cfg.doc_root, cfg.cache_mem_mb, cfg.cache_shards, cfg.cache_policy,
+             cfg.read_timeout_ms, cfg.write_timeout_ms, cfg.keepalive_timeout_ms);
+    log_info("HTTP scanner: {}", scan_kernels().name);
+    if (cfg.io_uring && !io_uring_available()) {
+      log_warn("--io-uring ignored: built without ENABLE_IO_URING");
+    }
+    if (cfg.cache_compress && !cache_compression_available()) {
+      log_warn("--cache.compress ignored: built without ENABLE_CACHE_COMPRESSION");
+    }
 #ifdef ENABLE_RDMA
-    fmt::print("[info] RDMA: enabled={}, bind={}, port={}, pollers={}\n",
-               (cfg.rdma_enable ? "true" : "false"), cfg.rdma_bind, cfg.rdma_port, cfg.rdma_pollers);
+    log_info("RDMA: enabled={}, bind={}, port={}, pollers={}",
+             (cfg.rdma_enable ? "true" : "false"), cfg.rdma_bind, cfg.rdma_port, cfg.rdma_pollers);
 #endif
 
-    auto shared_cache = std::make_shared<LRUCache>(static_cast<std::size_t>(cfg.cache_mem_mb) * 1024ull * 1024ull);
+    auto shared_cache = std::make_shared<LRUCache>(static_cast<std::size_t>(cfg.cache_mem_mb) * 1024ull * 1024ull,
+                                                   cfg.cache_shards, cfg.cache_policy);
+    auto flights = std::make_shared<SingleFlight>();
+
+    boost::asio::io_context ioc;
+
+    // Resolved paths may only be remembered while changes are being reported.
+    DocRootWatcher watcher{ioc, cfg.doc_root};
+    bool watching = false;
+    if (cfg.watch_doc_root) {
+      watcher.add_listener([shared_cache](const std::string& url_path, bool is_dir) {
+        invalidate_cached_path(*shared_cache, url_path, is_dir);
+        Metrics::instance().cache_invalidations.fetch_add(1, std::memory_order_relaxed);
+      });
+      watching = watcher.start();
+    }
+    auto paths = std::make_shared<PathResolver>(cfg.doc_root, watching, cfg.negative_cache_entries,
+                                                std::chrono::milliseconds(cfg.negative_cache_ttl_ms));
+    watcher.add_listener([paths](const std::string& url_path, bool is_dir) {
+      paths->invalidate(url_path, is_dir);
+    });
+
+    // Cache misses are read off the io_context threads: through io_uring
+    // if asked for, else by the loader pool; inline only if both are off.
+    std::shared_ptr<AsyncFileReader> files;
+    std::shared_ptr<FileLoadPool> loaders;
+    if (cfg.io_uring && io_uring_available()) {
+      std::string err;
+      files = UringReader::create(ioc, 256, err);
+      if (!files) {
+        log_warn("io_uring unavailable ({}), using loader threads", err);
+      }
+    }
+    if (!files && cfg.file_load_threads > 0) {
+      loaders = std::make_shared<FileLoadPool>(cfg.file_load_threads, cfg.file_load_queue);
+      files = loaders;
+    }
+    if (files) {
+      log_info("Cache misses read via {}", files->name());
+    }
 
 #ifdef ENABLE_RDMA
     std::unique_ptr<rdma_fast::RDMAServer> rdma_srv;
@@ -40,38 +127,62 @@ int main(int argc, char** argv) {
       rc.port = cfg.rdma_port;
       rc.cq_depth = 512;
       rc.poller_threads = cfg.rdma_pollers;
-      rdma_srv = std::make_unique<rdma_fast::RDMAServer>(rc, cfg, shared_cache);
+      rdma_srv = std::make_unique<rdma_fast::RDMAServer>(rc, cfg, shared_cache, flights, paths, files);
       rdma_srv->start();
     }
 #endif
 
-    boost::asio::io_context ioc;
-
     SignalHandler sigs{ioc};
     sigs.register_signals();
 
     Metrics::instance().reset();
 
-    Server server{ioc, cfg, shared_cache};
-    server.start();
-
     std::vector<std::thread> workers;
     workers.reserve(cfg.threads);
-    for (unsigned i = 0; i < cfg.threads; ++i) {
-      workers.emplace_back([&ioc] {
-        ioc.run();
-      });
-    }
+    if (cfg.thread_per_core) {
+      // Each worker owns an io_context and a listener on the shared port.
+      // `ioc` keeps the signal handler and doc_root watcher on this thread.
+      log_info("Thread-per-core: {} SO_REUSEPORT listeners", cfg.threads);
+      std::vector<std::unique_ptr<boost::asio::io_context>> cores;
+      std::vector<std::unique_ptr<Server>> servers;
+      for (unsigned i = 0; i < cfg.threads; ++i) {
+        cores.push_back(std::make_unique<boost::asio::io_context>(1));
+        servers.push_back(std::make_unique<Server>(*cores.back(), cfg, shared_cache, flights, paths, files));
+        servers.back()->start();
+        sigs.stop_also(*cores.back());
+      }
+      for (unsigned i = 0; i < cfg.threads; ++i) {
+        workers.emplace_back([core = cores[i].get(), i] {
+          pin_to_core(i);
+          core->run();
+        });
+      }
+      ioc.run();
+      for (auto& t : workers) t.join();
+    } else {
+      Server server{ioc, cfg, shared_cache, flights, paths, files};
+      server.start();
 
-    for (auto& t : workers) t.join();
+      for (unsigned i = 0; i < cfg.threads; ++i) {
+        workers.emplace_back([&ioc] {
+          ioc.run();
+        });
+      }
+      for (auto& t : workers) t.join();
+    }
 
+    // Loads still running hold sessions and RDMA connections; let them
+    // finish before those go away.
+    if (loaders) loaders->stop();
 #ifdef ENABLE_RDMA
     if (rdma_srv) rdma_srv->stop();
 #endif
 
-    fmt::print("[info] Webserver stopped\n");
+    log_info("Webserver stopped");
+    logger.stop();
     return 0;
   } catch (const std::exception& ex) {
+    Logger::instance().stop();
     fmt::print(stderr, "[fatal] {}\n", ex.what());
     return 1;
   }
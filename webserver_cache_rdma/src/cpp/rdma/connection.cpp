@@ -5,11 +5,13 @@
 #include "../../headers/fs/path_utils.hpp"
 #include "../../headers/fs/file_reader.hpp"
 #include "../../headers/util/metrics.hpp"
+#include "../../headers/util/logging.hpp"
 #include <cstring>
-#include <fmt/core.h>
 #include <infiniband/verbs.h>
 
 #include "../../headers/cache/lru_cache.hpp"
+#include "../../headers/cache/segment_reader.hpp"
+#include "../../headers/cache/compression.hpp"
 #include "../../headers/util/config.hpp"
 
 namespace rdma_fast {
@@ -35,8 +37,12 @@ Connection::Connection(RDMAServer* srv,
                        ibv_pd* pd,
                        ibv_cq* cq,
                        const Config& cfg,
-                       std::shared_ptr<LRUCache> cache)
-  : server_(srv), id_(id), pd_(pd), cq_(cq), cfg_(cfg), cache_(std::move(cache)) {}
+                       std::shared_ptr<LRUCache> cache,
+                       std::shared_ptr<SingleFlight> flights,
+                       std::shared_ptr<PathResolver> paths,
+                       std::shared_ptr<AsyncFileReader> files)
+  : server_(srv), id_(id), pd_(pd), cq_(cq), cfg_(cfg), cache_(std::move(cache)), flights_(std::move(flights)),
+    paths_(std::move(paths)), files_(std::move(files)) {}
 
 Connection::~Connection() {
   close();
@@ -50,7 +56,7 @@ bool Connection::init() {
       recv_pool_.push_back(std::make_unique<Buffer>(pd_, static_cast<size_t>(cfg_.rdma_recv_buf_size)));
     }
   } catch (const std::exception& ex) {
-    fmt::print(stderr, "[rdma] recv pool alloc failed: {}\n", ex.what());
+    log_warn("[rdma] recv pool alloc failed: {}", ex.what());
     return false;
   }
   return post_recvs(cfg_.rdma_recv_bufs_per_conn);
@@ -97,21 +103,10 @@ void Connection::on_recv_complete(RecvWork* w, uint32_t byte_len) {
   Buffer* buf = work->buf;
 
   // Parse request (can be less than buffer size)
-  Request req;
-  bool ok = parse_request(buf->data, byte_len, req);
-  if (!ok) {
-    // Malformed -> send error header with status 400 and no body
-    send_header(400, 0, 0);
-  } else {
-    Metrics::instance().rdma_reqs.fetch_add(1, std::memory_order_relaxed);
-    if (req.op == Op::PING) {
-      handle_ping();
-    } else if (req.op == Op::GET) {
-      handle_get(req.path);
-    } else {
-      send_header(400, 0, 0);
-    }
-  }
+  Pending p;
+  p.received = std::chrono::steady_clock::now();
+  p.parsed = parse_request(buf->data, byte_len, p.req);
+  if (p.parsed) Metrics::instance().rdma_reqs.fetch_add(1, std::memory_order_relaxed);
 
   // Reuse buffer: repost RECV
   {
@@ -120,6 +115,67 @@ void Connection::on_recv_complete(RecvWork* w, uint32_t byte_len) {
     --recv_inflight_;
     post_recvs(1);
   }
+
+  dispatch(std::move(p));
+}
+
+// Responses must not interleave on the QP, so requests are answered one
+// at a time in arrival order; while a GET waits on a file load, requests
+// received after it queue here instead of stalling the poller.
+void Connection::dispatch(Pending p) {
+  {
+    std::lock_guard<std::mutex> g(order_mtx_);
+    if (busy_) {
+      waiting_.push_back(std::move(p));
+      return;
+    }
+    busy_ = true;
+  }
+  if (handle(p)) next_request();
+}
+
+void Connection::next_request() {
+  for (;;) {
+    Pending p;
+    {
+      std::lock_guard<std::mutex> g(order_mtx_);
+      if (waiting_.empty()) {
+        busy_ = false;
+        return;
+      }
+      p = std::move(waiting_.front());
+      waiting_.pop_front();
+    }
+    if (!handle(p)) return;
+  }
+}
+
+bool Connection::handle(const Pending& p) {
+  if (!p.parsed) {
+    // Malformed -> send error header with status 400 and no body
+    send_header(400, 0, 0);
+    return true;
+  }
+  if (p.req.op == Op::PING) {
+    handle_ping();
+    return true;
+  }
+  if (p.req.op == Op::GET) {
+    get_received_ = p.received;
+    get_hit_ = false;
+    if (!handle_get(p.req.path)) return false;
+    record_get();
+    return true;
+  }
+  send_header(400, 0, 0);
+  return true;
+}
+
+void Connection::record_get() {
+  const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now() - get_received_).count();
+  Metrics::instance().rdma_get_service[Metrics::rdma_series(get_hit_, last_status_)].record(
+    static_cast<std::uint64_t>(us));
 }
 
 void Connection::handle_ping() {
@@ -127,55 +183,198 @@ void Connection::handle_ping() {
   Metrics::instance().rdma_ok.fetch_add(1, std::memory_order_relaxed);
 }
 
-void Connection::handle_get(const std::string& url_path) {
+bool Connection::handle_get(const std::string& url_path) {
   // Map and serve, same as HTTP path
-  auto mapped = map_url_to_fs(cfg_.doc_root, url_path);
+  auto mapped_ptr = paths_->resolve(url_path);
+  const PathMapResult& mapped = *mapped_ptr;
   if (!mapped.ok) {
     send_header(400, 0, 0);
     Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
-    return;
+    return true;
   }
   if (!mapped.exists) {
     send_header(404, 0, 0);
     Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
-    return;
+    return true;
   }
 
   const std::string cache_key = mapped.cache_key;
+  const std::string fs_path = mapped.fs_path;
   LRUCache::Entry entry;
-  if (!cache_->get(cache_key, entry)) {
-    auto fr = read_file(mapped.fs_path);
-    if (!fr.ok) {
-      send_header(500, 0, 0);
-      Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
-      return;
+  if (cache_->get(cache_key, entry)) {
+    // A manifest hit is checked against the file, as on the HTTP path.
+    FileOpenResult current;
+    if (entry.segment_size == 0 || manifest_matches(entry, current = open_file(fs_path))) {
+      get_hit_ = true;
+      return serve_entry(cache_key, fs_path, std::move(entry), std::move(current));
     }
-    LRUCache::Entry ne;
-    ne.body = std::make_shared<std::vector<uint8_t>>(std::move(fr.data));
-    ne.size = ne.body->size();
-    ne.last_modified = fr.last_modified;
-    ne.etag = make_etag(ne.size, ne.last_modified);
-    cache_->put(cache_key, ne);
-    entry = std::move(ne);
+    cache_->erase_file(cache_key);
+  }
+
+  // Taken before the file is opened, as on the HTTP path: a load the
+  // watcher invalidates meanwhile is answered but not cached.
+  const std::uint64_t epoch = cache_->epoch(cache_key);
+  FileOpenResult opened = open_file(fs_path);
+  if (!opened.ok) {
+    send_header(500, 0, 0);
+    Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  if (cfg_.cache_segment_bytes > 0 && opened.size > cfg_.cache_segment_bytes) {
+    entry = make_segment_manifest(opened.size, opened.last_modified, cfg_.cache_segment_bytes);
+    cache_->put(cache_key, entry, epoch);
+    return serve_entry(cache_key, fs_path, std::move(entry), std::move(opened));
+  }
+  // A segmented file's bytes are counted segment by segment as they miss.
+  Metrics::instance().cache_miss_bytes.fetch_add(opened.size, std::memory_order_relaxed);
+
+  // The leader's thread (HTTP, io_uring or a loader) only hands the result
+  // over; the answer is sent from a poller thread, like every other one.
+  auto self = shared_from_this();
+  auto waiter = [self, cache_key, fs_path](const FlightResult& loaded) {
+    self->server_->post([self, cache_key, fs_path, loaded] {
+      if (self->serve_loaded(cache_key, fs_path, loaded)) self->finish_get();
+    });
+  };
+  if (!flights_->join(cache_key, waiter)) return false;
+
+  if (files_) {
+    files_->read(std::move(opened), [self, cache_key, fs_path, epoch](FileReadResult fr) {
+      self->server_->post([self, cache_key, fs_path, epoch, fr = std::move(fr)]() mutable {
+        FlightResult loaded = self->load_into_cache(cache_key, std::move(fr), epoch);
+        self->flights_->complete(cache_key, loaded);
+        if (self->serve_loaded(cache_key, fs_path, loaded)) self->finish_get();
+      });
+    });
+    return false;
   }
+  FlightResult loaded = load_into_cache(cache_key, read_file(opened), epoch);
+  flights_->complete(cache_key, loaded);
+  return serve_loaded(cache_key, fs_path, loaded);
+}
+
+void Connection::finish_get() {
+  record_get();
+  next_request();
+}
+
+FlightResult Connection::load_into_cache(const std::string& cache_key, FileReadResult fr, std::uint64_t epoch) {
+  FlightResult loaded;
+  if (!fr.ok) {
+    loaded.error = fr.error;
+    loaded.overloaded = fr.overloaded;
+    return loaded;
+  }
+  LRUCache::Entry& ne = loaded.entry;
+  ne.body = std::make_shared<std::vector<uint8_t>>(std::move(fr.data));
+  ne.size = ne.body->size();
+  ne.last_modified = fr.last_modified;
+  ne.etag = make_etag(ne.size, ne.last_modified);
+  cache_->put(cache_key, ne, epoch);
+  loaded.ok = true;
+  return loaded;
+}
 
-  uint64_t total = entry.body->size();
-  uint32_t chunk = static_cast<uint32_t>(std::max(1, std::min(cfg_.rdma_send_chunk, static_cast<int>(total))));
+struct Connection::SegmentSend {
+  std::shared_ptr<SegmentReader> reader;
+  uint64_t total = 0;
+  uint32_t chunk = 0;
+  uint64_t off = 0;             // of the chunk being filled
+  std::unique_ptr<Buffer> buf;  // that chunk, `filled` bytes of it so far
+  size_t filled = 0;
+};
+
+bool Connection::serve_loaded(const std::string& cache_key, const std::string& fs_path, const FlightResult& loaded) {
+  if (!loaded.ok) {
+    send_header(loaded.overloaded ? 503 : 500, 0, 0);
+    Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+  return serve_entry(cache_key, fs_path, loaded.entry, FileOpenResult{});
+}
+
+bool Connection::serve_entry(const std::string& cache_key, const std::string& fs_path, LRUCache::Entry entry,
+                             FileOpenResult opened) {
+  if (!inflate_entry(entry)) {
+    send_header(500, 0, 0);
+    Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  uint64_t total = entry.size;
+  uint32_t chunk = static_cast<uint32_t>(std::max<uint64_t>(1, std::min<uint64_t>(static_cast<uint64_t>(cfg_.rdma_send_chunk), total)));
   if (!send_header(200, total, chunk)) {
     Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
-    return;
+    return true;
+  }
+  if (total > 0 && entry.segment_size > 0) {
+    auto st = std::make_shared<SegmentSend>();
+    st->reader = std::make_shared<SegmentReader>(cache_, flights_, files_, cache_key, fs_path, entry,
+                                                 std::move(opened));
+    st->total = total;
+    st->chunk = chunk;
+    return send_segments(st);
   }
   if (total > 0) {
-    if (!send_body_chunks(entry.body, chunk)) {
+    const auto& body = entry.body;
+    const bool sent = send_body_chunks(total, chunk, [&body](uint64_t off, uint8_t* dst, size_t n) {
+      std::memcpy(dst, body->data() + off, n);
+      return true;
+    });
+    if (!sent) {
       Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
-      return;
+      return true;
     }
   }
   Metrics::instance().rdma_ok.fetch_add(1, std::memory_order_relaxed);
   Metrics::instance().rdma_bytes.fetch_add(total, std::memory_order_relaxed);
+  return true;
+}
+
+// Chunks are filled across segment boundaries so the client still sees
+// exactly ceil(total / chunk) SENDs. Returns false while a segment loads;
+// the rest is then sent, and the GET finished, from a poller thread.
+bool Connection::send_segments(const std::shared_ptr<SegmentSend>& st) {
+  while (st->off < st->total) {
+    const size_t n = static_cast<size_t>(std::min<uint64_t>(st->chunk, st->total - st->off));
+    if (!st->buf) {
+      st->buf = std::make_unique<Buffer>(pd_, n);
+      st->filled = 0;
+    }
+    size_t copied = 0;
+    std::string err;
+    const auto resolved = st->reader->copy(st->off + st->filled, reinterpret_cast<uint8_t*>(st->buf->data) + st->filled,
+                                           n - st->filled, copied, err);
+    st->filled += copied;
+    if (resolved == SegmentReader::Slice::failed) {
+      Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    if (resolved == SegmentReader::Slice::missing) {
+      auto self = shared_from_this();
+      st->reader->load(st->off + st->filled, [self, st](const FlightResult& loaded) {
+        self->server_->post([self, st, ok = loaded.ok] {
+          // The header is out: a failed load can only cut the body short.
+          if (!ok) Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
+          else if (!self->send_segments(st)) return;
+          self->finish_get();
+        });
+      });
+      return false;
+    }
+    if (!post_chunk(std::move(st->buf), n)) {
+      Metrics::instance().rdma_err.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+    st->off += n;
+  }
+  Metrics::instance().rdma_ok.fetch_add(1, std::memory_order_relaxed);
+  Metrics::instance().rdma_bytes.fetch_add(st->total, std::memory_order_relaxed);
+  return true;
 }
 
 bool Connection::send_header(uint16_t status, uint64_t content_len, uint32_t chunk) {
+  last_status_ = status;
   auto header_bytes = make_resp_header(status, content_len, chunk);
   auto b = std::make_unique<Buffer>(pd_, header_bytes.size());
   std::memcpy(b->data, header_bytes.data(), header_bytes.size());
@@ -207,48 +406,51 @@ bool Connection::send_header(uint16_t status, uint64_t content_len, uint32_t chu
   return true;
 }
 
-bool Connection::send_body_chunks(const std::shared_ptr<std::vector<uint8_t>>& body, uint32_t chunk) {
-  std::lock_guard<std::mutex> g(mtx_);
-  size_t off = 0;
-  const size_t total = body->size();
+bool Connection::send_body_chunks(uint64_t total, uint32_t chunk, const ChunkFill& fill) {
+  uint64_t off = 0;
 
   while (off < total) {
-    const size_t n = std::min(static_cast<size_t>(chunk), total - off);
+    const size_t n = static_cast<size_t>(std::min<uint64_t>(chunk, total - off));
 
+    // Fill outside the lock.
     auto b = std::make_unique<Buffer>(pd_, n);
-    std::memcpy(b->data, body->data() + off, n);
-
-    ibv_sge sge{};
-    sge.addr = reinterpret_cast<uint64_t>(b->data);
-    sge.length = static_cast<uint32_t>(n);
-    sge.lkey = b->mr->lkey;
+    if (!fill(off, reinterpret_cast<uint8_t*>(b->data), n)) return false;
+    if (!post_chunk(std::move(b), n)) return false;
+    off += n;
+  }
+  return true;
+}
 
-    auto work = new SendWork(shared_from_this(), b.get());
+bool Connection::post_chunk(std::unique_ptr<Buffer> b, size_t n) {
+  ibv_sge sge{};
+  sge.addr = reinterpret_cast<uint64_t>(b->data);
+  sge.length = static_cast<uint32_t>(n);
+  sge.lkey = b->mr->lkey;
 
-    ibv_send_wr wr{}, *bad=nullptr;
-    wr.sg_list = &sge;
-    wr.num_sge = 1;
-    wr.opcode = IBV_WR_SEND;
-    wr.send_flags = IBV_SEND_SIGNALED;
-    wr.wr_id = reinterpret_cast<uint64_t>(work);
+  auto work = new SendWork(shared_from_this(), b.get());
 
-    // Flow control: limit outstanding sends
-    if (sends_inflight_ >= cfg_.rdma_max_outstanding_sends) {
-      // Stop posting more now; queue buffer and let on_send_complete post later
-      send_queue_.push_back(SendItem{std::move(b)});
-      // Store wr details by re-creating when dequeued; to keep simple, we post immediately but rely on HCA queue.
-      // Simpler approach: post and rely on HCA; still enforce a high watermark.
-    }
+  ibv_send_wr wr{}, *bad=nullptr;
+  wr.sg_list = &sge;
+  wr.num_sge = 1;
+  wr.opcode = IBV_WR_SEND;
+  wr.send_flags = IBV_SEND_SIGNALED;
+  wr.wr_id = reinterpret_cast<uint64_t>(work);
 
-    if (ibv_post_send(id_->qp, &wr, &bad)) {
-      delete work;
-      return false;
-    }
-    ++sends_inflight_;
+  std::lock_guard<std::mutex> g(mtx_);
+  // Flow control: limit outstanding sends
+  if (sends_inflight_ >= cfg_.rdma_max_outstanding_sends) {
+    // Stop posting more now; queue buffer and let on_send_complete post later
     send_queue_.push_back(SendItem{std::move(b)});
+    // Store wr details by re-creating when dequeued; to keep simple, we post immediately but rely on HCA queue.
+    // Simpler approach: post and rely on HCA; still enforce a high watermark.
+  }
 
-    off += n;
+  if (ibv_post_send(id_->qp, &wr, &bad)) {
+    delete work;
+    return false;
   }
+  ++sends_inflight_;
+  send_queue_.push_back(SendItem{std::move(b)});
   return true;
 }
 
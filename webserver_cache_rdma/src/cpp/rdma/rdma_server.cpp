@@ -2,9 +2,12 @@
 
 #include "../../headers/rdma/rdma_server.hpp"
 #include "../../headers/rdma/connection.hpp"
-#include <fmt/core.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
 #include <cstring>
 #include <stdexcept>
 #include <chrono>
@@ -13,6 +16,7 @@
 
 
 #include "../../headers/util/config.hpp"
+#include "../../headers/util/logging.hpp"
 #include "../../headers/cache/lru_cache.hpp"
 
 template <>
@@ -31,8 +35,11 @@ namespace rdma_fast {
     return addr;
   }
 
-  RDMAServer::RDMAServer(const RDMAConfig &cfg, const Config &app_cfg, std::shared_ptr<LRUCache> cache)
-    : cfg_(cfg), app_cfg_(app_cfg), cache_(std::move(cache)) {
+  RDMAServer::RDMAServer(const RDMAConfig &cfg, const Config &app_cfg, std::shared_ptr<LRUCache> cache,
+                         std::shared_ptr<SingleFlight> flights, std::shared_ptr<PathResolver> paths,
+                         std::shared_ptr<AsyncFileReader> files)
+    : cfg_(cfg), app_cfg_(app_cfg), cache_(std::move(cache)), flights_(std::move(flights)),
+      paths_(std::move(paths)), files_(std::move(files)) {
   }
 
   RDMAServer::~RDMAServer() {
@@ -42,6 +49,9 @@ namespace rdma_fast {
   void RDMAServer::start() {
     if (running_.exchange(true)) return;
 
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) throw std::runtime_error("eventfd failed");
+
     ec_ = rdma_create_event_channel();
     if (!ec_) throw std::runtime_error("rdma_create_event_channel failed");
 
@@ -54,8 +64,8 @@ namespace rdma_fast {
     if (rdma_listen(listen_id_, 64))
       throw std::runtime_error("rdma_listen failed");
 
-    fmt::print("[rdma] Listening on {}:{} (cq_depth={}, pollers={})\n",
-               cfg_.bind_addr, cfg_.port, cfg_.cq_depth, cfg_.poller_threads);
+    log_info("[rdma] Listening on {}:{} (cq_depth={}, pollers={})",
+             cfg_.bind_addr, cfg_.port, cfg_.cq_depth, cfg_.poller_threads);
 
     cm_thread_ = std::thread([this] { cm_event_loop_(); });
     for (int i = 0; i < cfg_.poller_threads; ++i)
@@ -69,6 +79,14 @@ namespace rdma_fast {
     for (auto &t: pollers_) if (t.joinable()) t.join();
     pollers_.clear();
 
+    {
+      // Continuations posted too late to run still hold their connections.
+      std::lock_guard<std::mutex> g(posted_mtx_);
+      posted_.clear();
+    }
+    ::close(wake_fd_);
+    wake_fd_ = -1;
+
     {
       std::lock_guard<std::mutex> g(conns_mtx_);
       conns_.clear();
@@ -96,7 +114,7 @@ namespace rdma_fast {
       ec_ = nullptr;
     }
 
-    fmt::print("[rdma] Stopped\n");
+    log_info("[rdma] Stopped");
   }
 
   void RDMAServer::cm_event_loop_() {
@@ -116,19 +134,21 @@ namespace rdma_fast {
           ibv_context *ctx = id->verbs;
           pd_ = ibv_alloc_pd(ctx);
           if (!pd_) {
-            fmt::print(stderr, "[rdma] ibv_alloc_pd failed\n");
+            log_error("[rdma] ibv_alloc_pd failed");
             rdma_reject(id, nullptr, 0);
             continue;
           }
           comp_ch_ = ibv_create_comp_channel(ctx);
           if (!comp_ch_) {
-            fmt::print(stderr, "[rdma] ibv_create_comp_channel failed\n");
+            log_error("[rdma] ibv_create_comp_channel failed");
             rdma_reject(id, nullptr, 0);
             continue;
           }
+          // Pollers wait on it with poll(), next to wake_fd_.
+          ::fcntl(comp_ch_->fd, F_SETFL, ::fcntl(comp_ch_->fd, F_GETFL) | O_NONBLOCK);
           cq_ = ibv_create_cq(ctx, cfg_.cq_depth, nullptr, comp_ch_, 0);
           if (!cq_) {
-            fmt::print(stderr, "[rdma] ibv_create_cq failed\n");
+            log_error("[rdma] ibv_create_cq failed");
             rdma_reject(id, nullptr, 0);
             continue;
           }
@@ -145,14 +165,14 @@ namespace rdma_fast {
         qp_attr.cap.max_recv_sge = 1;
 
         if (rdma_create_qp(id, pd_, &qp_attr)) {
-          fmt::print(stderr, "[rdma] rdma_create_qp failed\n");
+          log_error("[rdma] rdma_create_qp failed");
           rdma_reject(id, nullptr, 0);
           continue;
         }
 
-        auto conn = std::make_shared<Connection>(this, id, pd_, cq_, app_cfg_, cache_);
+        auto conn = std::make_shared<Connection>(this, id, pd_, cq_, app_cfg_, cache_, flights_, paths_, files_);
         if (!conn->init()) {
-          fmt::print(stderr, "[rdma] connection init failed\n");
+          log_error("[rdma] connection init failed");
           rdma_destroy_qp(id);
           rdma_reject(id, nullptr, 0);
           continue;
@@ -164,7 +184,7 @@ namespace rdma_fast {
         param.rnr_retry_count = 7;
 
         if (rdma_accept(id, &param)) {
-          fmt::print(stderr, "[rdma] rdma_accept failed\n");
+          log_error("[rdma] rdma_accept failed");
           rdma_destroy_qp(id);
           continue;
         }
@@ -174,7 +194,7 @@ namespace rdma_fast {
           conns_.insert(conn);
         }
 
-        fmt::print("[rdma] Accepted connection qp_num={}\n", conn->qp_num());
+        log_info("[rdma] Accepted connection qp_num={}", conn->qp_num());
       } else if (event == RDMA_CM_EVENT_DISCONNECTED) {
         // Find and remove the connection (shared_ptr will clean up)
         std::lock_guard<std::mutex> g(conns_mtx_);
@@ -188,21 +208,44 @@ namespace rdma_fast {
         }
         if (id->qp) rdma_destroy_qp(id);
         rdma_destroy_id(id);
-        fmt::print("[rdma] Disconnected\n");
+        log_info("[rdma] Disconnected");
       }
     }
   }
 
+  void RDMAServer::post(std::function<void()> fn) {
+    {
+      std::lock_guard<std::mutex> g(posted_mtx_);
+      posted_.push_back(std::move(fn));
+    }
+    const uint64_t one = 1;
+    if (::write(wake_fd_, &one, sizeof(one)) < 0) {
+      // EAGAIN: the counter is already nonzero, so a poller will wake anyway.
+    }
+  }
+
+  void RDMAServer::run_posted_() {
+    uint64_t n;
+    if (::read(wake_fd_, &n, sizeof(n)) < 0) return;  // another poller took the wakeup
+    std::deque<std::function<void()>> batch;
+    {
+      std::lock_guard<std::mutex> g(posted_mtx_);
+      batch.swap(posted_);
+    }
+    for (auto &fn: batch) fn();
+  }
+
   void RDMAServer::cq_poller_loop_() {
     while (running_) {
+      // The timeout lets stop() be noticed; a negative fd (no CQ yet) is skipped.
+      pollfd fds[2] = {{wake_fd_, POLLIN, 0}, {comp_ch_ ? comp_ch_->fd : -1, POLLIN, 0}};
+      if (::poll(fds, 2, 100) <= 0) continue;
+      if (fds[0].revents & POLLIN) run_posted_();
+      if (!(fds[1].revents & POLLIN)) continue;
+
       ibv_cq *cq = nullptr;
       void *cq_ctx = nullptr;
-      int rc = ibv_get_cq_event(comp_ch_, &cq, &cq_ctx);
-      if (rc) {
-        if (!running_) break;
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        continue;
-      }
+      if (ibv_get_cq_event(comp_ch_, &cq, &cq_ctx)) continue;  // EAGAIN: another poller got it
       ibv_ack_cq_events(cq, 1);
       ibv_req_notify_cq(cq, 0);
 
@@ -210,13 +253,13 @@ namespace rdma_fast {
         ibv_wc wc{};
         int n = ibv_poll_cq(cq, 32, &wc);
         if (n < 0) {
-          fmt::print(stderr, "[rdma] ibv_poll_cq error\n");
+          log_error("[rdma] ibv_poll_cq error");
           break;
         }
         if (n == 0) break;
 
         if (wc.status != IBV_WC_SUCCESS) {
-          fmt::print(stderr, "[rdma] CQE status {} wr_id {}\n", wc.status, wc.wr_id);
+          log_error("[rdma] CQE status {} wr_id {}", wc.status, wc.wr_id);
           // Free work item if present
           auto *base = reinterpret_cast<WorkBase *>(wc.wr_id);
           delete base;
@@ -1,44 +1,81 @@
 #include "../headers/server.hpp"
 #include "../headers/session.hpp"
-#include <fmt/core.h>
+#include "../headers/util/logging.hpp"
+#include <algorithm>
 
 using boost::asio::ip::tcp;
 
-Server::Server(boost::asio::io_context& ioc, const Config& cfg, std::shared_ptr<LRUCache> cache)
+Server::Server(boost::asio::io_context& ioc, const Config& cfg, std::shared_ptr<LRUCache> cache,
+               std::shared_ptr<SingleFlight> flights, std::shared_ptr<PathResolver> paths,
+               std::shared_ptr<AsyncFileReader> files)
   : ioc_(ioc),
     acceptor_(ioc),
-    cfg_(cfg),
-    cache_(std::move(cache)) {
+    cfg_(std::make_shared<const Config>(cfg)),
+    cache_(std::move(cache)),
+    flights_(std::move(flights)),
+    paths_(std::move(paths)),
+    files_(std::move(files)) {
 
   tcp::endpoint ep(tcp::v4(), cfg.port);
   boost::system::error_code ec;
   acceptor_.open(ep.protocol(), ec);
   if (ec) throw std::runtime_error("acceptor open failed: " + ec.message());
   acceptor_.set_option(tcp::acceptor::reuse_address(true), ec);
+  if (cfg.thread_per_core) {
+    // Every worker binds its own listener to the port; the kernel
+    // load-balances incoming connections across them.
+#ifdef SO_REUSEPORT
+    using reuse_port = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+    acceptor_.set_option(reuse_port(true), ec);
+    if (ec) throw std::runtime_error("SO_REUSEPORT failed: " + ec.message());
+#else
+    throw std::runtime_error("--thread-per-core needs SO_REUSEPORT");
+#endif
+  }
   acceptor_.bind(ep, ec);
   if (ec) throw std::runtime_error("bind failed: " + ec.message());
   acceptor_.listen(boost::asio::socket_base::max_listen_connections, ec);
   if (ec) throw std::runtime_error("listen failed: " + ec.message());
+
+  // A per-core server is run by one thread, so one wheel is never contended.
+  wheels_ = std::make_shared<TimerWheels>(ioc_, std::chrono::milliseconds(cfg.timer_tick_ms),
+                                          cfg.thread_per_core ? 1u : cfg.threads);
 }
 
 void Server::start() {
-  fmt::print("[info] Listening on 0.0.0.0:{}\n", cfg_.port);
+  log_info("Listening on 0.0.0.0:{}", cfg_->port);
+  wheels_->start();
   do_accept();
 }
 
 void Server::do_accept() {
-  acceptor_.async_accept(
-    [this](boost::system::error_code ec, tcp::socket socket) {
-      if (!ec) {
-        try {
-          auto ep = socket.remote_endpoint();
-          fmt::print("[info] Accepted {}:{}\n", ep.address().to_string(), ep.port());
-        } catch (...) {}
-        std::make_shared<Session>(std::move(socket), cfg_, cache_)->start();
-      } else {
-        fmt::print(stderr, "[warn] accept error: {}\n", ec.message());
-      }
-      do_accept();
-    }
-  );
-}
\ No newline at end of file
+  // A session's read, write, timer and single-flight handlers share state
+  // and must not run concurrently. With one io_context for all workers,
+  // each session gets a strand; a per-core io_context is run by one
+  // thread, so its sessions use the io_context's executor directly.
+  if (cfg_->thread_per_core) {
+    acceptor_.async_accept(ioc_.get_executor(),
+      [this](boost::system::error_code ec, CoreSession::Socket socket) {
+        on_accept<CoreSession>(ec, std::move(socket));
+      });
+  } else {
+    acceptor_.async_accept(boost::asio::make_strand(ioc_),
+      [this](boost::system::error_code ec, Session::Socket socket) {
+        on_accept<Session>(ec, std::move(socket));
+      });
+  }
+}
+
+template <class S>
+void Server::on_accept(boost::system::error_code ec, typename S::Socket socket) {
+  if (!ec) {
+    try {
+      auto ep = socket.remote_endpoint();
+      log_debug("Accepted {}:{}", ep.address().to_string(), ep.port());
+    } catch (...) {}
+    S::create(std::move(socket), cfg_, cache_, flights_, paths_, files_, wheels_)->start();
+  } else {
+    log_warn("accept error: {}", ec.message());
+  }
+  do_accept();
+}
@@ -3,99 +3,237 @@
 #include <boost/asio/buffer.hpp>
 #include <boost/asio/write.hpp>
 #include <filesystem>
+#include <cerrno>
+#include <atomic>
+#include <algorithm>
+#include <utility>
 #include "../headers/fs/path_utils.hpp"
 #include "../headers/fs/file_reader.hpp"
+#include "../headers/fs/file_sender.hpp"
+#include "../headers/cache/segment_reader.hpp"
+#include "../headers/cache/compression.hpp"
 #include "../headers/http/mime.hpp"
+#include "../headers/http/range.hpp"
+#include "../headers/http/conditional.hpp"
+#include "../headers/http/encoding.hpp"
 #include "../headers/http/response.hpp"
 #include "../headers/util/time.hpp"
 #include "../headers/util/metrics.hpp"
+#include "../headers/util/logging.hpp"
 
 using boost::asio::ip::tcp;
 
-Session::Session(tcp::socket socket, const Config& cfg, std::shared_ptr<LRUCache> cache)
+namespace {
+
+// Recycles the memory of closed sessions. allocate_shared puts a Session
+// and its control block in one block of fixed size, so freed blocks are
+// kept on a per-thread free list for the next accept; a session freed on
+// another thread simply feeds that thread's list.
+template <class T>
+struct SessionPoolAllocator {
+  using value_type = T;
+
+  SessionPoolAllocator() = default;
+  template <class U>
+  SessionPoolAllocator(const SessionPoolAllocator<U>&) noexcept {}
+
+  T* allocate(std::size_t n) {
+    if (n == 1) {
+      FreeList& fl = free_list();
+      if (fl.head) {
+        Block* b = fl.head;
+        fl.head = b->next;
+        --fl.count;
+        return reinterpret_cast<T*>(b);
+      }
+    }
+    return static_cast<T*>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(T* p, std::size_t n) noexcept {
+    FreeList& fl = free_list();
+    if (n == 1 && fl.count < kMaxFree) {
+      Block* b = reinterpret_cast<Block*>(p);
+      b->next = fl.head;
+      fl.head = b;
+      ++fl.count;
+      return;
+    }
+    ::operator delete(p);
+  }
+
+  template <class U>
+  bool operator==(const SessionPoolAllocator<U>&) const noexcept { return true; }
+  template <class U>
+  bool operator!=(const SessionPoolAllocator<U>&) const noexcept { return false; }
+
+private:
+  static constexpr std::size_t kMaxFree = 1024;
+  struct Block { Block* next; };
+  static_assert(sizeof(T) >= sizeof(Block), "block too small for the free list link");
+
+  struct FreeList {
+    Block* head = nullptr;
+    std::size_t count = 0;
+    ~FreeList() {
+      while (head) {
+        Block* next = head->next;
+        ::operator delete(head);
+        head = next;
+      }
+    }
+  };
+
+  static FreeList& free_list() {
+    thread_local FreeList fl;
+    return fl;
+  }
+};
+
+} // namespace
+
+template <class Executor>
+std::shared_ptr<BasicSession<Executor>> BasicSession<Executor>::create(
+    Socket socket, std::shared_ptr<const Config> cfg, std::shared_ptr<LRUCache> cache,
+    std::shared_ptr<SingleFlight> flights, std::shared_ptr<PathResolver> paths,
+    std::shared_ptr<AsyncFileReader> files, std::shared_ptr<TimerWheels> wheels) {
+  return std::allocate_shared<BasicSession>(SessionPoolAllocator<BasicSession>{}, std::move(socket), std::move(cfg),
+                                            std::move(cache), std::move(flights), std::move(paths), std::move(files),
+                                            std::move(wheels));
+}
+
+template <class Executor>
+BasicSession<Executor>::BasicSession(Socket socket, std::shared_ptr<const Config> cfg, std::shared_ptr<LRUCache> cache,
+                                     std::shared_ptr<SingleFlight> flights, std::shared_ptr<PathResolver> paths,
+                                     std::shared_ptr<AsyncFileReader> files, std::shared_ptr<TimerWheels> wheels)
   : socket_(std::move(socket)),
-    cfg_(cfg),
+    cfg_(std::move(cfg)),
     cache_(std::move(cache)),
-    inbuf_(8192),
-    parser_(cfg.max_request_line, cfg.max_header_bytes),
-    read_timer_(socket_.get_executor()),
-    write_timer_(socket_.get_executor()),
-    idle_timer_(socket_.get_executor())
-{}
-
-void Session::start() {
-  arm_idle_timer();
+    flights_(std::move(flights)),
+    paths_(std::move(paths)),
+    files_(std::move(files)),
+    wheels_(std::move(wheels)),
+    parser_(cfg_->max_request_line, cfg_->max_header_bytes, cfg_->max_header_fields) {}
+
+template <class Executor>
+BasicSession<Executor>::~BasicSession() {
+  // The wheel may be about to expire a deadline; it must not find ours.
+  cancel_deadlines();
+}
+
+template <class Executor>
+void BasicSession<Executor>::start() {
+  // Reads are attempted right after readiness is reported, and file bodies
+  // are pushed with sendfile on the raw descriptor; neither may block the
+  // io_context thread.
+  boost::system::error_code ec;
+  socket_.non_blocking(true, ec);
   start_read();
 }
 
-void Session::start_read() {
-  if (closing_after_) return;
-  auto self = shared_from_this();
-  read_timer_.expires_after(std::chrono::milliseconds(cfg_.read_timeout_ms));
-  read_timer_.async_wait([self](const boost::system::error_code& ec) {
-    if (!ec) {
-      fmt::print("[info] read timeout, closing connection\n");
-      self->close();
-    }
-  });
+template <class Executor>
+void BasicSession<Executor>::start_read() {
+  // A session with nothing buffered hands its read buffer back, so an idle
+  // keep-alive connection holds none. Reads wait for readiness without a
+  // buffer and borrow one only when there is data (see on_readable()).
+  parser_.release_buffer();
+  return_working();
+  if (closing_after_ || closed_ || reading_) return;
+  // Requests are views into the parser's buffer, so it may only be
+  // compacted between requests; a full buffer waits for the current one.
+  if (!parser_.live()) parser_.compact();
+  if (parser_.read_space() == 0) return;
 
-  socket_.async_read_some(boost::asio::buffer(inbuf_),
-    [self](boost::system::error_code ec, std::size_t n) {
-      self->on_read(ec, n);
-    }
+  reading_ = true;
+  if (answered_ && parser_.unparsed() == 0) {
+    arm(read_deadline_, "idle", cfg_->keepalive_timeout_ms);
+  } else {
+    arm(read_deadline_, "read", cfg_->read_timeout_ms);
+  }
+
+  auto self = this->shared_from_this();
+  socket_.async_wait(tcp::socket::wait_read,
+    make_alloc_handler(read_mem_, [self](boost::system::error_code ec) {
+      self->on_readable(ec);
+    })
   );
 }
 
-void Session::on_read(boost::system::error_code ec, std::size_t n) {
+template <class Executor>
+void BasicSession<Executor>::on_readable(boost::system::error_code ec) {
+  reading_ = false;
   if (ec) {
-    if (ec != boost::asio::error::operation_aborted) {
-      // client closed or error
-    }
     close();
     return;
   }
 
-  boost::system::error_code ignore;
-  read_timer_.cancel(ignore);
-  idle_timer_.expires_after(std::chrono::milliseconds(cfg_.keepalive_timeout_ms));
+  std::size_t n = socket_.read_some(boost::asio::buffer(parser_.read_ptr(), parser_.read_space()), ec);
+  if (ec == boost::asio::error::would_block) {
+    start_read();  // spurious wakeup
+    return;
+  }
+  if (ec) {
+    // client closed or error
+    close();
+    return;
+  }
 
-  auto res = parser_.parse(inbuf_.data(), n);
-  while (true) {
-    if (res.state == ParseState::BadRequest) {
-      pending_.clear();
+  wheels_->cancel(read_deadline_);
+  read_at_ = std::chrono::steady_clock::now();
+  parser_.commit(n);
+  handle_next_in_queue();
+  start_read();
+}
+
+// Answers every buffered request that can be answered right away, then
+// sends all of those responses in one gathered write. Requests that arrive
+// while that write is in flight wait, unparsed, for the next batch.
+template <class Executor>
+void BasicSession<Executor>::handle_next_in_queue() {
+  borrow_working();
+  while (!writing_ && !parked_ && !closing_after_ && work_->outgoing.size() < kMaxBatchedResponses) {
+    const ParseState st = parser_.next(work_->request);
+    if (st == ParseState::Incomplete) break;
+    request_started_ = read_at_;
+    cache_hit_ = false;
+    if (st == ParseState::BadRequest) {
       closing_after_ = true;
       respond_with_error(400, "Bad Request", false);
-      return;
-    } else if (res.state == ParseState::Incomplete) {
       break;
-    } else {
-      pending_.push_back(std::move(res.request));
-      res = parser_.parse("", 0);
     }
+    if (st == ParseState::TooManyHeaders) {
+      closing_after_ = true;
+      respond_with_error(431, "Request Header Fields Too Large", false);
+      break;
+    }
+    answered_ = true;
+    handle_request_and_respond(work_->request);
+    work_->entry.clear();  // drop the body reference, keep the ETag buffer
+    if (!parked_) parser_.release();
   }
-
-  if (!writing_) {
-    handle_next_in_queue();
-  }
-
-  if (!closing_after_) {
-    start_read();
-  }
+  if (!writing_ && !work_->outgoing.empty()) start_write();
 }
 
-void Session::handle_next_in_queue() {
-  if (pending_.empty() || writing_) return;
-  const HttpRequest req = std::move(pending_.front());
-  pending_.pop_front();
-  handle_request_and_respond(req);
+// Renders the 200 and 304 heads an entry is sent with as stored: a
+// gzip-stored body goes out gzip-encoded under its own ETag (see serve_entry()).
+static void attach_head(LRUCache::Entry& e, const std::string& fs_path, std::string_view coding) {
+  if (e.gzip) {
+    const std::string etag = make_etag(e.size, e.last_modified, "gzip");
+    e.head = std::make_shared<const std::string>(render_cached_head(
+      mime_type(fs_path), etag, e.last_modified, e.body->size(), "gzip"));
+    e.head_304 = std::make_shared<const std::string>(render_not_modified_head(etag, e.last_modified));
+  } else {
+    e.head = std::make_shared<const std::string>(render_cached_head(
+      mime_type(fs_path), e.etag, e.last_modified, e.size, std::string(coding)));
+    e.head_304 = std::make_shared<const std::string>(render_not_modified_head(e.etag, e.last_modified));
+  }
 }
 
-void Session::handle_request_and_respond(const HttpRequest& req) {
-  writing_ = true;
+template <class Executor>
+void BasicSession<Executor>::handle_request_and_respond(const HttpRequest& req) {
   bool keep_alive = req.keep_alive;
   if (!keep_alive) {
     closing_after_ = true;
-    pending_.clear();
   }
 
   if (req.method == "GET" && req.target == "/metrics") {
@@ -105,11 +243,11 @@ void Session::handle_request_and_respond(const HttpRequest& req) {
     HttpResponse resp;
     resp.status = 200;
     resp.reason = "OK";
-    resp.headers["Content-Type"] = "text/plain; charset=utf-8";
+    resp.headers["Content-Type"] = "text/plain; version=0.0.4; charset=utf-8";
     resp.headers["Content-Length"] = std::to_string(body->size());
     resp.headers["Connection"] = keep_alive ? "keep-alive" : "close";
     auto head = std::make_unique<std::string>(resp.serialize_headers());
-    write_response(std::move(head), body, keep_alive);
+    write_response(200, std::move(head), body, keep_alive);
     return;
   }
 
@@ -118,7 +256,8 @@ void Session::handle_request_and_respond(const HttpRequest& req) {
     return;
   }
 
-  auto mapped = map_url_to_fs(cfg_.doc_root, req.target);
+  auto mapped_ptr = paths_->resolve(req.target);
+  const PathMapResult& mapped = *mapped_ptr;
   if (!mapped.ok) {
     respond_with_error(400, mapped.error, keep_alive);
     return;
@@ -129,69 +268,451 @@ void Session::handle_request_and_respond(const HttpRequest& req) {
   }
 
   const std::string& fs_path = mapped.fs_path;
-  const std::string cache_key = mapped.cache_key;
 
-  LRUCache::Entry entry;
-  if (cache_->get(cache_key, entry)) {
+  // Candidate representations, best first: precompressed siblings the client
+  // accepts (by q-value, then our preference), then the file itself. All
+  // point into `mapped`.
+  struct Candidate {
+    const std::string* key;
+    const std::string* path;
+    const char* coding;
+    double q;
+  };
+  Candidate candidates[std::size(kPrecompressedVariants) + 1];
+  std::size_t n_candidates = 0;
+  const std::string_view accept_encoding = req.header("accept-encoding");
+  if (!accept_encoding.empty()) {
+    for (const auto& v : mapped.variants) {
+      double q = encoding_quality(accept_encoding, v.coding);
+      if (q <= 0.0) continue;
+      // Insertion by q; equal q keeps our preference order.
+      std::size_t i = n_candidates++;
+      for (; i > 0 && candidates[i - 1].q < q; --i) candidates[i] = candidates[i - 1];
+      candidates[i] = {&v.cache_key, &v.fs_path, v.coding, q};
+    }
+  }
+  candidates[n_candidates++] = {&mapped.cache_key, &fs_path, "", 0.0};
+
+  LRUCache::Entry& entry = work_->entry;
+  FileOpenResult opened;
+  BodyPart whole;
+  const Candidate* chosen = nullptr;
+  bool hit = false;
+  std::uint64_t epoch = 0;
+
+  for (std::size_t i = 0; i < n_candidates; ++i) {
+    const Candidate& c = candidates[i];
+    if (cache_->get(*c.key, entry)) {
+      // A manifest is checked against the file only as its segments miss,
+      // so once they are all resident a changed file would go out as its
+      // old bytes. A manifest hit costs an fstat instead; a stale one is
+      // dropped with its segments and the file loaded afresh.
+      if (entry.segment_size == 0 || manifest_matches(entry, opened = open_file(*c.path))) {
+        chosen = &c;
+        hit = true;
+        break;
+      }
+      cache_->erase_file(*c.key);
+      entry.clear();
+    }
+    // Taken before the file is opened: an invalidation from here on means
+    // what we read may already be stale, and must not be cached.
+    epoch = cache_->epoch(*c.key);
+    opened = open_file(*c.path);
+    if (opened.ok) {
+      chosen = &c;
+      break;
+    }
+    if (*c.coding == '\0') {
+      respond_with_error(500, opened.error, keep_alive);
+      return;
+    }
+  }
+  const std::string& cache_key = *chosen->key;
+  const Representation rep{*chosen->key, *chosen->path, chosen->coding};
+
+  if (hit) {
+    cache_hit_ = true;
     Metrics::instance().cache_hits.fetch_add(1, std::memory_order_relaxed);
+  } else {
+    Metrics::instance().cache_misses.fetch_add(1, std::memory_order_relaxed);
 
-    HttpResponse resp;
-    resp.status = 200;
-    resp.reason = "OK";
-    resp.headers["Content-Type"] = mime_type(fs_path);
-    resp.headers["Content-Length"] = std::to_string(entry.body->size());
-    resp.headers["Connection"] = keep_alive ? "keep-alive" : "close";
-    resp.headers["Last-Modified"] = format_http_date(entry.last_modified);
-    resp.headers["ETag"] = entry.etag;
+    // The sendfile cutoff wins over segmenting: files between the two
+    // sizes are segmented, files past the cutoff are streamed.
+    const bool stream = cfg_->sendfile_min_bytes > 0 && opened.size >= cfg_->sendfile_min_bytes;
+    const bool segmented = !stream && cfg_->cache_segment_bytes > 0 && opened.size > cfg_->cache_segment_bytes;
+    // A segmented file's bytes are counted segment by segment as they miss.
+    if (!segmented) Metrics::instance().cache_miss_bytes.fetch_add(opened.size, std::memory_order_relaxed);
 
-    auto head = std::make_unique<std::string>(resp.serialize_headers());
-    auto body = (req.method == "HEAD") ? std::make_shared<std::vector<uint8_t>>() : entry.body;
+    // A revalidation only needs the fstat we already did; skip reading the body.
+    const std::string coding(rep.coding);
+    const std::string etag = make_etag(opened.size, opened.last_modified, coding);
+    if (is_not_modified(req, etag, opened.last_modified)) {
+      respond_not_modified(etag, opened.last_modified, opened.size, keep_alive);
+      return;
+    }
 
-    Metrics::instance().responses_2xx.fetch_add(1, std::memory_order_relaxed);
-    Metrics::instance().bytes_served.fetch_add(body->size(), std::memory_order_relaxed);
-    write_response(std::move(head), body, keep_alive);
-    return;
+    if (segmented) {
+      // Too large to cache whole: remember only its shape and let the
+      // segments be cached individually as they are read.
+      entry = make_segment_manifest(opened.size, opened.last_modified, cfg_->cache_segment_bytes);
+      entry.etag = etag;
+      attach_head(entry, fs_path, coding);
+      cache_->put(cache_key, entry, epoch);
+    } else if (stream || (cfg_->sendfile_min_bytes > 0 && opened.size > cache_->max_entry_bytes())) {
+      // Large bodies (and anything the cache could never hold) are streamed
+      // from the page cache instead of being copied through user space.
+      entry.size = opened.size;
+      entry.last_modified = opened.last_modified;
+      entry.etag = etag;
+      whole = BodyPart::from_file(opened.file, 0, entry.size);
+    } else {
+      // Only one request reads a given file at a time. Concurrent misses
+      // park here and resume on their own executor with the leader's entry;
+      // the request stays parsed until then, and later requests wait behind it.
+      // `mapped_ptr` keeps the strings `rep` points into alive meanwhile.
+      auto self = this->shared_from_this();
+      auto waiter = [self, mapped_ptr, rep, keep_alive](const FlightResult& fr) {
+        boost::asio::post(self->socket_.get_executor(), [self, mapped_ptr, rep, fr, keep_alive]() {
+          self->resume_parked(fr, mapped_ptr->fs_path, rep, keep_alive);
+        });
+      };
+      parked_ = true;
+      if (!flights_->join(cache_key, std::move(waiter))) return;
+
+      if (files_) {
+        // The leader parks too while the reader works, and finishes the
+        // load back on this session's executor.
+        files_->read(opened, [self, mapped_ptr, rep, etag, epoch, keep_alive](FileReadResult fr) {
+          boost::asio::post(self->socket_.get_executor(),
+            [self, mapped_ptr, rep, etag, epoch, keep_alive, fr = std::move(fr)]() mutable {
+              const std::string& fs_path = mapped_ptr->fs_path;
+              FlightResult loaded = self->load_into_cache(rep, fs_path, std::move(fr), etag, epoch);
+              self->flights_->complete(std::string(rep.key), loaded);
+              self->resume_parked(loaded, fs_path, rep, keep_alive);
+            });
+        });
+        return;
+      }
+      parked_ = false;
+
+      FlightResult loaded = load_into_cache(rep, fs_path, read_file(opened), etag, epoch);
+      flights_->complete(cache_key, loaded);
+      if (!loaded.ok) {
+        respond_with_error(500, loaded.error, keep_alive);
+        return;
+      }
+      entry = std::move(loaded.entry);
+    }
   }
-  Metrics::instance().cache_misses.fetch_add(1, std::memory_order_relaxed);
 
-  auto fr = read_file(fs_path);
+  serve_entry(req, fs_path, rep, entry, std::move(opened), std::move(whole), keep_alive);
+}
+
+// Answers the parked request with a load's outcome and carries on with
+// the requests buffered behind it.
+template <class Executor>
+void BasicSession<Executor>::resume_parked(const FlightResult& fr, const std::string& fs_path,
+                                           const Representation& rep, bool keep_alive) {
+  parked_ = false;
   if (!fr.ok) {
-    respond_with_error(500, fr.error, keep_alive);
+    respond_with_error(fr.overloaded ? 503 : 500, fr.error, keep_alive);
+  } else {
+    work_->entry = fr.entry;
+    serve_entry(work_->request, fs_path, rep, work_->entry, FileOpenResult{}, BodyPart{}, keep_alive);
+    work_->entry.clear();
+  }
+  parser_.release();
+  handle_next_in_queue();
+  start_read();
+}
+
+template <class Executor>
+FlightResult BasicSession<Executor>::load_into_cache(const Representation& rep,
+                                                     const std::string& fs_path,
+                                                     FileReadResult fr,
+                                                     const std::string& etag,
+                                                     std::uint64_t epoch) {
+  FlightResult r;
+  try {
+    if (!fr.ok) {
+      r.error = fr.error;
+      r.overloaded = fr.overloaded;
+      return r;
+    }
+    LRUCache::Entry& entry = r.entry;
+    entry.body = std::make_shared<std::vector<uint8_t>>(std::move(fr.data));
+    entry.size = entry.body->size();
+    entry.last_modified = fr.last_modified;
+    entry.etag = etag;
+    attach_head(entry, fs_path, rep.coding);
+
+    // Precompressed variants are already encoded; only the original is
+    // worth squeezing. Responses still go out from the plain bytes.
+    LRUCache::Entry packed;
+    if (cfg_->cache_compress && rep.coding.empty() && entry.size >= cfg_->cache_compress_min_bytes &&
+        is_compressible_type(mime_type(fs_path)) && compress_entry(entry, packed)) {
+      attach_head(packed, fs_path, rep.coding);
+      cache_->put(std::string(rep.key), packed, epoch);
+    } else {
+      cache_->put(std::string(rep.key), entry, epoch);
+    }
+    r.ok = true;
+  } catch (const std::exception& ex) {
+    // Waiters must always be released, so never let a failure escape.
+    r.ok = false;
+    r.error = ex.what();
+  }
+  return r;
+}
+
+template <class Executor>
+void BasicSession<Executor>::serve_entry(const HttpRequest& req,
+                                         const std::string& fs_path,
+                                         const Representation& rep,
+                                         LRUCache::Entry& entry,
+                                         FileOpenResult opened,
+                                         BodyPart whole,
+                                         bool keep_alive) {
+  const std::string_view accept_encoding = req.header("accept-encoding");
+
+  // A gzip-stored entry goes out as-is when the client takes gzip; anyone
+  // else gets it inflated. Its ETag must differ from the identity one.
+  std::string_view send_coding = rep.coding;
+  if (entry.gzip) {
+    if (encoding_quality(accept_encoding, "gzip") > 0.0) {
+      send_coding = "gzip";
+      entry.etag = make_etag(entry.size, entry.last_modified, "gzip");
+      entry.size = entry.body->size();
+      entry.gzip = false;
+    } else {
+      if (is_not_modified(req, entry.etag, entry.last_modified)) {
+        respond_not_modified(entry.etag, entry.last_modified, entry.size, keep_alive);
+        return;
+      }
+      if (!inflate_entry(entry)) {
+        respond_with_error(500, "Corrupt cache entry", keep_alive);
+        return;
+      }
+    }
+  }
+
+  if (entry.segment_size > 0) {
+    auto reader = std::make_shared<SegmentReader>(cache_, flights_, files_, std::string(rep.key),
+                                                  std::string(rep.path), entry, std::move(opened));
+    whole = BodyPart::from_segments(std::move(reader), 0, entry.size);
+  } else if (entry.body) {
+    whole = BodyPart::from_memory(entry.body);
+  }
+
+  // The Content-Type always comes from the original file's extension.
+  respond_with_entry(req, fs_path, send_coding, entry, std::move(whole), keep_alive);
+}
+
+// Narrows a whole-body part to [first, first + len) without touching the bytes.
+static BodyPart slice_of(const BodyPart& whole, std::uint64_t first, std::uint64_t len) {
+  BodyPart p = whole;
+  p.offset += first;
+  p.length = len;
+  return p;
+}
+
+static BodyPart text_part(const std::string& s) {
+  return BodyPart::from_memory(std::make_shared<const std::vector<uint8_t>>(s.begin(), s.end()));
+}
+
+template <class Executor>
+void BasicSession<Executor>::respond_with_entry(const HttpRequest& req,
+                                                const std::string& fs_path,
+                                                std::string_view coding,
+                                                const LRUCache::Entry& entry,
+                                                BodyPart whole,
+                                                bool keep_alive) {
+  if (is_not_modified(req, entry.etag, entry.last_modified)) {
+    if (entry.head_304) write_cached_not_modified(entry, keep_alive);
+    else respond_not_modified(entry.etag, entry.last_modified, entry.size, keep_alive);
     return;
   }
 
-  LRUCache::Entry new_entry;
-  new_entry.body = std::make_shared<std::vector<uint8_t>>(std::move(fr.data));
-  new_entry.size = new_entry.body->size();
-  new_entry.last_modified = fr.last_modified;
-  new_entry.etag = make_etag(new_entry.size, new_entry.last_modified);
+  const bool head_only = (req.method == "HEAD");
+  if (entry.head && req.header("range").empty()) {
+    if (!coding.empty()) Metrics::instance().precompressed_responses.fetch_add(1, std::memory_order_relaxed);
+    write_cached_response(entry, std::move(whole), head_only, keep_alive);
+    return;
+  }
 
-  cache_->put(cache_key, new_entry);
+  const std::string content_type = mime_type(fs_path);
+  const std::string last_modified = format_http_date(entry.last_modified);
+  const std::string total = std::to_string(entry.size);
 
   HttpResponse resp;
-  resp.status = 200;
-  resp.reason = "OK";
-  resp.headers["Content-Type"] = mime_type(fs_path);
-  resp.headers["Content-Length"] = std::to_string(new_entry.size);
+  resp.headers["Content-Type"] = content_type;
   resp.headers["Connection"] = keep_alive ? "keep-alive" : "close";
-  resp.headers["Last-Modified"] = format_http_date(new_entry.last_modified);
-  resp.headers["ETag"] = new_entry.etag;
+  resp.headers["Last-Modified"] = last_modified;
+  resp.headers["ETag"] = entry.etag;
+  resp.headers["Accept-Ranges"] = "bytes";
+  resp.headers["Vary"] = "Accept-Encoding";
+  if (!coding.empty()) {
+    resp.headers["Content-Encoding"] = std::string(coding);
+    Metrics::instance().precompressed_responses.fetch_add(1, std::memory_order_relaxed);
+  }
 
-  auto head = std::make_unique<std::string>(resp.serialize_headers());
-  auto body = (req.method == "HEAD") ? std::make_shared<std::vector<uint8_t>>() : new_entry.body;
+  // Range only applies to GET; a stale If-Range validator means "send it all".
+  std::vector<ByteRange> ranges;
+  RangeResult rr = RangeResult::None;
+  const std::string_view range_hdr = req.header("range");
+  if (!head_only && !range_hdr.empty() &&
+      if_range_matches(req.header("if-range"), entry.etag, last_modified)) {
+    rr = parse_range(range_hdr, entry.size, ranges);
+  }
+
+  std::vector<BodyPart> body;
+  std::uint64_t content_length = 0;
+
+  if (rr == RangeResult::Unsatisfiable) {
+    resp.status = 416;
+    resp.reason = "Range Not Satisfiable";
+    resp.headers.erase("Content-Type");
+    resp.headers["Content-Range"] = "bytes */" + total;
+    resp.headers["Content-Length"] = "0";
+    Metrics::instance().responses_4xx.fetch_add(1, std::memory_order_relaxed);
+    write_response(resp.status, std::make_unique<std::string>(resp.serialize_headers()), std::move(body), keep_alive);
+    return;
+  }
+
+  if (rr == RangeResult::Satisfiable && ranges.size() == 1) {
+    const auto& r = ranges.front();
+    resp.status = 206;
+    resp.reason = "Partial Content";
+    resp.headers["Content-Range"] = "bytes " + std::to_string(r.first) + "-" + std::to_string(r.last) + "/" + total;
+    body.push_back(slice_of(whole, r.first, r.length()));
+    content_length = r.length();
+  } else if (rr == RangeResult::Satisfiable) {
+    static std::atomic<unsigned long long> boundary_seq{0};
+    const std::string boundary = fmt::format("webserver-{:016x}", boundary_seq.fetch_add(1, std::memory_order_relaxed));
+
+    resp.status = 206;
+    resp.reason = "Partial Content";
+    resp.headers["Content-Type"] = "multipart/byteranges; boundary=" + boundary;
+    for (const auto& r : ranges) {
+      auto part_head = text_part(
+        "\r\n--" + boundary + "\r\n"
+        "Content-Type: " + content_type + "\r\n"
+        "Content-Range: bytes " + std::to_string(r.first) + "-" + std::to_string(r.last) + "/" + total + "\r\n\r\n");
+      content_length += part_head.length + r.length();
+      body.push_back(std::move(part_head));
+      body.push_back(slice_of(whole, r.first, r.length()));
+    }
+    auto closing = text_part("\r\n--" + boundary + "--\r\n");
+    content_length += closing.length;
+    body.push_back(std::move(closing));
+  } else {
+    resp.status = 200;
+    resp.reason = "OK";
+    content_length = entry.size;
+    if (!head_only && entry.size > 0) body.push_back(std::move(whole));
+  }
+  resp.headers["Content-Length"] = std::to_string(content_length);
 
+  for (const auto& p : body) {
+    if (p.file) {
+      Metrics::instance().sendfile_responses.fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+  }
+  if (resp.status == 206) {
+    Metrics::instance().range_responses.fetch_add(1, std::memory_order_relaxed);
+  }
   Metrics::instance().responses_2xx.fetch_add(1, std::memory_order_relaxed);
-  Metrics::instance().bytes_served.fetch_add(body->size(), std::memory_order_relaxed);
-  write_response(std::move(head), body, keep_alive);
+  Metrics::instance().bytes_served.fetch_add(head_only ? 0 : content_length, std::memory_order_relaxed);
+  write_response(resp.status, std::make_unique<std::string>(resp.serialize_headers()), std::move(body), keep_alive);
 }
 
-void Session::respond_with_error(int status, const std::string& message, bool keep_alive) {
+template <class Executor>
+void BasicSession<Executor>::respond_not_modified(const std::string& etag,
+                                                  std::time_t last_modified,
+                                                  std::size_t body_size,
+                                                  bool keep_alive) {
+  HttpResponse resp;
+  resp.status = 304;
+  resp.reason = "Not Modified";
+  resp.headers["ETag"] = etag;
+  resp.headers["Last-Modified"] = format_http_date(last_modified);
+  resp.headers["Vary"] = "Accept-Encoding";
+  resp.headers["Connection"] = keep_alive ? "keep-alive" : "close";
+
+  Metrics::instance().responses_304.fetch_add(1, std::memory_order_relaxed);
+  Metrics::instance().bytes_saved_304.fetch_add(body_size, std::memory_order_relaxed);
+  write_response(304, std::make_unique<std::string>(resp.serialize_headers()), std::vector<BodyPart>{}, keep_alive);
+}
+
+namespace {
+
+// An error response whose bytes never change except for the Date line.
+struct CannedError {
+  int status;
+  const char* reason;
+  std::string before_date;  // status line + "Date: "
+  std::string after_date;   // rest of the head
+  std::shared_ptr<const std::vector<uint8_t>> body;
+};
+
+CannedError make_canned(int status, const char* reason, bool keep_alive) {
+  const std::string payload = fmt::format("{} {}\n", status, reason);
+  CannedError c;
+  c.status = status;
+  c.reason = reason;
+  c.before_date = fmt::format("HTTP/1.1 {} {}\r\nDate: ", status, reason);
+  c.after_date = fmt::format("\r\nContent-Type: text/plain; charset=utf-8\r\nContent-Length: {}\r\nConnection: {}\r\n\r\n",
+                             payload.size(), keep_alive ? "keep-alive" : "close");
+  c.body = std::make_shared<const std::vector<uint8_t>>(payload.begin(), payload.end());
+  return c;
+}
+
+// Pre-serialized 400/404/405 responses, so junk traffic does not build
+// headers and bodies from scratch. Null for anything with a custom message.
+const CannedError* canned_error(int status, const std::string& message, bool keep_alive) {
+  static const std::vector<CannedError> table = [] {
+    std::vector<CannedError> t;
+    for (bool ka : {false, true}) {
+      t.push_back(make_canned(400, "Bad Request", ka));
+      t.push_back(make_canned(404, "Not Found", ka));
+      t.push_back(make_canned(405, "Method Not Allowed", ka));
+    }
+    return t;
+  }();
+  const std::size_t base = keep_alive ? 3 : 0;
+  for (std::size_t i = base; i < base + 3; ++i) {
+    const auto& c = table[i];
+    if (c.status == status && message == c.reason) {
+      return &c;
+    }
+  }
+  return nullptr;
+}
+
+} // namespace
+
+template <class Executor>
+void BasicSession<Executor>::respond_with_error(int status, const std::string& message, bool keep_alive) {
+  if (const CannedError* c = canned_error(status, message, keep_alive)) {
+    Metrics::instance().responses_4xx.fetch_add(1, std::memory_order_relaxed);
+    const std::string date = now_http_date();
+    auto head = std::make_unique<std::string>();
+    head->reserve(c->before_date.size() + date.size() + c->after_date.size());
+    head->append(c->before_date).append(date).append(c->after_date);
+    write_response(status, std::move(head), c->body, keep_alive);
+    return;
+  }
+
   HttpResponse resp;
   resp.status = status;
   switch (status) {
     case 400: resp.reason = "Bad Request"; break;
     case 404: resp.reason = "Not Found"; break;
     case 405: resp.reason = "Method Not Allowed"; break;
+    case 431: resp.reason = "Request Header Fields Too Large"; break;
+    case 503: resp.reason = "Service Unavailable"; break;
     default: resp.reason = "Internal Server Error"; break;
   }
   std::string payload = fmt::format("{} {}\n", status, message);
@@ -206,84 +727,389 @@ void Session::respond_with_error(int status, const std::string& message, bool ke
     Metrics::instance().responses_4xx.fetch_add(1, std::memory_order_relaxed);
 
   auto head = std::make_unique<std::string>(resp.serialize_headers());
-  write_response(std::move(head), body, keep_alive);
+  write_response(status, std::move(head), body, keep_alive);
+}
+
+template <class Executor>
+void BasicSession<Executor>::write_response(int status,
+                                            std::unique_ptr<std::string> head,
+                                            std::shared_ptr<const std::vector<uint8_t>> body,
+                                            bool keep_alive) {
+  std::vector<BodyPart> parts;
+  if (body && !body->empty()) parts.push_back(BodyPart::from_memory(std::move(body)));
+  write_response(status, std::move(head), std::move(parts), keep_alive);
 }
 
-void Session::write_response(std::unique_ptr<std::string> head,
-                             std::shared_ptr<const std::vector<uint8_t>> body,
-                             bool keep_alive) {
-  auto self = shared_from_this();
+template <class Executor>
+void BasicSession<Executor>::write_response(int status,
+                                            std::unique_ptr<std::string> head,
+                                            std::vector<BodyPart> body,
+                                            bool keep_alive) {
+  Outgoing& out = queue_response(status, keep_alive);
+  out.head = std::move(head);
+  std::uint64_t bytes = 0;
+  for (auto& p : body) {
+    bytes += p.length;
+    out.body.push_back(std::move(p));
+  }
+  log_access(status, bytes);
+}
+
+template <class Executor>
+void BasicSession<Executor>::write_cached_response(const LRUCache::Entry& entry, BodyPart whole, bool head_only, bool keep_alive) {
+  Metrics::instance().responses_2xx.fetch_add(1, std::memory_order_relaxed);
+  Metrics::instance().bytes_served.fetch_add(head_only ? 0 : whole.length, std::memory_order_relaxed);
+
+  Outgoing& out = queue_response(200, keep_alive);
+  out.cached_head = entry.head;
+  out.date_line = date_header_line();
+  log_access(200, head_only ? 0 : whole.length);
+  if (!head_only && whole.length > 0) out.body.push_back(std::move(whole));
+}
+
+template <class Executor>
+void BasicSession<Executor>::write_cached_not_modified(const LRUCache::Entry& entry, bool keep_alive) {
+  Metrics::instance().responses_304.fetch_add(1, std::memory_order_relaxed);
+  Metrics::instance().bytes_saved_304.fetch_add(entry.size, std::memory_order_relaxed);
+
+  Outgoing& out = queue_response(304, keep_alive);
+  out.cached_head = entry.head_304;
+  out.date_line = date_header_line();
+  log_access(304, 0);
+}
+
+template <class Executor>
+typename BasicSession<Executor>::Outgoing& BasicSession<Executor>::queue_response(int status, bool keep_alive) {
+  if (!keep_alive) closing_after_ = true;
+  Outgoing& out = work_->outgoing.push_back();
+  out.keep_alive = keep_alive;
+  out.started = request_started_;
+  // A request that failed to parse has no method.
+  out.series = Metrics::http_series(cache_hit_, parser_.live() ? work_->request.method : std::string_view{}, status);
+  return out;
+}
+
+template <class Executor>
+void BasicSession<Executor>::log_access(int status, std::uint64_t body_bytes) {
+  Logger& logger = Logger::instance();
+  if (!logger.access_log_enabled()) return;
+  // A request that failed to parse has no method or target to record.
+  if (parser_.live()) {
+    logger.access(status, work_->request.method, work_->request.target, body_bytes);
+  } else {
+    logger.access(status, {}, {}, body_bytes);
+  }
+}
 
-  write_timer_.expires_after(std::chrono::milliseconds(cfg_.write_timeout_ms));
-  write_timer_.async_wait([self](const boost::system::error_code& ec) {
-    if (!ec) {
-      fmt::print("[info] write timeout, closing connection\n");
-      self->close();
+static std::uint64_t elapsed_us(std::chrono::steady_clock::time_point from,
+                                std::chrono::steady_clock::time_point to) {
+  return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(to - from).count());
+}
+
+template <class Executor>
+void BasicSession<Executor>::start_write() {
+  writing_ = true;
+  arm(write_deadline_, "write", cfg_->write_timeout_ms);
+  write_pending();
+}
+
+template <class Executor>
+void BasicSession<Executor>::write_pending() {
+  // Responses whose every byte has been written are done; each response
+  // still queued gets a fresh write timeout.
+  const auto now = std::chrono::steady_clock::now();
+  auto& outgoing = work_->outgoing;
+  bool popped = false;
+  while (!outgoing.empty() && outgoing.front().gathered()) {
+    const Outgoing& done = outgoing.front();
+    Metrics::instance().http_response_time[done.series].record(elapsed_us(done.started, now));
+    outgoing.pop_front();
+    popped = true;
+  }
+  if (outgoing.empty()) {
+    on_write({});
+    return;
+  }
+  if (popped) arm(write_deadline_, "write", cfg_->write_timeout_ms);
+
+  // Gather the queued responses into one write, stopping at a file part
+  // (sent with sendfile) or at the buffer and byte limits.
+  work_->write_bufs.clear();
+  std::size_t bytes = 0;
+  bool resolved_segment = false;
+  BodyPart* missing = nullptr;
+  for (auto& out : outgoing) {
+    if (!gather(out, bytes, resolved_segment, missing, now)) {
+      // The head is already committed; all we can do is drop the connection.
+      on_write(boost::asio::error::broken_pipe);
+      return;
     }
+    if (!out.gathered() || work_->write_bufs.size() + 3 > kMaxWriteBuffers || bytes >= kMaxWriteBytes) break;
+  }
+
+  if (!work_->write_bufs.empty()) {
+    Metrics::instance().write_batches.fetch_add(1, std::memory_order_relaxed);
+    auto self = this->shared_from_this();
+    const BufferView view{work_->write_bufs.data(), work_->write_bufs.data() + work_->write_bufs.size()};
+    boost::asio::async_write(socket_, view,
+      make_alloc_handler(work_->write_mem, [self](boost::system::error_code ec, std::size_t /*n*/) {
+        if (ec) self->on_write(ec);
+        else self->write_pending();
+      })
+    );
+    return;
+  }
+  if (missing) {
+    // Whatever came before it has been written; now wait for the disk.
+    load_segment(*missing);
+    return;
+  }
+  if (outgoing.front().gathered()) {
+    // Only an exhausted segmented part was left; nothing more to send.
+    write_pending();
+    return;
+  }
+
+  send_file_part();
+}
+
+template <class Executor>
+void BasicSession<Executor>::load_segment(const BodyPart& part) {
+  auto self = this->shared_from_this();
+  part.segments->load(part.offset, [self](const FlightResult& loaded) {
+    boost::asio::post(self->socket_.get_executor(), [self, ok = loaded.ok]() {
+      if (self->closed_) self->on_write(boost::asio::error::operation_aborted);
+      else if (!ok) self->on_write(boost::asio::error::broken_pipe);  // the head is already out
+      else self->write_pending();
+    });
   });
+}
 
-  std::array<boost::asio::const_buffer, 2> bufs {
-    boost::asio::buffer(*head),
-    body->empty() ? boost::asio::const_buffer{} : boost::asio::buffer(body->data(), body->size())
-  };
+template <class Executor>
+bool BasicSession<Executor>::gather(Outgoing& out, std::size_t& bytes, bool& resolved_segment, BodyPart*& missing,
+                                    std::chrono::steady_clock::time_point now) {
+  auto& bufs = work_->write_bufs;
+  if (!out.head_sent) {
+    Metrics::instance().http_ttfb[out.series].record(elapsed_us(out.started, now));
+    if (out.cached_head) {
+      static const std::string keep_alive_line = "Connection: keep-alive\r\n\r\n";
+      static const std::string close_line = "Connection: close\r\n\r\n";
+      const std::string& conn = out.keep_alive ? keep_alive_line : close_line;
+      bufs.push_back(boost::asio::buffer(*out.cached_head));
+      bufs.push_back(boost::asio::buffer(*out.date_line));
+      bufs.push_back(boost::asio::buffer(conn));
+      bytes += out.cached_head->size() + out.date_line->size() + conn.size();
+    } else {
+      bufs.push_back(boost::asio::buffer(*out.head));
+      bytes += out.head->size();
+    }
+    out.head_sent = true;
+  }
 
-  boost::asio::async_write(socket_, bufs,
-    [self, head = std::move(head), body, keep_alive]
-    (boost::system::error_code ec, std::size_t /*n*/) mutable {
-      self->on_write(std::move(head), body, keep_alive, ec, 0);
+  // In-memory parts up to the next file part. Segmented parts are resolved
+  // one segment per write into out.slice, so a large body is never held in
+  // memory at once.
+  while (out.part < out.body.size()) {
+    if (bufs.size() >= kMaxWriteBuffers || bytes >= kMaxWriteBytes) break;
+    auto& p = out.body[out.part];
+    if (p.segments) {
+      if (out.slice.length == 0) {
+        if (p.length == 0) { ++out.part; continue; }
+        if (resolved_segment) break;
+        resolved_segment = true;
+
+        std::string err;
+        const auto resolved = p.segments->slice(p.offset, p.length, out.slice, err);
+        if (resolved == SegmentReader::Slice::failed) return false;
+        if (resolved == SegmentReader::Slice::missing) {
+          missing = &p;
+          break;
+        }
+        p.offset += out.slice.length;
+        p.length -= out.slice.length;
+      }
+      if (out.slice.file) break;
+      bufs.push_back(boost::asio::buffer(out.slice.data->data() + out.slice.offset,
+                                         static_cast<std::size_t>(out.slice.length)));
+      bytes += static_cast<std::size_t>(out.slice.length);
+      out.slice.length = 0;  // `data` stays pinned until the next segment replaces it
+      continue;
     }
-  );
+    if (p.file) break;
+    if (p.length > 0) {
+      bufs.push_back(boost::asio::buffer(p.data->data() + p.offset, static_cast<std::size_t>(p.length)));
+      bytes += static_cast<std::size_t>(p.length);
+    }
+    ++out.part;
+  }
+  return true;
+}
+
+template <class Executor>
+void BasicSession<Executor>::send_file_part() {
+  if (closed_) {
+    on_write(boost::asio::error::operation_aborted);
+    return;
+  }
+
+  Outgoing& out = work_->outgoing.front();
+  const auto& p = out.file_part();
+  while (out.part_sent < p.length) {
+    auto n = send_file_some(socket_.native_handle(), p.file->fd(),
+                            p.offset + out.part_sent,
+                            static_cast<std::size_t>(p.length - out.part_sent));
+    if (n > 0) {
+      out.part_sent += static_cast<std::uint64_t>(n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      auto self = this->shared_from_this();
+      socket_.async_wait(tcp::socket::wait_write,
+        make_alloc_handler(work_->write_mem, [self](boost::system::error_code ec) {
+          if (ec) self->on_write(ec);
+          else self->send_file_part();
+        })
+      );
+      return;
+    }
+    // A short file means it shrank under us; Content-Length can't be honoured.
+    on_write(n == 0
+      ? boost::system::error_code(boost::asio::error::eof)
+      : boost::system::error_code(errno, boost::system::system_category()));
+    return;
+  }
+
+  if (out.body[out.part].segments) out.slice = {};
+  else ++out.part;
+  out.part_sent = 0;
+  write_pending();
 }
 
-void Session::on_write(std::unique_ptr<std::string> /*head*/,
-                       std::shared_ptr<const std::vector<uint8_t>> /*body*/,
-                       bool keep_alive,
-                       boost::system::error_code ec,
-                       std::size_t /*n*/) {
-  boost::system::error_code ignore;
-  write_timer_.cancel(ignore);
+// Called once the queue has drained, or on the first write error.
+template <class Executor>
+void BasicSession<Executor>::on_write(boost::system::error_code ec) {
+  wheels_->cancel(write_deadline_);
 
   if (ec) {
     close();
     return;
   }
+  writing_ = false;
+  // A parked request may already have marked the connection for closing;
+  // its response still has to go out first, from resume_parked().
+  if (closing_after_) {
+    if (!parked_) close();
+    return;
+  }
 
-  if (!keep_alive || closing_after_) {
-    close();
+  handle_next_in_queue();
+  start_read();
+}
+
+namespace {
+
+// Per-thread free list of Working blocks, one per BasicSession type.
+template <class Working>
+struct WorkingPool {
+  static constexpr std::size_t kMaxFree = 64;  // beyond this, returned blocks are freed
+
+  Working* head = nullptr;
+  std::size_t count = 0;
+
+  ~WorkingPool() {
+    while (head) delete std::exchange(head, head->next);
+  }
+
+  static WorkingPool& local() {
+    thread_local WorkingPool pool;
+    return pool;
+  }
+};
+
+} // namespace
+
+template <class Executor>
+void BasicSession<Executor>::borrow_working() {
+  if (work_) return;
+  auto& pool = WorkingPool<Working>::local();
+  if (pool.head) {
+    work_.reset(std::exchange(pool.head, pool.head->next));
+    --pool.count;
     return;
   }
+  work_.reset(new Working);
+  work_->write_bufs.reserve(kMaxWriteBuffers);
+}
 
-  writing_ = false;
-  if (!pending_.empty()) {
-    handle_next_in_queue();
-  } else {
-    start_read();
+template <class Executor>
+void BasicSession<Executor>::return_working() {
+  if (work_ && !writing_ && !parked_ && !parser_.live() && work_->outgoing.empty()) work_.reset();
+}
+
+template <class Executor>
+void BasicSession<Executor>::WorkingRelease::operator()(Working* w) const noexcept {
+  // A closed session may drop responses it never sent.
+  while (!w->outgoing.empty()) w->outgoing.pop_front();
+  w->entry.clear();
+  auto& pool = WorkingPool<Working>::local();
+  if (pool.count >= WorkingPool<Working>::kMaxFree) {
+    delete w;
+    return;
   }
+  w->next = pool.head;
+  pool.head = w;
+  ++pool.count;
 }
 
-void Session::arm_idle_timer() {
-  auto self = shared_from_this();
-  idle_timer_.expires_after(std::chrono::milliseconds(cfg_.keepalive_timeout_ms));
-  idle_timer_.async_wait([self](const boost::system::error_code& ec){
-    if (!ec) {
-      fmt::print("[info] idle timeout, closing connection\n");
-      self->close();
-    }
+template <class Executor>
+std::shared_ptr<void> BasicSession<Executor>::Deadline::pin() {
+  return session.weak_from_this().lock();
+}
+
+template <class Executor>
+void BasicSession<Executor>::Deadline::expire(std::uint64_t generation) {
+  // Runs on the wheel's tick; the session's state belongs to its executor.
+  boost::asio::post(session.socket_.get_executor(), [self = session.shared_from_this(), this, generation] {
+    self->on_deadline(*this, generation);
   });
 }
 
-void Session::cancel_timers() {
-  boost::system::error_code ig;
-  read_timer_.cancel(ig);
-  write_timer_.cancel(ig);
-  idle_timer_.cancel(ig);
+template <class Executor>
+void BasicSession<Executor>::arm(Deadline& d, const char* what, int timeout_ms) {
+  d.what = what;
+  wheels_->arm(d, std::chrono::milliseconds(timeout_ms));
+}
+
+template <class Executor>
+void BasicSession<Executor>::on_deadline(Deadline& d, std::uint64_t generation) {
+  // Re-armed or cancelled since it expired: the operation it bounded is done.
+  if (closed_ || d.generation() != generation) return;
+  Metrics::instance().timeouts.fetch_add(1, std::memory_order_relaxed);
+  log_info("{} timeout, closing connection", d.what);
+  close();
 }
 
-void Session::close() {
+template <class Executor>
+void BasicSession<Executor>::cancel_deadlines() {
+  wheels_->cancel(read_deadline_);
+  wheels_->cancel(write_deadline_);
+}
+
+template <class Executor>
+void BasicSession<Executor>::close() {
   if (closed_) return;
   closed_ = true;
-  cancel_timers();
+  cancel_deadlines();
   boost::system::error_code ig;
   socket_.shutdown(tcp::socket::shutdown_both, ig);
   socket_.close(ig);
-}
\ No newline at end of file
+}
+template class BasicSession<boost::asio::strand<boost::asio::io_context::executor_type>>;
+template class BasicSession<boost::asio::io_context::executor_type>;
+
+// What an idle keep-alive connection costs beyond the socket itself: the
+// session and nothing else (see Working). Anything per-request belongs in
+// Working, not here.
+static_assert(sizeof(Session) <= 768, "an idle Session has grown; move per-request state into Working");
+static_assert(sizeof(CoreSession) <= 768, "an idle CoreSession has grown; move per-request state into Working");
@@ -1,5 +1,5 @@
 #include "../headers/signals.hpp"
-#include <fmt/core.h>
+#include "../headers/util/logging.hpp"
 
 SignalHandler::SignalHandler(boost::asio::io_context& ioc)
   : ioc_(ioc), signals_(ioc, SIGINT, SIGTERM)
@@ -13,7 +13,8 @@ void SignalHandler::register_signals() {
 
 void SignalHandler::on_signal(const boost::system::error_code& ec, int signo) {
   if (!ec) {
-    fmt::print("[info] Caught signal {}, shutting down...\n", signo);
+    log_info("Caught signal {}, shutting down...", signo);
     ioc_.stop();
+    for (auto* ioc : others_) ioc->stop();
   }
 }
\ No newline at end of file
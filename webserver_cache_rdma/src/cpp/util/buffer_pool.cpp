@@ -0,0 +1,64 @@
+#include "../../headers/util/buffer_pool.hpp"
+#include "../../headers/util/metrics.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace {
+
+// Idle buffers kept per thread; beyond this, returned buffers are freed.
+constexpr std::size_t kMaxFree = 64;
+
+struct FreeList {
+  struct Block { Block* next; };
+
+  Block* head = nullptr;
+  std::size_t count = 0;
+  std::size_t size = 0;  // every buffer in one pool has the same size
+
+  ~FreeList() {
+    Metrics::instance().read_buffers_pooled.fetch_sub(count, std::memory_order_relaxed);
+    while (head) {
+      Block* next = head->next;
+      ::operator delete(head);
+      head = next;
+    }
+  }
+};
+
+FreeList& free_list() {
+  thread_local FreeList fl;
+  return fl;
+}
+
+} // namespace
+
+ReadBufferPool::Buffer ReadBufferPool::acquire(std::size_t size) {
+  auto& m = Metrics::instance();
+  m.read_buffers_in_use.fetch_add(1, std::memory_order_relaxed);
+  FreeList& fl = free_list();
+  if (fl.head && fl.size == size) {
+    FreeList::Block* b = fl.head;
+    fl.head = b->next;
+    --fl.count;
+    m.read_buffers_pooled.fetch_sub(1, std::memory_order_relaxed);
+    return Buffer(reinterpret_cast<char*>(b), Release{size});
+  }
+  return Buffer(static_cast<char*>(::operator new(std::max(size, sizeof(FreeList::Block)))), Release{size});
+}
+
+void ReadBufferPool::Release::operator()(char* p) const noexcept {
+  auto& m = Metrics::instance();
+  m.read_buffers_in_use.fetch_sub(1, std::memory_order_relaxed);
+  FreeList& fl = free_list();
+  if (fl.count == 0) fl.size = size;
+  if (fl.size == size && fl.count < kMaxFree) {
+    auto* b = reinterpret_cast<FreeList::Block*>(p);
+    b->next = fl.head;
+    fl.head = b;
+    ++fl.count;
+    m.read_buffers_pooled.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ::operator delete(p);
+}
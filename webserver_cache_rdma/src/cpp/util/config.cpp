@@ -5,10 +5,14 @@
 
 static void print_usage(const char* argv0) {
   fmt::print(
-    "Usage: {} [--port N] [--threads N] [--doc-root PATH]\n"
-    "            [--cache.mem-mb N]\n"
-    "            [--read-timeout-ms N] [--write-timeout-ms N] [--keepalive-timeout-ms N]\n"
-    "            [--max-request-line N] [--max-header-bytes N]\n"
+    "Usage: {} [--port N] [--threads N] [--thread-per-core] [--doc-root PATH]\n"
+    "            [--cache.mem-mb N] [--cache.shards N] [--cache.policy NAME] [--cache.segment-kb N] [--sendfile.min-bytes N]\n"
+    "            [--cache.compress] [--cache.compress-min-bytes N] [--no-watch] [--io-uring]\n"
+    "            [--file-load.threads N] [--file-load.queue N]\n"
+    "            [--negative-cache.entries N] [--negative-cache.ttl-ms N]\n"
+    "            [--read-timeout-ms N] [--write-timeout-ms N] [--keepalive-timeout-ms N] [--timer-tick-ms N]\n"
+    "            [--max-request-line N] [--max-header-bytes N] [--max-header-fields N]\n"
+    "            [--log.level NAME] [--log.rate-limit N] [--access-log PATH]\n"
     "            [--rdma.enable] [--rdma.bind IP] [--rdma.port N] [--rdma.pollers N]\n"
     "            [--rdma.recv-bufs N] [--rdma.recv-size N] [--rdma.send-chunk N] [--rdma.max-sends N]\n",
     argv0
@@ -23,13 +27,31 @@ Config parse_args(int argc, char** argv) {
 
     if (arg == "--port" && i + 1 < argc) cfg.port = static_cast<unsigned short>(std::stoi(next(i)));
     else if (arg == "--threads" && i + 1 < argc) cfg.threads = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--thread-per-core") cfg.thread_per_core = true;
     else if (arg == "--doc-root" && i + 1 < argc) cfg.doc_root = next(i);
     else if (arg == "--cache.mem-mb" && i + 1 < argc) cfg.cache_mem_mb = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--cache.shards" && i + 1 < argc) cfg.cache_shards = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--cache.policy" && i + 1 < argc) cfg.cache_policy = next(i);
+    else if (arg == "--cache.segment-kb" && i + 1 < argc) cfg.cache_segment_bytes = static_cast<std::size_t>(std::stoull(next(i))) * 1024;
+    else if (arg == "--cache.compress") cfg.cache_compress = true;
+    else if (arg == "--cache.compress-min-bytes" && i + 1 < argc) cfg.cache_compress_min_bytes = static_cast<std::size_t>(std::stoull(next(i)));
+    else if (arg == "--no-watch") cfg.watch_doc_root = false;
+    else if (arg == "--io-uring") cfg.io_uring = true;
+    else if (arg == "--file-load.threads" && i + 1 < argc) cfg.file_load_threads = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--file-load.queue" && i + 1 < argc) cfg.file_load_queue = static_cast<std::size_t>(std::stoull(next(i)));
+    else if (arg == "--negative-cache.entries" && i + 1 < argc) cfg.negative_cache_entries = static_cast<std::size_t>(std::stoull(next(i)));
+    else if (arg == "--negative-cache.ttl-ms" && i + 1 < argc) cfg.negative_cache_ttl_ms = std::stoi(next(i));
+    else if (arg == "--sendfile.min-bytes" && i + 1 < argc) cfg.sendfile_min_bytes = static_cast<std::size_t>(std::stoull(next(i)));
     else if (arg == "--read-timeout-ms" && i + 1 < argc) cfg.read_timeout_ms = std::stoi(next(i));
     else if (arg == "--write-timeout-ms" && i + 1 < argc) cfg.write_timeout_ms = std::stoi(next(i));
     else if (arg == "--keepalive-timeout-ms" && i + 1 < argc) cfg.keepalive_timeout_ms = std::stoi(next(i));
+    else if (arg == "--timer-tick-ms" && i + 1 < argc) cfg.timer_tick_ms = std::stoi(next(i));
     else if (arg == "--max-request-line" && i + 1 < argc) cfg.max_request_line = static_cast<std::size_t>(std::stoull(next(i)));
     else if (arg == "--max-header-bytes" && i + 1 < argc) cfg.max_header_bytes = static_cast<std::size_t>(std::stoull(next(i)));
+    else if (arg == "--max-header-fields" && i + 1 < argc) cfg.max_header_fields = static_cast<std::size_t>(std::stoull(next(i)));
+    else if (arg == "--log.level" && i + 1 < argc) cfg.log_level = next(i);
+    else if (arg == "--log.rate-limit" && i + 1 < argc) cfg.log_rate_limit = static_cast<unsigned>(std::stoul(next(i)));
+    else if (arg == "--access-log" && i + 1 < argc) cfg.access_log = next(i);
     else if (arg == "--rdma.enable") cfg.rdma_enable = true;
     else if (arg == "--rdma.bind" && i + 1 < argc) cfg.rdma_bind = next(i);
     else if (arg == "--rdma.port" && i + 1 < argc) cfg.rdma_port = static_cast<unsigned short>(std::stoi(next(i)));
@@ -1 +1,273 @@
-#include "../../headers/util/logging.hpp"
\ No newline at end of file
+#include "../../headers/util/logging.hpp"
+#include "../../headers/util/metrics.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+
+namespace {
+
+constexpr std::size_t kRingSlots = 512;
+constexpr auto kFlushInterval = std::chrono::milliseconds(20);
+
+// Call sites tracked per thread for rate limiting; sites beyond this are
+// not limited.
+constexpr std::size_t kRateSites = 64;
+
+const char* level_name(std::uint8_t kind) {
+  switch (static_cast<LogLevel>(kind)) {
+    case LogLevel::Debug: return "debug";
+    case LogLevel::Info: return "info";
+    case LogLevel::Warn: return "warn";
+    case LogLevel::Error: return "error";
+    default: return "?";
+  }
+}
+
+struct SiteWindow {
+  const char* site = nullptr;
+  std::int64_t second = 0;
+  std::uint32_t count = 0;
+  std::uint32_t suppressed = 0;
+};
+
+} // namespace
+
+struct Logger::Ring {
+  Record slots[kRingSlots];
+  std::atomic<std::uint64_t> head{0};  // next record to write out (flusher)
+  std::atomic<std::uint64_t> tail{0};  // next record to fill (owner thread)
+  std::atomic<bool> retired{false};    // owner thread has exited
+};
+
+bool parse_log_level(std::string_view name, LogLevel& out) {
+  if (name == "debug") out = LogLevel::Debug;
+  else if (name == "info") out = LogLevel::Info;
+  else if (name == "warn") out = LogLevel::Warn;
+  else if (name == "error") out = LogLevel::Error;
+  else if (name == "off") out = LogLevel::Off;
+  else return false;
+  return true;
+}
+
+Logger& Logger::instance() {
+  static Logger logger;
+  return logger;
+}
+
+Logger::~Logger() {
+  stop();
+}
+
+bool Logger::start(const std::string& access_log_path, std::string& err) {
+  if (running_.load()) return true;
+  if (!access_log_path.empty()) {
+    access_file_ = std::fopen(access_log_path.c_str(), "ab");
+    if (!access_file_) {
+      err = access_log_path + ": " + std::strerror(errno);
+      return false;
+    }
+    access_log_.store(true, std::memory_order_relaxed);
+  }
+  running_.store(true, std::memory_order_release);
+  flusher_ = std::thread([this] { run(); });
+  return true;
+}
+
+void Logger::stop() {
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (!running_.load()) return;
+    running_.store(false, std::memory_order_release);
+  }
+  cv_.notify_all();
+  flusher_.join();
+  access_log_.store(false, std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lk(write_mtx_);
+  if (access_file_) {
+    std::fclose(access_file_);
+    access_file_ = nullptr;
+  }
+}
+
+std::int64_t Logger::now_us() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool Logger::admit(const char* site, std::int64_t now, std::uint32_t& suppressed) {
+  const unsigned limit = rate_limit_.load(std::memory_order_relaxed);
+  if (limit == 0) return true;
+  thread_local SiteWindow windows[kRateSites];
+  const std::size_t start = (reinterpret_cast<std::uintptr_t>(site) >> 3) % kRateSites;
+  for (std::size_t i = 0; i < 4; ++i) {
+    SiteWindow& w = windows[(start + i) % kRateSites];
+    if (w.site != nullptr && w.site != site) continue;
+    w.site = site;
+    const std::int64_t second = now / 1000000;
+    if (w.second != second) {
+      w.second = second;
+      w.count = 0;
+    }
+    if (w.count >= limit) {
+      ++w.suppressed;
+      Metrics::instance().log_suppressed.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    ++w.count;
+    suppressed = w.suppressed;
+    w.suppressed = 0;
+    return true;
+  }
+  return true;
+}
+
+Logger::Ring& Logger::local_ring() {
+  // The ring outlives its thread until the flusher has drained it.
+  struct Handle {
+    std::shared_ptr<Ring> ring;
+    ~Handle() {
+      if (ring) ring->retired.store(true, std::memory_order_release);
+    }
+  };
+  thread_local Handle handle;
+  if (!handle.ring) {
+    handle.ring = std::make_shared<Ring>();
+    std::lock_guard<std::mutex> lk(mtx_);
+    rings_.push_back(handle.ring);
+  }
+  return *handle.ring;
+}
+
+Logger::Record* Logger::claim() {
+  Ring& ring = local_ring();
+  const std::uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+  if (tail - ring.head.load(std::memory_order_acquire) == kRingSlots) {
+    Metrics::instance().log_dropped.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  return &ring.slots[tail % kRingSlots];
+}
+
+void Logger::publish(Record& r) {
+  if (!running_.load(std::memory_order_acquire)) {
+    // No flusher: write the record now and leave the ring as it was.
+    std::lock_guard<std::mutex> lk(write_mtx_);
+    render(r);
+    write_out();
+    return;
+  }
+  // `r` is the slot at tail, and only this thread moves tail.
+  Ring& ring = local_ring();
+  ring.tail.store(ring.tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+void Logger::access(int status, std::string_view method, std::string_view path, std::uint64_t bytes) {
+  if (!access_log_enabled()) return;
+  Record* r = claim();
+  if (!r) return;
+  const std::size_t mlen = std::min<std::size_t>(method.size(), 16);
+  const std::size_t plen = std::min(path.size(), sizeof(r->text) - mlen);
+  std::memcpy(r->text, method.data(), mlen);
+  std::memcpy(r->text + mlen, path.data(), plen);
+  r->time_us = now_us();
+  r->bytes = bytes;
+  r->suppressed = 0;
+  r->len = static_cast<std::uint16_t>(mlen + plen);
+  r->status = static_cast<std::uint16_t>(status);
+  r->kind = kAccess;
+  r->method_len = static_cast<std::uint8_t>(mlen);
+  publish(*r);
+}
+
+void Logger::run() {
+  std::vector<std::shared_ptr<Ring>> rings;
+  for (;;) {
+    bool stopping;
+    {
+      std::unique_lock<std::mutex> lk(mtx_);
+      cv_.wait_for(lk, kFlushInterval, [this] { return !running_.load(); });
+      stopping = !running_.load();
+      // Rings of exited threads go once they are empty.
+      rings_.erase(std::remove_if(rings_.begin(), rings_.end(), [](const std::shared_ptr<Ring>& r) {
+        return r->retired.load(std::memory_order_acquire) &&
+               r->head.load(std::memory_order_relaxed) == r->tail.load(std::memory_order_acquire);
+      }), rings_.end());
+      rings = rings_;
+    }
+    drain(rings);
+    if (stopping) return;
+  }
+}
+
+void Logger::drain(const std::vector<std::shared_ptr<Ring>>& rings) {
+  // Interleave the threads' records by time, then release their slots.
+  tails_.clear();
+  batch_.clear();
+  for (const auto& ring : rings) {
+    const std::uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    for (std::uint64_t i = ring->head.load(std::memory_order_relaxed); i != tail; ++i) {
+      batch_.push_back(&ring->slots[i % kRingSlots]);
+    }
+    tails_.push_back(tail);
+  }
+  if (batch_.empty()) return;
+  std::stable_sort(batch_.begin(), batch_.end(), [](const Record* a, const Record* b) {
+    return a->time_us < b->time_us;
+  });
+  std::lock_guard<std::mutex> lk(write_mtx_);
+  for (const Record* r : batch_) render(*r);
+  for (std::size_t i = 0; i < rings.size(); ++i) {
+    rings[i]->head.store(tails_[i], std::memory_order_release);
+  }
+  write_out();
+}
+
+void Logger::render(const Record& r) {
+  if (r.kind == kAccess) {
+    // u64 time_us, u64 bytes, u16 status, u8 method length, u16 path
+    // length, then the method and path bytes; host byte order.
+    const std::uint16_t path_len = static_cast<std::uint16_t>(r.len - r.method_len);
+    char fixed[21];
+    std::memcpy(fixed, &r.time_us, 8);
+    std::memcpy(fixed + 8, &r.bytes, 8);
+    std::memcpy(fixed + 16, &r.status, 2);
+    std::memcpy(fixed + 18, &r.method_len, 1);
+    std::memcpy(fixed + 19, &path_len, 2);
+    access_buf_.append(fixed, sizeof(fixed));
+    access_buf_.append(r.text, r.len);
+    return;
+  }
+
+  const std::time_t secs = static_cast<std::time_t>(r.time_us / 1000000);
+  std::tm tm{};
+  gmtime_r(&secs, &tm);
+  std::string& out = r.kind >= static_cast<std::uint8_t>(LogLevel::Warn) ? err_ : out_;
+  fmt::format_to(std::back_inserter(out), "{:04}-{:02}-{:02}T{:02}:{:02}:{:02}.{:03}Z [{}] {}",
+                 tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                 (r.time_us / 1000) % 1000, level_name(r.kind), std::string_view(r.text, r.len));
+  if (r.len == sizeof(r.text)) out += "...";
+  if (r.suppressed > 0) fmt::format_to(std::back_inserter(out), " ({} similar suppressed)", r.suppressed);
+  out += '\n';
+}
+
+void Logger::write_out() {
+  if (!out_.empty()) {
+    std::fwrite(out_.data(), 1, out_.size(), stdout);
+    std::fflush(stdout);
+    out_.clear();
+  }
+  if (!err_.empty()) {
+    std::fwrite(err_.data(), 1, err_.size(), stderr);
+    std::fflush(stderr);
+    err_.clear();
+  }
+  if (!access_buf_.empty()) {
+    if (access_file_) {
+      std::fwrite(access_buf_.data(), 1, access_buf_.size(), access_file_);
+      std::fflush(access_file_);
+    }
+    access_buf_.clear();
+  }
+}
@@ -1 +1,246 @@
-#include "../../headers/util/metrics.hpp"
\ No newline at end of file
+#include "../../headers/util/metrics.hpp"
+
+#include <fmt/format.h>
+#include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// The chunks one thread has attached, indexed like tls_chunks.
+struct ThreadCells {
+  CounterChunk* chunks[metrics_detail::kMaxChunks] = {};
+};
+
+struct Registry {
+  std::mutex mtx;
+  std::vector<ThreadCells*> threads;  // every record handed out; never freed
+  std::vector<ThreadCells*> idle;     // records of exited threads, reused by new ones
+  std::size_t next_index = 0;
+};
+
+Registry& registry() {
+  // Leaked, so threads still running during static destruction can count.
+  static Registry* r = new Registry;
+  return *r;
+}
+
+// Updates from a thread whose record has already been handed back.
+std::atomic<unsigned long long> orphans[metrics_detail::kCapacity];
+
+thread_local bool t_exited = false;
+
+} // namespace
+
+CounterChunk* metrics_detail::attach_chunk(std::size_t c) {
+  // A record keeps its counts when its thread exits: the next thread to
+  // start picks it up, along with its chunks, and adds on top.
+  struct Handle {
+    ThreadCells* cells = nullptr;
+    ~Handle() {
+      std::fill(std::begin(tls_chunks), std::end(tls_chunks), nullptr);
+      t_exited = true;
+      Registry& r = registry();
+      std::lock_guard<std::mutex> lk(r.mtx);
+      r.idle.push_back(cells);
+    }
+  };
+  if (t_exited) return nullptr;
+  thread_local Handle handle;
+  Registry& r = registry();
+  // Under the lock even for this thread's own record, so sum() never sees
+  // a half-published chunk pointer.
+  std::lock_guard<std::mutex> lk(r.mtx);
+  if (!handle.cells) {
+    if (!r.idle.empty()) {
+      handle.cells = r.idle.back();
+      r.idle.pop_back();
+    } else {
+      handle.cells = new ThreadCells;
+      r.threads.push_back(handle.cells);
+    }
+  }
+  CounterChunk*& chunk = handle.cells->chunks[c];
+  if (!chunk) chunk = new CounterChunk();
+  tls_chunks[c] = chunk;
+  return chunk;
+}
+
+void metrics_detail::add_orphan(std::size_t index, unsigned long long n) noexcept {
+  orphans[index].fetch_add(n, std::memory_order_relaxed);
+}
+
+std::size_t metrics_detail::allocate(std::size_t n) {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lk(r.mtx);
+  if (kCapacity - r.next_index < n) throw std::length_error("metrics_detail::kCapacity exceeded");
+  const std::size_t first = r.next_index;
+  r.next_index += n;
+  return first;
+}
+
+void metrics_detail::sum(std::size_t first, std::size_t n, unsigned long long* out) {
+  Registry& r = registry();
+  for (std::size_t i = 0; i < n; ++i) out[i] = orphans[first + i].load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lk(r.mtx);
+  for (const ThreadCells* t : r.threads) {
+    for (std::size_t i = 0; i < n; ++i) {
+      const std::size_t index = first + i;
+      if (const CounterChunk* chunk = t->chunks[index / CounterChunk::kCells]) {
+        out[i] += chunk->cells[index % CounterChunk::kCells].load(std::memory_order_relaxed);
+      }
+    }
+  }
+}
+
+unsigned long long Counter::load(std::memory_order) const {
+  unsigned long long v;
+  metrics_detail::sum(index_, 1, &v);
+  return v - base_.load(std::memory_order_relaxed);
+}
+
+Counter& Counter::operator=(unsigned long long value) {
+  unsigned long long v;
+  metrics_detail::sum(index_, 1, &v);
+  base_.store(v - value, std::memory_order_relaxed);
+  return *this;
+}
+
+Histogram::Snapshot Histogram::snapshot() const {
+  unsigned long long cells[kCells];
+  metrics_detail::sum(first_, kCells, cells);
+  Snapshot s;
+  for (std::size_t i = 0; i <= kBounds; ++i) {
+    s.buckets[i] = cells[i] - base_[i].load(std::memory_order_relaxed);
+    s.count += s.buckets[i];
+  }
+  s.sum_us = cells[kBounds + 1] - base_[kBounds + 1].load(std::memory_order_relaxed);
+  return s;
+}
+
+void Histogram::reset() {
+  unsigned long long cells[kCells];
+  metrics_detail::sum(first_, kCells, cells);
+  for (std::size_t i = 0; i < kCells; ++i) base_[i].store(cells[i], std::memory_order_relaxed);
+}
+
+namespace {
+
+template <class V>
+void put(std::string& out, std::string_view name, const char* type, const V& value, std::string_view labels = {}) {
+  fmt::format_to(std::back_inserter(out), "# TYPE {} {}\n{}{} {}\n", name, type, name, labels, value);
+}
+
+// The `le` label of each finite bucket, in seconds.
+const std::vector<std::string>& bucket_bounds() {
+  static const std::vector<std::string> bounds = [] {
+    std::vector<std::string> b;
+    for (std::size_t i = 0; i < Histogram::kBounds; ++i) {
+      b.push_back(fmt::format("{}", static_cast<double>(Histogram::upper_bound_us(i)) / 1e6));
+    }
+    return b;
+  }();
+  return bounds;
+}
+
+// One histogram family; series nobody has recorded into are left out.
+template <class LabelsOf>
+void put_histograms(std::string& out, std::string_view name, const Histogram* series, std::size_t n,
+                    LabelsOf labels_of) {
+  const auto& bounds = bucket_bounds();
+  auto it = std::back_inserter(out);
+  fmt::format_to(it, "# TYPE {} histogram\n", name);
+  for (std::size_t i = 0; i < n; ++i) {
+    const Histogram::Snapshot s = series[i].snapshot();
+    if (s.count == 0) continue;
+    const std::string labels = labels_of(i);
+    unsigned long long cumulative = 0;
+    for (std::size_t b = 0; b < Histogram::kBounds; ++b) {
+      cumulative += s.buckets[b];
+      fmt::format_to(it, "{}_bucket{{{},le=\"{}\"}} {}\n", name, labels, bounds[b], cumulative);
+    }
+    fmt::format_to(it, "{}_bucket{{{},le=\"+Inf\"}} {}\n", name, labels, s.count);
+    fmt::format_to(it, "{}_sum{{{}}} {}\n", name, labels, static_cast<double>(s.sum_us) / 1e6);
+    fmt::format_to(it, "{}_count{{{}}} {}\n", name, labels, s.count);
+  }
+}
+
+const char* const kCacheLabels[] = {"hit", "miss"};
+const char* const kMethodLabels[] = {"GET", "HEAD", "other"};
+const char* const kStatusLabels[] = {"2xx", "3xx", "4xx", "5xx"};
+
+} // namespace
+
+std::string Metrics::render_text() const {
+  const auto gz_stored = cache_gzip_stored_bytes.load();
+  const double gz_ratio = gz_stored ? static_cast<double>(cache_gzip_original_bytes.load()) / static_cast<double>(gz_stored) : 0.0;
+  const auto hits = cache_lookup_hits.load();
+  const auto lookups = hits + cache_lookup_misses.load();
+  const auto hit_bytes = cache_hit_bytes.load();
+  const auto looked_up_bytes = hit_bytes + cache_miss_bytes.load();
+  const double hit_ratio = lookups ? static_cast<double>(hits) / static_cast<double>(lookups) : 0.0;
+  const double byte_hit_ratio = looked_up_bytes ? static_cast<double>(hit_bytes) / static_cast<double>(looked_up_bytes) : 0.0;
+  const std::string policy = std::string("{policy=\"") + cache_policy.load() + "\"}";
+
+  std::string out;
+  out.reserve(16 * 1024);
+  put(out, "requests_total", "counter", requests_total.load());
+  put(out, "responses_2xx", "counter", responses_2xx.load());
+  put(out, "responses_304", "counter", responses_304.load());
+  put(out, "responses_4xx", "counter", responses_4xx.load());
+  put(out, "responses_5xx", "counter", responses_5xx.load());
+  put(out, "cache_hits", "counter", cache_hits.load());
+  put(out, "cache_misses", "counter", cache_misses.load());
+  put(out, "cache_segment_hits", "counter", cache_segment_hits.load());
+  put(out, "cache_segment_misses", "counter", cache_segment_misses.load());
+  put(out, "path_cache_hits", "counter", path_cache_hits.load());
+  put(out, "path_cache_misses", "counter", path_cache_misses.load());
+  put(out, "negative_cache_hits", "counter", negative_cache_hits.load());
+  put(out, "cache_coalesced_loads", "counter", cache_coalesced_loads.load());
+  put(out, "cache_invalidations", "counter", cache_invalidations.load());
+  put(out, "cache_stale_loads", "counter", cache_stale_loads.load());
+  put(out, "cache_gzip_entries", "gauge", cache_gzip_entries.load());
+  put(out, "cache_gzip_stored_bytes", "gauge", gz_stored);
+  put(out, "cache_gzip_original_bytes", "gauge", cache_gzip_original_bytes.load());
+  put(out, "cache_gzip_ratio", "gauge", gz_ratio);
+  put(out, "cache_lookup_hits", "counter", hits, policy);
+  put(out, "cache_lookup_misses", "counter", lookups - hits, policy);
+  put(out, "cache_hit_bytes", "counter", hit_bytes, policy);
+  put(out, "cache_miss_bytes", "counter", looked_up_bytes - hit_bytes, policy);
+  put(out, "cache_evictions", "counter", cache_evictions.load(), policy);
+  put(out, "cache_hit_ratio", "gauge", hit_ratio, policy);
+  put(out, "cache_byte_hit_ratio", "gauge", byte_hit_ratio, policy);
+  put(out, "bytes_served", "counter", bytes_served.load());
+  put(out, "bytes_saved_304", "counter", bytes_saved_304.load());
+  put(out, "sendfile_responses", "counter", sendfile_responses.load());
+  put(out, "range_responses", "counter", range_responses.load());
+  put(out, "precompressed_responses", "counter", precompressed_responses.load());
+  put(out, "write_batches", "counter", write_batches.load());
+  put(out, "timeouts", "counter", timeouts.load());
+  put(out, "read_buffers_in_use", "gauge", read_buffers_in_use.load());
+  put(out, "read_buffers_pooled", "gauge", read_buffers_pooled.load());
+  put(out, "log_dropped", "counter", log_dropped.load());
+  put(out, "log_suppressed", "counter", log_suppressed.load());
+  put(out, "file_load_queue_depth", "gauge", file_load_queue_depth.load());
+  put(out, "file_loads", "counter", file_loads.load());
+  put(out, "file_loads_rejected", "counter", file_loads_rejected.load());
+  put(out, "file_load_wait_us_total", "counter", file_load_wait_us.load());
+  put(out, "file_load_read_us_total", "counter", file_load_read_us.load());
+  put(out, "rdma_requests", "counter", rdma_reqs.load());
+  put(out, "rdma_ok", "counter", rdma_ok.load());
+  put(out, "rdma_err", "counter", rdma_err.load());
+  put(out, "rdma_bytes", "counter", rdma_bytes.load());
+
+  const auto http_labels = [](std::size_t i) {
+    return fmt::format("cache=\"{}\",method=\"{}\",status=\"{}\"", kCacheLabels[i / 12], kMethodLabels[i / 4 % 3],
+                       kStatusLabels[i % 4]);
+  };
+  put_histograms(out, "http_time_to_first_byte_seconds", http_ttfb, kHttpSeries, http_labels);
+  put_histograms(out, "http_response_seconds", http_response_time, kHttpSeries, http_labels);
+  put_histograms(out, "rdma_get_service_seconds", rdma_get_service, kRdmaSeries, [](std::size_t i) {
+    return fmt::format("cache=\"{}\",status=\"{}\"", kCacheLabels[i / 4], kStatusLabels[i % 4]);
+  });
+  return out;
+}
@@ -0,0 +1,115 @@
+#include "../../headers/util/timer_wheel.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+TimerWheel::TimerWheel(boost::asio::io_context& ioc, std::chrono::milliseconds tick, std::size_t slots)
+  : ticker_(ioc),
+    tick_(std::max(tick, std::chrono::milliseconds(1))),
+    origin_(std::chrono::steady_clock::now()),
+    slots_(std::max<std::size_t>(slots, 1), nullptr) {}
+
+void TimerWheel::start() {
+  schedule_tick();
+}
+
+void TimerWheel::arm(Timer& t, std::chrono::milliseconds timeout) {
+  // Rounded up, and counted from the next tick boundary, so a deadline
+  // never fires early.
+  const std::uint64_t ticks = static_cast<std::uint64_t>((timeout + tick_ - std::chrono::steady_clock::duration(1)) / tick_);
+  if (t.wheel_ && t.wheel_ != this) t.wheel_->cancel(t);
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (t.linked_) unlink(t);
+  t.due_ = now_ + ticks + 1;
+  ++t.generation_;
+  t.wheel_ = this;
+  link(t);
+}
+
+void TimerWheel::cancel(Timer& t) {
+  if (t.wheel_ && t.wheel_ != this) {
+    t.wheel_->cancel(t);
+    return;
+  }
+  std::lock_guard<std::mutex> lk(mtx_);
+  if (t.linked_) unlink(t);
+  ++t.generation_;
+}
+
+void TimerWheel::schedule_tick() {
+  std::uint64_t next;
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    next = now_ + 1;
+  }
+  ticker_.expires_at(origin_ + tick_ * static_cast<std::int64_t>(next));
+  ticker_.async_wait([this](const boost::system::error_code& ec) {
+    if (ec) return;
+    on_tick();
+    schedule_tick();
+  });
+}
+
+void TimerWheel::on_tick() {
+  const auto elapsed = std::chrono::steady_clock::now() - origin_;
+  const std::uint64_t target = static_cast<std::uint64_t>(elapsed / tick_);
+  {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (target <= now_) return;
+    // After a stall, every slot is visited at most once.
+    const std::uint64_t steps = std::min<std::uint64_t>(target - now_, slots_.size());
+    for (std::uint64_t i = 1; i <= steps; ++i) {
+      Timer* t = slots_[(now_ + i) % slots_.size()];
+      while (t) {
+        Timer* next = t->next_;
+        if (t->due_ <= target) {
+          unlink(*t);
+          if (auto owner = t->pin()) batch_.push_back({std::move(owner), t, t->generation_});
+        }
+        t = next;
+      }
+    }
+    now_ = target;
+  }
+  // Owners re-arm or cancel from expire(), so it runs without the lock;
+  // the pins are dropped here too, where a last reference may go.
+  for (auto& e : batch_) e.timer->expire(e.generation);
+  batch_.clear();
+}
+
+void TimerWheel::link(Timer& t) {
+  Timer*& head = slots_[t.due_ % slots_.size()];
+  t.prev_ = nullptr;
+  t.next_ = head;
+  if (head) head->prev_ = &t;
+  head = &t;
+  t.linked_ = true;
+}
+
+void TimerWheel::unlink(Timer& t) {
+  if (t.prev_) {
+    t.prev_->next_ = t.next_;
+  } else {
+    slots_[t.due_ % slots_.size()] = t.next_;
+  }
+  if (t.next_) t.next_->prev_ = t.prev_;
+  t.prev_ = t.next_ = nullptr;
+  t.linked_ = false;
+}
+
+TimerWheels::TimerWheels(boost::asio::io_context& ioc, std::chrono::milliseconds tick, unsigned count) {
+  for (unsigned i = 0; i < std::max(1u, count); ++i) wheels_.push_back(std::make_unique<TimerWheel>(ioc, tick));
+}
+
+void TimerWheels::start() {
+  for (auto& w : wheels_) w->start();
+}
+
+TimerWheel& TimerWheels::local() {
+  if (wheels_.size() == 1) return *wheels_.front();
+  // Threads are numbered as they first arm a deadline, so as many workers
+  // as wheels end up on a wheel each.
+  static std::atomic<std::size_t> next_thread{0};
+  thread_local const std::size_t thread_index = next_thread.fetch_add(1, std::memory_order_relaxed);
+  return *wheels_[thread_index % wheels_.size()];
+}
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lru_cache.hpp"
+
+// gzip storage tier for cache entries. Compressible bodies are kept
+// gzip-encoded in LRUCache so more of them fit in --cache.mem-mb; they are
+// sent as-is to clients that accept gzip and inflated for everyone else.
+// Without ENABLE_CACHE_COMPRESSION these are no-ops.
+
+bool cache_compression_available();
+
+// Text-like types that usually shrink well (HTML, CSS, JS, JSON, SVG...).
+bool is_compressible_type(const std::string& mime);
+
+// Builds a gzip-encoded copy of `e` if that saves at least 1/8 of the bytes.
+// Returns false (leaving `out` untouched) when it does not pay off.
+bool compress_entry(const LRUCache::Entry& e, LRUCache::Entry& out);
+
+// Replaces a gzip-encoded body with the original bytes.
+bool inflate_entry(LRUCache::Entry& e);
@@ -0,0 +1,162 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Bookkeeping every cache node carries for whichever policy owns it.
+// Policies only ever see this base; LRUCache derives its nodes from it.
+struct PolicyNode {
+  std::size_t hash = 0;     // std::hash of the key, computed once
+  std::size_t charge = 0;   // bytes counted against the shard budget
+
+  // Intrusive list links (LRU, SIEVE, W-TinyLFU queues)
+  PolicyNode* prev = nullptr;
+  PolicyNode* next = nullptr;
+  std::uint8_t queue = 0;
+
+  // SIEVE: set by concurrent hits under a shared lock
+  std::atomic<bool> visited{false};
+
+  // GDSF
+  std::uint32_t freq = 0;
+  double priority = 0.0;
+};
+
+// Doubly linked list threaded through PolicyNode::prev/next.
+// front = most recently inserted/used, back = oldest.
+class NodeList {
+public:
+  void push_front(PolicyNode* n);
+  void remove(PolicyNode* n);
+  PolicyNode* front() const { return head_; }
+  PolicyNode* back() const { return tail_; }
+  std::size_t bytes() const { return bytes_; }
+  bool empty() const { return head_ == nullptr; }
+
+private:
+  PolicyNode* head_ = nullptr;
+  PolicyNode* tail_ = nullptr;
+  std::size_t bytes_ = 0;
+};
+
+// Decides which entry of one cache shard to drop next. All calls happen
+// under the shard's exclusive lock, except on_hit() when concurrent_hits()
+// is true, in which case it runs under a shared lock and may only touch
+// atomics.
+class EvictionPolicy {
+public:
+  virtual ~EvictionPolicy() = default;
+
+  virtual const char* name() const = 0;
+  virtual bool concurrent_hits() const { return false; }
+
+  // Every lookup, hit or miss, before on_hit(); for frequency estimation.
+  virtual void on_access(std::size_t /*hash*/) {}
+  virtual void on_insert(PolicyNode* n) = 0;
+  virtual void on_hit(PolicyNode* n) = 0;
+  virtual void on_erase(PolicyNode* n) = 0;
+
+  // Next node to evict, still linked; the cache calls on_erase() on it.
+  // May be the node that was just inserted if it is not worth admitting.
+  virtual PolicyNode* victim() = 0;
+};
+
+// "lru", "sieve", "wtinylfu" or "gdsf"; throws std::invalid_argument otherwise.
+std::unique_ptr<EvictionPolicy> make_eviction_policy(const std::string& name, std::size_t capacity_bytes);
+
+// Strict recency order: every hit moves the entry to the front.
+class LruPolicy : public EvictionPolicy {
+public:
+  const char* name() const override { return "lru"; }
+  void on_insert(PolicyNode* n) override { list_.push_front(n); }
+  void on_hit(PolicyNode* n) override { list_.remove(n); list_.push_front(n); }
+  void on_erase(PolicyNode* n) override { list_.remove(n); }
+  PolicyNode* victim() override { return list_.back(); }
+
+private:
+  NodeList list_;
+};
+
+// SIEVE (Zhang et al., NSDI'24): a FIFO with one "visited" bit. Hits only
+// set the bit, so lookups need just a shared lock; the eviction hand skips
+// (and clears) visited entries, which also makes one-off scans cheap to evict.
+class SievePolicy : public EvictionPolicy {
+public:
+  const char* name() const override { return "sieve"; }
+  bool concurrent_hits() const override { return true; }
+  void on_insert(PolicyNode* n) override;
+  void on_hit(PolicyNode* n) override { n->visited.store(true, std::memory_order_relaxed); }
+  void on_erase(PolicyNode* n) override;
+  PolicyNode* victim() override;
+
+private:
+  NodeList list_;
+  PolicyNode* hand_ = nullptr;
+};
+
+// 4-bit-style count-min sketch with periodic halving, as used by TinyLFU.
+class FrequencySketch {
+public:
+  explicit FrequencySketch(std::size_t expected_items);
+  void increment(std::size_t hash);
+  std::uint32_t estimate(std::size_t hash) const;
+
+private:
+  std::size_t index(std::size_t hash, int row) const;
+  void age();
+
+  static constexpr int kRows = 4;
+  static constexpr std::uint8_t kMax = 15;
+  std::vector<std::uint8_t> table_;
+  std::size_t mask_ = 0;
+  std::size_t additions_ = 0;
+  std::size_t sample_size_ = 0;
+};
+
+// W-TinyLFU (Einziger et al.): new entries land in a small LRU window
+// (1% of the budget). When the window overflows, its oldest entry competes
+// with the main LRU's victim and only enters main if the frequency sketch
+// says it is more popular, so scans cannot flush the hot set.
+class WTinyLfuPolicy : public EvictionPolicy {
+public:
+  explicit WTinyLfuPolicy(std::size_t capacity_bytes);
+  const char* name() const override { return "wtinylfu"; }
+  void on_access(std::size_t hash) override { sketch_.increment(hash); }
+  void on_insert(PolicyNode* n) override;
+  void on_hit(PolicyNode* n) override;
+  void on_erase(PolicyNode* n) override;
+  PolicyNode* victim() override;
+
+private:
+  enum Queue : std::uint8_t { Window = 1, Main = 2 };
+  NodeList& list_of(PolicyNode* n) { return n->queue == Window ? window_ : main_; }
+
+  std::size_t window_capacity_;
+  NodeList window_;
+  NodeList main_;
+  FrequencySketch sketch_;
+};
+
+// Greedy-Dual-Size-Frequency: priority = L + freq / size, evicting the
+// lowest and raising L to it. Small, frequently used files outlive large,
+// rarely used ones; L ages out entries that stopped being requested.
+class GdsfPolicy : public EvictionPolicy {
+public:
+  const char* name() const override { return "gdsf"; }
+  void on_insert(PolicyNode* n) override;
+  void on_hit(PolicyNode* n) override;
+  void on_erase(PolicyNode* n) override;
+  PolicyNode* victim() override;
+
+private:
+  double priority_of(const PolicyNode* n) const;
+  void place(PolicyNode* n);
+
+  double inflation_ = 0.0;
+  std::set<std::pair<double, PolicyNode*>> order_;
+};
@@ -1,6 +1,9 @@
 #pragma once
+#include "eviction_policy.hpp"
+
+#include <atomic>
+#include <cstdint>
 #include <unordered_map>
-#include <list>
 #include <memory>
 #include <shared_mutex>
 #include <vector>
@@ -14,30 +17,98 @@ public:
     std::size_t size = 0;
     std::time_t last_modified = 0;
     std::string etag;
+    // Non-zero for large files: `body` is empty and the content lives in
+    // separate entries of this many bytes each (see segment_key()).
+    std::size_t segment_size = 0;
+    // `body` holds the gzip encoding of the `size`-byte file (see compression.hpp).
+    bool gzip = false;
+    // Pre-rendered head of a full 200 response sending `body` as stored,
+    // without the Date and Connection lines (see render_cached_head()).
+    std::shared_ptr<const std::string> head;
+    // The same for the 304 answering a request that already has it.
+    std::shared_ptr<const std::string> head_304;
+
+    // Back to empty but keeps etag's buffer, so an Entry reused as a
+    // get() target takes the next ETag without allocating.
+    void clear() {
+      body.reset();
+      size = 0;
+      last_modified = 0;
+      etag.clear();
+      segment_size = 0;
+      gzip = false;
+      head.reset();
+      head_304.reset();
+    }
   };
 
-  explicit LRUCache(std::size_t capacity_bytes)
-    : capacity_bytes_(capacity_bytes) {}
+  // The byte budget is split evenly across `shards` independent caches, each
+  // with its own lock, so concurrent hits on different keys do not contend.
+  // `policy` picks the eviction strategy (see make_eviction_policy()).
+  explicit LRUCache(std::size_t capacity_bytes, std::size_t shards = 1,
+                    const std::string& policy = "lru");
 
   bool get(const std::string& key, Entry& out);
   void put(const std::string& key, const Entry& e);
+  // Invalidation epoch of the shard holding `key`, moved on by every erase
+  // that reaches the shard, present key or not. A load takes it before it
+  // opens the file and hands it to put(), which then drops an entry whose
+  // file was invalidated while it was being read (false if dropped).
+  std::uint64_t epoch(const std::string& key) const;
+  bool put(const std::string& key, const Entry& e, std::uint64_t epoch);
+  void erase(const std::string& key);
+  // Drops `key` and, if it is a segment manifest, every one of its segments.
+  void erase_file(const std::string& key);
+  // Drops every key starting with `prefix`; a full scan, for rare bulk events.
+  void erase_prefix(const std::string& prefix);
+
+  // Key under which segment `index` of the file cached at `key` is stored.
+  // URL cache keys never contain '#', so these cannot collide with them.
+  static std::string segment_key(const std::string& key, std::size_t index) {
+    return key + "#" + std::to_string(index);
+  }
+
+  // Key for the `coding` (e.g. "br") precompressed variant of `key`.
+  // URL cache keys never contain '?', so these cannot collide either.
+  static std::string variant_key(const std::string& key, const std::string& coding) {
+    return key + "?" + coding;
+  }
 
   std::size_t size_bytes() const;
   std::size_t capacity_bytes() const { return capacity_bytes_; }
+  // Largest body a single entry can have and still stay resident.
+  std::size_t max_entry_bytes() const { return capacity_bytes_ / shards_.size(); }
+  std::size_t shard_count() const { return shards_.size(); }
   std::size_t items() const;
+  const char* policy_name() const { return shards_[0]->policy->name(); }
 
 private:
-  struct Node {
+  struct Node : PolicyNode {
     std::string key;
     Entry value;
   };
 
-  mutable std::shared_mutex mtx_;
-  std::size_t capacity_bytes_;
-  std::size_t used_bytes_{0};
+  // Padded to a cache line so neighbouring shard locks never share one.
+  struct alignas(64) Shard {
+    mutable std::shared_mutex mtx;
+    std::atomic<std::uint64_t> epoch{0};  // bumped under the unique lock
+    std::size_t capacity_bytes = 0;
+    std::size_t used_bytes = 0;
 
-  std::list<Node> lru_; // front = most recent
-  std::unordered_map<std::string, std::list<Node>::iterator> map_;
+    std::unique_ptr<EvictionPolicy> policy;
+    std::unordered_map<std::string, std::unique_ptr<Node>> map;
+
+    void evict_if_needed();
+    void remove(Node* n);
+    void insert(const std::string& key, std::size_t hash, const Entry& e);
+  };
+
+  Shard& shard_for(std::size_t hash) const;
+
+  std::size_t capacity_bytes_;
+  std::vector<std::unique_ptr<Shard>> shards_;
 
-  void evict_if_needed();
+  static std::size_t charge(const Entry& e) { return e.body ? e.body->size() : 0; }
+  // Keeps the compressed-tier gauges in Metrics in step with residency.
+  static void track(const Entry& e, bool added);
 };
\ No newline at end of file
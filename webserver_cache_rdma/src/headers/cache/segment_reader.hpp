@@ -0,0 +1,81 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <ctime>
+
+#include "lru_cache.hpp"
+#include "single_flight.hpp"
+#include "../fs/async_file_reader.hpp"
+#include "../fs/file_reader.hpp"
+#include "../http/body.hpp"
+
+// Serves byte ranges of a file that is cached as fixed-size segments.
+// Every segment is its own LRUCache entry: a segment that is not resident
+// is loaded on demand and admitted on its own, so the hot parts of a large
+// file stay in memory while the cold parts can be evicted. Loads go
+// through the AsyncFileReader, one per segment however many responses
+// miss it at once; the caller waits for load() and then asks again.
+class SegmentReader : public std::enable_shared_from_this<SegmentReader> {
+public:
+  // `files` may be null: segments are then read on the caller's thread.
+  SegmentReader(std::shared_ptr<LRUCache> cache,
+                std::shared_ptr<SingleFlight> flights,
+                std::shared_ptr<AsyncFileReader> files,
+                std::string key,
+                std::string fs_path,
+                LRUCache::Entry manifest,
+                FileOpenResult opened = {});
+
+  const LRUCache::Entry& manifest() const { return manifest_; }
+
+  enum class Slice {
+    ready,    // `out` is set
+    missing,  // the segment must be load()ed first
+    failed,   // `err` says why: the file changed or could not be opened
+  };
+
+  // Resolves the body part starting at `offset`, clipped to the end of its
+  // segment and to `max_len`, without touching the disk. A segment that
+  // could never fit in the cache is returned as a file range instead.
+  Slice slice(std::uint64_t offset, std::uint64_t max_len, BodyPart& out, std::string& err);
+
+  // Copies [offset, offset + len) into `dst` across segments, up to the
+  // first one that is missing; `copied` says how far it got. Never returns
+  // a file range: a segment too large for the cache is missing until
+  // load() has read it into memory.
+  Slice copy(std::uint64_t offset, std::uint8_t* dst, std::size_t len, std::size_t& copied, std::string& err);
+
+  // Loads the segment holding `offset` and keeps it for the next slice()
+  // even if the cache lets it go. `done` runs on whichever thread finished
+  // the read, so it should only hand off (post); the reader stays alive
+  // until then. Do not use the reader before `done` runs.
+  void load(std::uint64_t offset, std::function<void(const FlightResult&)> done);
+
+private:
+  // slice(), or with `allow_file` false what copy() needs: a segment too
+  // large for the cache is then missing until load() reads it.
+  Slice resolve(std::uint64_t offset, std::uint64_t max_len, bool allow_file, BodyPart& out, std::string& err);
+  bool ensure_open(std::string& err);
+  bool keep(std::size_t index, const FlightResult& loaded);
+
+  std::shared_ptr<LRUCache> cache_;
+  std::shared_ptr<SingleFlight> flights_;
+  std::shared_ptr<AsyncFileReader> files_;
+  std::string key_;
+  std::string fs_path_;
+  LRUCache::Entry manifest_;
+  FileOpenResult file_;
+  // The last segment load()ed, so the response can go on even if it was
+  // evicted (or never admitted) before the caller came back for it.
+  std::shared_ptr<const std::vector<uint8_t>> loaded_;
+  std::size_t loaded_index_ = 0;
+};
+
+// Whether `opened` is still the file `manifest` was taken from. Segments
+// are only checked as they miss, so a manifest hit is checked with this.
+bool manifest_matches(const LRUCache::Entry& manifest, const FileOpenResult& opened);
+
+// Builds the body-less entry that marks `key` as a segmented file.
+LRUCache::Entry make_segment_manifest(std::size_t size, std::time_t mtime, std::size_t segment_size);
@@ -0,0 +1,35 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lru_cache.hpp"
+
+// Outcome of one load, handed to every request that waited on it.
+struct FlightResult {
+  bool ok = false;
+  LRUCache::Entry entry;
+  std::string error;
+  bool overloaded = false;  // the file reader refused the load (503)
+};
+
+// Coalesces concurrent cache misses for the same key: the first caller
+// loads the file and fills the cache, everyone else arriving meanwhile is
+// parked and handed the leader's result instead of reading it again.
+class SingleFlight {
+public:
+  using Waiter = std::function<void(const FlightResult&)>;
+
+  // Returns true if the caller leads the load for `key` and must call
+  // complete(). Otherwise `waiter` is stored and invoked, on the leader's
+  // thread, once the load finishes; it should only hand off (post) work.
+  bool join(const std::string& key, Waiter waiter);
+
+  void complete(const std::string& key, const FlightResult& result);
+
+private:
+  std::mutex mtx_;
+  std::unordered_map<std::string, std::vector<Waiter>> inflight_;
+};
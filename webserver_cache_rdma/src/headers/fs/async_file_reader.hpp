@@ -0,0 +1,26 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+
+#include "file_reader.hpp"
+
+// Reads files, or byte ranges of them, without blocking the calling
+// thread. `done` runs on a thread of the reader's choosing, so callers
+// post back to their own executor before touching their state.
+class AsyncFileReader {
+public:
+  using Callback = std::function<void(FileReadResult)>;
+
+  virtual ~AsyncFileReader() = default;
+
+  virtual const char* name() const = 0;
+
+  // Reads `len` bytes at `offset`; a file that ends first fails the read.
+  virtual void read_range(FileOpenResult opened, std::uint64_t offset, std::size_t len, Callback done) = 0;
+
+  // Reads the whole file, at the size it had when it was opened.
+  void read(FileOpenResult opened, Callback done) {
+    const std::size_t size = opened.size;
+    read_range(std::move(opened), 0, size, std::move(done));
+  }
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <array>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class LRUCache;
+
+// Watches the document root (recursively) with inotify and reports every
+// file or directory that changed as a URL path, e.g. "/css/site.css".
+// Events are read on the io_context like any socket, so keeping caches
+// coherent costs nothing on the request path.
+class DocRootWatcher {
+public:
+  // `url_path` is "/"-rooted; `is_dir` means everything below it may have
+  // changed ("/" with is_dir = true after an event queue overflow).
+  using Listener = std::function<void(const std::string& url_path, bool is_dir)>;
+
+  DocRootWatcher(boost::asio::io_context& ioc, const std::string& doc_root);
+  ~DocRootWatcher();
+
+  void add_listener(Listener l) { listeners_.push_back(std::move(l)); }
+
+  // False (with a warning printed) where inotify is unavailable.
+  bool start();
+
+private:
+  void add_tree(const std::string& fs_dir, const std::string& url_dir);
+  void forget_tree(const std::string& url_dir);
+  void do_read();
+  void on_events(std::size_t n);
+  void notify(const std::string& url_path, bool is_dir);
+
+  std::string root_;
+  boost::asio::posix::stream_descriptor stream_;
+  std::unordered_map<int, std::string> dirs_; // watch descriptor -> URL dir ("" for the root)
+  std::vector<Listener> listeners_;
+  alignas(8) std::array<char, 16384> buf_{};
+};
+
+// Listener body for LRUCache: drops the file's entry, its segments and its
+// precompressed variants (or the original, when a .br/.gz sibling changed).
+void invalidate_cached_path(LRUCache& cache, const std::string& url_path, bool is_dir);
@@ -0,0 +1,49 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "async_file_reader.hpp"
+
+// AsyncFileReader on a small pool of threads that do plain blocking reads,
+// so a slow disk stalls a loader thread instead of an io_context worker or
+// an RDMA poller. The queue is bounded: once `max_queued` reads are
+// waiting, a read is refused at once (FileReadResult::overloaded, on the
+// caller's thread), which pushes back on whoever is producing misses
+// faster than the disk serves them. Other callbacks run on a loader thread.
+class FileLoadPool : public AsyncFileReader {
+public:
+  FileLoadPool(unsigned threads, std::size_t max_queued);
+  ~FileLoadPool() override;
+
+  const char* name() const override { return "thread pool"; }
+  void read_range(FileOpenResult opened, std::uint64_t offset, std::size_t len, Callback done) override;
+
+  // Joins the loader threads, then fails the reads still queued: their
+  // callbacks run on the calling thread with "Operation aborted".
+  // Idempotent.
+  void stop();
+
+private:
+  struct Job {
+    FileOpenResult opened;
+    std::uint64_t offset = 0;
+    std::size_t len = 0;
+    Callback done;
+    std::chrono::steady_clock::time_point queued_at;
+  };
+
+  void run();
+  static void load(Job& job);
+
+  const std::size_t max_queued_;
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::deque<Job> queue_;  // under mtx_
+  bool stopping_ = false;  // under mtx_
+  std::vector<std::thread> threads_;
+};
@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <string>
 #include <vector>
+#include <memory>
 #include <ctime>
 
 struct FileReadResult {
@@ -9,10 +10,50 @@ struct FileReadResult {
   std::vector<uint8_t> data;
   std::time_t last_modified = 0;
   std::string error;
+  // Refused, not failed: the reader had no room for it (answer 503).
+  bool overloaded = false;
+};
+
+// Owning read-only file descriptor. Shared between a response and the
+// writer so the descriptor stays open until the last byte is sent.
+class OpenFile {
+public:
+  OpenFile() = default;
+  explicit OpenFile(int fd) : fd_(fd) {}
+  ~OpenFile();
+  OpenFile(const OpenFile&) = delete;
+  OpenFile& operator=(const OpenFile&) = delete;
+
+  int fd() const { return fd_; }
+
+private:
+  int fd_ = -1;
+};
+
+struct FileOpenResult {
+  bool ok = false;
+  std::shared_ptr<const OpenFile> file;
+  std::size_t size = 0;
+  std::time_t last_modified = 0;
+  std::string error;
 };
 
 FileReadResult read_file(const std::string& path);
 
-inline std::string make_etag(std::size_t size, std::time_t mtime) {
-  return "W/\"" + std::to_string(size) + "-" + std::to_string(static_cast<long long>(mtime)) + "\"";
-}
\ No newline at end of file
+// Opens a regular file and captures its size and mtime from a single fstat.
+FileOpenResult open_file(const std::string& path);
+
+// Reads the whole file behind an already opened descriptor.
+FileReadResult read_file(const FileOpenResult& opened);
+
+// Reads `len` bytes at `offset` behind an already opened descriptor.
+FileReadResult read_file(const FileOpenResult& opened, std::uint64_t offset, std::size_t len);
+
+// Reads exactly `len` bytes at `offset`; false on I/O error or a short file.
+bool read_file_range(const OpenFile& file, std::uint64_t offset, uint8_t* dst, std::size_t len);
+
+// `coding` tags precompressed variants so they never share the original's ETag.
+inline std::string make_etag(std::size_t size, std::time_t mtime, const std::string& coding = {}) {
+  return "W/\"" + std::to_string(size) + "-" + std::to_string(static_cast<long long>(mtime)) +
+         (coding.empty() ? "" : "-" + coding) + "\"";
+}
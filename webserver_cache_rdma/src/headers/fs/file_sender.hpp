@@ -0,0 +1,9 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Copies up to `count` bytes of `in_fd` starting at `offset` straight into
+// `out_fd` without staging them in user space (sendfile on Linux).
+// Returns the number of bytes sent, 0 at end of file, or -1 with errno set;
+// EAGAIN means a non-blocking socket is full and the caller should wait.
+long send_file_some(int out_fd, int in_fd, std::uint64_t offset, std::size_t count);
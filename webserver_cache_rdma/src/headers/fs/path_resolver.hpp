@@ -0,0 +1,63 @@
+#pragma once
+#include <chrono>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "path_utils.hpp"
+
+// map_url_to_fs() with memory: resolved paths of existing files are kept
+// per sanitized URL, so a repeat request costs one string sanitize and a
+// hash lookup instead of canonicalization and stat calls. Only correct
+// while something reports doc_root changes through invalidate(), so that
+// cache is switched off unless the doc root is being watched.
+// Paths that go through a symlink are never kept: re-pointing a link
+// only reports the link's own name.
+//
+// Misses (not found, rejected) go to a separate negative cache that is
+// bounded, oldest-first, and expires entries after a TTL, so scanners
+// hammering junk URLs neither touch the filesystem nor grow memory.
+class PathResolver {
+public:
+  PathResolver(const std::string& doc_root,
+               bool cache_results,
+               std::size_t negative_entries = 0,
+               std::chrono::milliseconds negative_ttl = std::chrono::milliseconds(0));
+
+  std::shared_ptr<const PathMapResult> resolve(std::string_view url_path);
+
+  // DocRootWatcher listener: forgets `url_path` (and everything below it
+  // when `is_dir`), positive or negative, and the file a changed .br/.gz
+  // sibling belongs to.
+  void invalidate(const std::string& url_path, bool is_dir);
+
+  std::size_t size() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Negative {
+    std::shared_ptr<const PathMapResult> result;
+    Clock::time_point expires;
+    std::list<std::string>::iterator pos;  // in negative_order_
+  };
+
+  bool lookup_negative(const std::string& sanitized, std::shared_ptr<const PathMapResult>& out) const;
+  void remember_negative(const std::string& sanitized, std::shared_ptr<const PathMapResult> r);
+  void erase_negative_locked(std::unordered_map<std::string, Negative>::iterator it);
+  void forget_file_locked(const std::string& url_path);
+
+  std::string doc_root_;
+  std::filesystem::path root_;  // canonical doc_root, resolved once
+  bool cache_results_;
+  std::size_t negative_capacity_;
+  Clock::duration negative_ttl_;
+
+  mutable std::shared_mutex mtx_;
+  std::unordered_map<std::string, std::shared_ptr<const PathMapResult>> map_;
+  std::unordered_map<std::string, Negative> negative_;
+  std::list<std::string> negative_order_;  // front = newest
+};
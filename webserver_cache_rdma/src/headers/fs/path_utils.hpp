@@ -1,12 +1,35 @@
 #pragma once
+#include <filesystem>
 #include <string>
+#include <string_view>
+#include <vector>
+
+// Where a precompressed sibling (see kPrecompressedVariants) would live.
+struct PrecompressedPath {
+  const char* coding;
+  std::string cache_key;
+  std::string fs_path;
+};
 
 struct PathMapResult {
   bool ok = false;
   bool exists = false;
-  std::string fs_path;
-  std::string cache_key;
+  std::string fs_path;    // canonical: symlinks resolved
+  std::string cache_key;  // URL path of fs_path
+  bool via_symlink = false;  // fs_path is not the URL's lexical path
   std::string error;
+  // The kPrecompressedVariants siblings found next to an existing file, in
+  // order; checked here so that results cached by PathResolver remember
+  // which are absent, until DocRootWatcher reports a sibling change.
+  std::vector<PrecompressedPath> variants;
 };
 
-PathMapResult map_url_to_fs(const std::string& doc_root, const std::string& url_path);
\ No newline at end of file
+PathMapResult map_url_to_fs(const std::string& doc_root, std::string_view url_path);
+
+// Strips query/fragment and resolves "." / ".." lexically; always "/"-rooted.
+std::string sanitize_url_path(std::string_view url_path);
+// Same, into `out`, reusing its buffer.
+void sanitize_url_path(std::string_view url_path, std::string& out);
+
+// map_url_to_fs() for an already sanitized path under a canonical root.
+PathMapResult map_sanitized_to_fs(const std::filesystem::path& canonical_root, const std::string& sanitized);
\ No newline at end of file
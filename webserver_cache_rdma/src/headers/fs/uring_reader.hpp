@@ -0,0 +1,53 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "async_file_reader.hpp"
+
+// Whether the binary was built with ENABLE_IO_URING.
+bool io_uring_available();
+
+// AsyncFileReader on an io_uring instance, driven through the raw
+// syscalls (no liburing). Completions are signalled on an eventfd that
+// `ioc` waits on, so callbacks run on whichever thread runs `ioc`.
+// Reads larger than one SQE allows, and short reads, are resubmitted for
+// the remainder. At most one read per SQ entry is in flight (so the CQ
+// cannot overflow); the rest wait in a backlog that completions drain.
+class UringReader : public AsyncFileReader {
+public:
+  // Returns nullptr and sets `error` if the ring cannot be created (old
+  // kernel, seccomp, or built without ENABLE_IO_URING). One READ asks for
+  // at most `max_read` bytes; a larger file takes several, as a short
+  // read would.
+  static std::unique_ptr<UringReader> create(boost::asio::io_context& ioc, unsigned entries, std::string& error,
+                                             std::size_t max_read = std::size_t{1} << 30);
+  ~UringReader() override;
+
+  const char* name() const override { return "io_uring"; }
+  void read_range(FileOpenResult opened, std::uint64_t offset, std::size_t len, Callback done) override;
+
+private:
+  struct Op;
+  struct Ring;
+
+  UringReader(boost::asio::io_context& ioc, std::unique_ptr<Ring> ring, int event_fd, std::size_t max_read);
+
+  bool submit(Op* op);
+  int enqueue_locked(Op* op);
+  void submit_backlog();
+  void read_inline(Op* op);
+  void wait_for_completions();
+  void reap();
+  void finish(Op* op, bool ok, const char* error);
+
+  std::unique_ptr<Ring> ring_;
+  const std::size_t max_read_;
+  std::mutex sq_mutex_;  // guards the submission queue across threads
+  boost::asio::posix::stream_descriptor event_;
+  std::uint64_t in_flight_ = 0;  // under sq_mutex_
+  std::deque<Op*> backlog_;      // under sq_mutex_; nonempty only while reads are in flight
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "../fs/file_reader.hpp"
+
+class SegmentReader;
+
+// One slice of a response body. Exactly one source is set:
+//  - data:     bytes already in memory
+//  - file:     a byte range of an open file, streamed with sendfile
+//  - segments: a byte range of a segment-cached file, resolved one
+//              segment at a time while the response is written
+struct BodyPart {
+  std::shared_ptr<const std::vector<uint8_t>> data;
+  std::shared_ptr<const OpenFile> file;
+  std::shared_ptr<SegmentReader> segments;
+  std::uint64_t offset = 0;
+  std::uint64_t length = 0;
+
+  static BodyPart from_memory(std::shared_ptr<const std::vector<uint8_t>> d) {
+    BodyPart p;
+    p.length = d ? d->size() : 0;
+    p.data = std::move(d);
+    return p;
+  }
+
+  static BodyPart from_memory(std::shared_ptr<const std::vector<uint8_t>> d, std::uint64_t off, std::uint64_t len) {
+    BodyPart p;
+    p.data = std::move(d);
+    p.offset = off;
+    p.length = len;
+    return p;
+  }
+
+  static BodyPart from_file(std::shared_ptr<const OpenFile> f, std::uint64_t off, std::uint64_t len) {
+    BodyPart p;
+    p.file = std::move(f);
+    p.offset = off;
+    p.length = len;
+    return p;
+  }
+
+  static BodyPart from_segments(std::shared_ptr<SegmentReader> s, std::uint64_t off, std::uint64_t len) {
+    BodyPart p;
+    p.segments = std::move(s);
+    p.offset = off;
+    p.length = len;
+    return p;
+  }
+};
@@ -0,0 +1,8 @@
+#pragma once
+#include <string>
+#include <ctime>
+#include "request.hpp"
+
+// RFC 7232 evaluation of If-None-Match / If-Modified-Since for GET and HEAD.
+// If-None-Match wins when both are present; ETags compare weakly.
+bool is_not_modified(const HttpRequest& req, const std::string& etag, std::time_t last_modified);
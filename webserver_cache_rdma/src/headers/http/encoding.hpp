@@ -0,0 +1,19 @@
+#pragma once
+#include <string_view>
+
+// A precompressed sibling written by the build pipeline next to the original
+// file, e.g. app.js.br for app.js.
+struct PrecompressedVariant {
+  const char* coding;   // Content-Encoding token
+  const char* suffix;   // file name suffix on disk
+};
+
+// Variants in server preference order (best compression first).
+inline constexpr PrecompressedVariant kPrecompressedVariants[] = {
+  {"br", ".br"},
+  {"gzip", ".gz"},
+};
+
+// Quality value (0..1) the client assigns to `coding` in an Accept-Encoding
+// header, honouring explicit q=0 and the "*" wildcard. 0 means unacceptable.
+double encoding_quality(std::string_view accept_encoding, std::string_view coding);
@@ -1,9 +1,23 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <algorithm>
+#include <cctype>
 
 inline std::string header_lower(const std::string& s) {
   std::string out = s;
   std::transform(out.begin(), out.end(), out.begin(), [](unsigned char c){ return static_cast<char>(std::tolower(c)); });
   return out;
-}
\ No newline at end of file
+}
+
+// ASCII case-insensitive equality, for header names and tokens.
+inline bool header_iequals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    char x = a[i], y = b[i];
+    if (x >= 'A' && x <= 'Z') x = static_cast<char>(x + ('a' - 'A'));
+    if (y >= 'A' && y <= 'Z') y = static_cast<char>(y + ('a' - 'A'));
+    if (x != y) return false;
+  }
+  return true;
+}
@@ -1,32 +1,64 @@
 #pragma once
 #include <string>
-#include <unordered_map>
-#include <vector>
 #include "request.hpp"
+#include "scan.hpp"
+#include "../util/buffer_pool.hpp"
 
 enum class ParseState {
   Incomplete,
   Done,
-  BadRequest
-};
-
-struct ParseResult {
-  ParseState state;
-  HttpRequest request;
+  BadRequest,
+  TooManyHeaders  // more fields than allowed: 431
 };
 
+// Incremental, in-place HTTP/1.1 request head parser. The session reads
+// straight into the parser's buffer, and parsed requests are views into
+// it, so a request costs no copies and no allocations. The buffer has a
+// fixed capacity (the largest head allowed) and is never reallocated;
+// bytes only move in compact(), which the owner calls when no request is
+// live and no read is targeting the buffer. It is borrowed from
+// ReadBufferPool on the first read_ptr() and handed back by
+// release_buffer(), so a parser with nothing buffered holds no memory.
 class HttpParser {
 public:
-  HttpParser(std::size_t max_start_line, std::size_t max_headers_bytes)
-    : max_start_line_(max_start_line), max_headers_bytes_(max_headers_bytes) {}
+  HttpParser(std::size_t max_start_line, std::size_t max_headers_bytes, std::size_t max_header_fields);
+
+  // Free tail of the buffer for the next read; zero space while full.
+  char* read_ptr() {
+    if (!buf_) buf_ = ReadBufferPool::acquire(capacity_);
+    return buf_.get() + end_;
+  }
+  std::size_t read_space() const { return capacity_ - end_; }
+  void commit(std::size_t n) { end_ += n; }
+  // Bytes read but not parsed yet: part of a request still arriving.
+  std::size_t unparsed() const { return end_ - begin_; }
+
+  // Parses the next buffered request into `out`. Only one request may be
+  // live at a time: call release() before asking for the next.
+  ParseState next(HttpRequest& out);
+  void release() { live_ = false; }
+  bool live() const { return live_; }
 
-  ParseResult parse(const char* data, std::size_t n);
+  // Moves unparsed bytes to the front to make room for reads.
+  void compact();
   void reset();
 
+  // Returns the buffer to the pool if it holds nothing: no live request
+  // and no unparsed bytes. No read may be targeting it.
+  void release_buffer();
+  bool has_buffer() const { return buf_ != nullptr; }
+
 private:
-  std::string buf_;
+  ParseState parse_head(const char* p, std::size_t len, HttpRequest& out) const;
+
+  ReadBufferPool::Buffer buf_;
+  std::size_t capacity_;
+  std::size_t begin_ = 0;    // first byte not yet parsed
+  std::size_t end_ = 0;      // one past the last byte read
+  std::size_t scanned_ = 0;  // [begin_, scanned_) holds no complete terminator
+  bool live_ = false;
   std::size_t max_start_line_;
   std::size_t max_headers_bytes_;
-
-  bool try_parse(HttpRequest& out);
-};
\ No newline at end of file
+  std::size_t max_header_fields_;
+  const ScanKernels& scan_;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Inclusive byte range, already clamped to the representation size.
+struct ByteRange {
+  std::uint64_t first = 0;
+  std::uint64_t last = 0;
+
+  std::uint64_t length() const { return last - first + 1; }
+};
+
+enum class RangeResult {
+  None,           // no usable Range header: send the full 200 response
+  Satisfiable,    // `out` holds at least one range
+  Unsatisfiable   // syntactically valid, but nothing overlaps the body: 416
+};
+
+// Parses a "bytes=" Range header value (RFC 7233) against a body of `size`
+// bytes. Malformed headers, other units and more than `max_ranges` ranges
+// are treated as absent, which the RFC permits.
+RangeResult parse_range(std::string_view value, std::uint64_t size,
+                        std::vector<ByteRange>& out, std::size_t max_ranges = 16);
+
+// Whether an If-Range validator still names the current representation.
+// Our ETags are weak, so this is an exact match against the ETag or the
+// Last-Modified date we send rather than a strict strong comparison.
+bool if_range_matches(std::string_view value, const std::string& etag, const std::string& last_modified);
@@ -1,13 +1,31 @@
 #pragma once
-#include <string>
-#include <unordered_map>
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <vector>
 
+// One "Name: value" line, value trimmed; both views point into the parser's buffer.
+struct HeaderField {
+  std::string_view name;
+  std::string_view value;
+};
+
+// A parsed request. Every view points into the session's input buffer and
+// stays valid until the session hands the request back (HttpParser::release()).
 struct HttpRequest {
-  std::string method;
-  std::string target;
-  std::string version;
-  std::unordered_map<std::string, std::string> headers;
+  static constexpr std::size_t kInlineHeaders = 64;
+
+  std::string_view method;
+  std::string_view target;
+  std::string_view version;
+  // The first kInlineHeaders fields, then the rest in `more_headers`,
+  // which only a request with unusually many fields ever allocates.
+  std::array<HeaderField, kInlineHeaders> headers{};
+  std::vector<HeaderField> more_headers;
+  std::size_t header_count = 0;  // of both
   bool keep_alive = true;
 
-  std::string header(const std::string& name) const;
-};
\ No newline at end of file
+  // Case-insensitive; empty if absent. A linear scan of a couple of dozen
+  // fields beats hashing them, and the last duplicate wins.
+  std::string_view header(std::string_view name) const;
+};
@@ -2,6 +2,7 @@
 #include <string>
 #include <unordered_map>
 #include "../util/time.hpp"
+#include "body.hpp"
 
 struct HttpResponse {
   int status = 200;
@@ -13,7 +14,7 @@ struct HttpResponse {
     h.reserve(256);
     h += "HTTP/1.1 " + std::to_string(status) + " " + reason + "\r\n";
     if (headers.find("Date") == headers.end()) {
-      h += "Date: " + now_http_date() + "\r\n";
+      h += *date_header_line();
     }
     for (const auto& kv : headers) {
       h += kv.first + ": " + kv.second + "\r\n";
@@ -21,4 +22,36 @@ struct HttpResponse {
     h += "\r\n";
     return h;
   }
-};
\ No newline at end of file
+};
+
+// Head of a full 200 response for a cached body, rendered once when the
+// entry is cached. The Date and Connection lines and the blank line are
+// left off; the writer appends them per response.
+inline std::string render_cached_head(const std::string& content_type,
+                                      const std::string& etag,
+                                      std::time_t last_modified,
+                                      std::size_t content_length,
+                                      const std::string& coding) {
+  std::string h;
+  h.reserve(256);
+  h += "HTTP/1.1 200 OK\r\n";
+  h += "Content-Type: " + content_type + "\r\n";
+  h += "Content-Length: " + std::to_string(content_length) + "\r\n";
+  h += "Last-Modified: " + format_http_date(last_modified) + "\r\n";
+  h += "ETag: " + etag + "\r\n";
+  h += "Accept-Ranges: bytes\r\n";
+  h += "Vary: Accept-Encoding\r\n";
+  if (!coding.empty()) h += "Content-Encoding: " + coding + "\r\n";
+  return h;
+}
+
+// render_cached_head() for the 304 sent when the client's copy is current.
+inline std::string render_not_modified_head(const std::string& etag, std::time_t last_modified) {
+  std::string h;
+  h.reserve(128);
+  h += "HTTP/1.1 304 Not Modified\r\n";
+  h += "ETag: " + etag + "\r\n";
+  h += "Last-Modified: " + format_http_date(last_modified) + "\r\n";
+  h += "Vary: Accept-Encoding\r\n";
+  return h;
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Byte-scanning kernels behind HttpParser. Each has a scalar version and,
+// on x86, SSE4.2 and AVX2 versions; the best one the CPU supports is
+// picked once at startup. All variants return identical results (the
+// vector code only finds candidates, final checks are scalar) and never
+// read outside [p, end).
+struct ScanKernels {
+  const char* name;
+
+  // First "\r\n\r\n" in [p, end), or end.
+  const char* (*find_head_end)(const char* p, const char* end);
+
+  // First "\r\n" in [p, end), or end.
+  const char* (*find_crlf)(const char* p, const char* end);
+
+  // First byte in [p, end) that is not an RFC 7230 tchar, or end. For a
+  // header line this is where the colon should be.
+  const char* (*skip_token)(const char* p, const char* end);
+};
+
+const ScanKernels& scan_kernels();
+
+// Every variant this CPU can run, scalar first; for tests and benchmarks.
+std::vector<const ScanKernels*> available_scan_kernels();
+
+constexpr bool is_token_char(char c) {
+  switch (c) {
+    case '(': case ')': case '<': case '>': case '@': case ',': case ';': case ':':
+    case '\\': case '"': case '/': case '[': case ']': case '?': case '=':
+    case '{': case '}':
+      return false;
+    default:
+      return c > 32 && c < 127;
+  }
+}
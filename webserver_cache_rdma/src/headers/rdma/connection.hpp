@@ -7,9 +7,16 @@
 #include <mutex>
 #include <deque>
 #include <atomic>
+#include <chrono>
+#include <functional>
 
 #include "../util/config.hpp"
 #include "../cache/lru_cache.hpp"
+#include "../cache/single_flight.hpp"
+#include "../fs/path_resolver.hpp"
+#include "../fs/async_file_reader.hpp"
+#include "../cache/segment_reader.hpp"
+#include "protocol.hpp"
 
 namespace rdma_fast {
 
@@ -51,7 +58,10 @@ public:
              ibv_pd* pd,
              ibv_cq* cq,
              const Config& cfg,
-             std::shared_ptr<LRUCache> cache);
+             std::shared_ptr<LRUCache> cache,
+             std::shared_ptr<SingleFlight> flights,
+             std::shared_ptr<PathResolver> paths,
+             std::shared_ptr<AsyncFileReader> files);
   ~Connection();
 
   // Setup RECVs and ready to accept
@@ -70,13 +80,45 @@ public:
   uint32_t qp_num() const { return id_->qp ? id_->qp->qp_num : 0; }
 
 private:
+  struct Pending {
+    bool parsed = false;
+    Request req;
+    std::chrono::steady_clock::time_point received;
+  };
+
+  // Request ordering. handle() returns false when the answer finishes
+  // later, from a file load; finish_get() then calls next_request().
+  void dispatch(Pending p);
+  void next_request();
+  bool handle(const Pending& p);
+  // Records the answered GET's service time (Metrics::rdma_get_service).
+  void record_get();
+
   // Protocol handling
   void handle_ping();
-  void handle_get(const std::string& url_path);
+  bool handle_get(const std::string& url_path);
+  FlightResult load_into_cache(const std::string& cache_key, FileReadResult fr, std::uint64_t epoch);
+  // These return false, like handle(), when the answer finishes later:
+  // a segment of the body had to be loaded first.
+  bool serve_loaded(const std::string& cache_key, const std::string& fs_path, const FlightResult& loaded);
+  bool serve_entry(const std::string& cache_key, const std::string& fs_path, LRUCache::Entry entry,
+                   FileOpenResult opened);
+  // Records the GET's service time and moves on; runs on a poller thread
+  // (RDMAServer::post) once an answer that had to wait is done.
+  void finish_get();
 
   // Send helpers
   bool send_header(uint16_t status, uint64_t content_len, uint32_t chunk);
-  bool send_body_chunks(const std::shared_ptr<std::vector<uint8_t>>& body, uint32_t chunk);
+  // Fills [offset, offset + n) of the body into a registered send buffer.
+  using ChunkFill = std::function<bool(uint64_t offset, uint8_t* dst, size_t n)>;
+  bool send_body_chunks(uint64_t total, uint32_t chunk, const ChunkFill& fill);
+  // Posts one filled chunk, the first `n` bytes of `b`.
+  bool post_chunk(std::unique_ptr<Buffer> b, size_t n);
+
+  // A segmented body being sent: chunks are filled from resident segments,
+  // and a missing one is loaded off the poller before the fill goes on.
+  struct SegmentSend;
+  bool send_segments(const std::shared_ptr<SegmentSend>& st);
 
   // Flow control
   void try_post_more_sends_locked();
@@ -91,10 +133,23 @@ private:
   ibv_cq* cq_;
   Config cfg_;
   std::shared_ptr<LRUCache> cache_;
+  std::shared_ptr<SingleFlight> flights_;
+  std::shared_ptr<PathResolver> paths_;
+  std::shared_ptr<AsyncFileReader> files_;  // null: misses are read on the poller
 
   std::mutex mtx_;
   bool closed_ = false;
 
+  std::mutex order_mtx_;
+  std::deque<Pending> waiting_;  // under order_mtx_
+  bool busy_ = false;            // under order_mtx_; a request is being answered
+
+  // The GET being answered; like the rest of its state, touched only by
+  // whoever holds busy_.
+  std::chrono::steady_clock::time_point get_received_;
+  bool get_hit_ = false;
+  uint16_t last_status_ = 0;  // of the last header sent
+
   // Pools
   std::vector<std::unique_ptr<Buffer>> recv_pool_;
   int recv_inflight_ = 0;
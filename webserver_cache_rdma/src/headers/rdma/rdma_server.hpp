@@ -7,6 +7,8 @@
 #include <vector>
 #include <string>
 #include <mutex>
+#include <deque>
+#include <functional>
 #include <unordered_set>
 
 #include <rdma/rdma_cma.h>
@@ -14,6 +16,9 @@
 
 #include "../util/config.hpp"
 #include "../cache/lru_cache.hpp"
+#include "../cache/single_flight.hpp"
+#include "../fs/path_resolver.hpp"
+#include "../fs/async_file_reader.hpp"
 
 namespace rdma_fast {
 
@@ -28,7 +33,9 @@ class Connection;
 
 class RDMAServer {
 public:
-  RDMAServer(const RDMAConfig& cfg, const Config& app_cfg, std::shared_ptr<LRUCache> cache);
+  RDMAServer(const RDMAConfig& cfg, const Config& app_cfg, std::shared_ptr<LRUCache> cache,
+             std::shared_ptr<SingleFlight> flights, std::shared_ptr<PathResolver> paths,
+             std::shared_ptr<AsyncFileReader> files);
   ~RDMAServer();
 
   void start();
@@ -37,13 +44,22 @@ public:
   // Dispatch from poller
   void handle_wc(const ibv_wc& wc);
 
+  // Runs `fn` on a poller thread. Work that finishes elsewhere (a file
+  // load, another request's flight) hands its continuation over with this
+  // instead of touching the connection from its own thread.
+  void post(std::function<void()> fn);
+
 private:
   void cm_event_loop_();
   void cq_poller_loop_();
+  void run_posted_();
 
   RDMAConfig cfg_;
   Config app_cfg_{};
   std::shared_ptr<LRUCache> cache_{};
+  std::shared_ptr<SingleFlight> flights_{};
+  std::shared_ptr<PathResolver> paths_{};
+  std::shared_ptr<AsyncFileReader> files_{};
 
   std::atomic<bool> running_{false};
 
@@ -57,6 +73,11 @@ private:
   std::thread cm_thread_;
   std::vector<std::thread> pollers_;
 
+  // post() queue; wake_fd_ is an eventfd the pollers wait on next to the CQ.
+  std::mutex posted_mtx_;
+  std::deque<std::function<void()>> posted_;
+  int wake_fd_ = -1;
+
   // Track live connections to keep them alive
   std::mutex conns_mtx_;
   std::unordered_set<std::shared_ptr<Connection>> conns_;
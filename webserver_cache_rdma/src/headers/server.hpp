@@ -2,23 +2,40 @@
 #include <boost/asio.hpp>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "util/config.hpp"
 #include "cache/lru_cache.hpp"
+#include "cache/single_flight.hpp"
+#include "fs/path_resolver.hpp"
+#include "fs/async_file_reader.hpp"
+#include "util/timer_wheel.hpp"
 
 class Server {
 public:
-  Server(boost::asio::io_context& ioc, const Config& cfg, std::shared_ptr<LRUCache> cache);
+  Server(boost::asio::io_context& ioc, const Config& cfg, std::shared_ptr<LRUCache> cache,
+         std::shared_ptr<SingleFlight> flights, std::shared_ptr<PathResolver> paths,
+         std::shared_ptr<AsyncFileReader> files);
   void start();
 
   std::shared_ptr<LRUCache> cache() const { return cache_; }
-  const Config& config() const { return cfg_; }
+  // The bound port; the one the kernel picked when cfg.port is 0.
+  unsigned short port() const { return acceptor_.local_endpoint().port(); }
+  const Config& config() const { return *cfg_; }
 
 private:
   void do_accept();
+  // S is Session or CoreSession.
+  template <class S>
+  void on_accept(boost::system::error_code ec, typename S::Socket socket);
 
   boost::asio::io_context& ioc_;
   boost::asio::ip::tcp::acceptor acceptor_;
-  Config cfg_;
+  std::shared_ptr<const Config> cfg_;  // shared, read-only, with every session
   std::shared_ptr<LRUCache> cache_;
+  std::shared_ptr<SingleFlight> flights_;
+  std::shared_ptr<PathResolver> paths_;
+  std::shared_ptr<AsyncFileReader> files_;
+  // Session deadlines, on a wheel per worker thread.
+  std::shared_ptr<TimerWheels> wheels_;
 };
\ No newline at end of file
@@ -1,57 +1,254 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <chrono>
 #include <memory>
 #include <vector>
 #include <string>
-#include <deque>
+#include <ctime>
+#include <string_view>
 
 #include "util/config.hpp"
 #include "cache/lru_cache.hpp"
+#include "cache/single_flight.hpp"
+#include "fs/file_reader.hpp"
+#include "fs/path_resolver.hpp"
+#include "fs/async_file_reader.hpp"
 #include "http/request.hpp"
 #include "http/response.hpp"
 #include "http/parser.hpp"
+#include "util/handler_memory.hpp"
+#include "util/recycling_queue.hpp"
+#include "util/timer_wheel.hpp"
 
-class Session : public std::enable_shared_from_this<Session> {
+// One HTTP connection. Its handlers run on `Executor`: a strand when
+// several threads run the io_context (Session), or the io_context's own
+// executor when a single thread does and nothing can run concurrently
+// (CoreSession, for --thread-per-core). The I/O objects name the executor
+// type: behind the default type-erased any_io_executor, a strand does not
+// fit the small-object buffer and every operation would heap-allocate a
+// copy of it.
+template <class Executor>
+class BasicSession : public std::enable_shared_from_this<BasicSession<Executor>> {
 public:
-  Session(boost::asio::ip::tcp::socket socket, const Config& cfg, std::shared_ptr<LRUCache> cache);
+  using Socket = boost::asio::basic_stream_socket<boost::asio::ip::tcp, Executor>;
+
+  // Sessions are allocated from a per-thread pool of recycled blocks.
+  static std::shared_ptr<BasicSession> create(Socket socket, std::shared_ptr<const Config> cfg,
+                                         std::shared_ptr<LRUCache> cache, std::shared_ptr<SingleFlight> flights,
+                                         std::shared_ptr<PathResolver> paths, std::shared_ptr<AsyncFileReader> files,
+                                         std::shared_ptr<TimerWheels> wheels);
+
+  BasicSession(Socket socket, std::shared_ptr<const Config> cfg, std::shared_ptr<LRUCache> cache,
+               std::shared_ptr<SingleFlight> flights, std::shared_ptr<PathResolver> paths,
+               std::shared_ptr<AsyncFileReader> files, std::shared_ptr<TimerWheels> wheels);
+  ~BasicSession();
   void start();
 
 private:
   void start_read();
-  void on_read(boost::system::error_code ec, std::size_t n);
+  void on_readable(boost::system::error_code ec);
 
   void handle_next_in_queue();
   void handle_request_and_respond(const HttpRequest& req);
+
+  // The representation chosen for a request: cache key, file and coding.
+  // Views into the resolved path; copied into strings across a load.
+  struct Representation {
+    std::string_view key;
+    std::string_view path;
+    std::string_view coding;
+  };
+
+  // Turns a file's bytes into a cache entry and admits it, unless the file
+  // was invalidated since `epoch` was taken; run by the single-flight
+  // leader only.
+  FlightResult load_into_cache(const Representation& rep,
+                               const std::string& fs_path,
+                               FileReadResult fr,
+                               const std::string& etag,
+                               std::uint64_t epoch);
+  void resume_parked(const FlightResult& fr,
+                     const std::string& fs_path,
+                     const Representation& rep,
+                     bool keep_alive);
+  void serve_entry(const HttpRequest& req,
+                   const std::string& fs_path,
+                   const Representation& rep,
+                   LRUCache::Entry& entry,
+                   FileOpenResult opened,
+                   BodyPart whole,
+                   bool keep_alive);
+  void respond_with_entry(const HttpRequest& req,
+                          const std::string& fs_path,
+                          std::string_view coding,
+                          const LRUCache::Entry& entry,
+                          BodyPart whole,
+                          bool keep_alive);
+  void respond_not_modified(const std::string& etag,
+                            std::time_t last_modified,
+                            std::size_t body_size,
+                            bool keep_alive);
   void respond_with_error(int status, const std::string& message, bool keep_alive);
 
-  void write_response(std::unique_ptr<std::string> head,
+  // A queued response: the head, then each body part in order.
+  struct Outgoing {
+    std::unique_ptr<std::string> head;
+    // Cache-hit fast path, used instead of `head`: the entry's pre-rendered
+    // lines, then the shared per-second Date line and a Connection line.
+    std::shared_ptr<const std::string> cached_head;
+    std::shared_ptr<const std::string> date_line;
+    std::vector<BodyPart> body;
+    bool keep_alive = true;
+    bool head_sent = false;
+    std::size_t part = 0;           // next body part to send
+    std::uint64_t part_sent = 0;    // bytes of a file part already handed to sendfile
+    // The segment of a segmented body[part] being written, replaced as the
+    // next one is resolved; a zero length means it has been handed off.
+    BodyPart slice;
+    // Latency accounting; set by queue_response().
+    std::chrono::steady_clock::time_point started;  // the read that delivered the request
+    std::size_t series = 0;                         // Metrics::http_series()
+
+    // Every byte has been handed to a write.
+    bool gathered() const { return head_sent && part == body.size(); }
+
+    // What send_file_part() streams: the resolved slice of a segmented part.
+    const BodyPart& file_part() const { return body[part].segments ? slice : body[part]; }
+
+    // Back to empty for reuse; `body` keeps its capacity.
+    void reset() {
+      head.reset();
+      cached_head.reset();
+      date_line.reset();
+      body.clear();
+      keep_alive = true;
+      head_sent = false;
+      part = 0;
+      part_sent = 0;
+      slice = {};
+    }
+  };
+
+  // Non-owning view of write_bufs_, so async_write does not copy the vector.
+  struct BufferView {
+    const boost::asio::const_buffer* first;
+    const boost::asio::const_buffer* last;
+    const boost::asio::const_buffer* begin() const { return first; }
+    const boost::asio::const_buffer* end() const { return last; }
+  };
+
+  // Per-write limits for gathering pipelined responses; asio hands at most
+  // 64 buffers to a single writev.
+  static constexpr std::size_t kMaxWriteBuffers = 64;
+  static constexpr std::size_t kMaxWriteBytes = 256 * 1024;
+  static constexpr std::size_t kMaxBatchedResponses = 32;
+
+  void write_response(int status,
+                      std::unique_ptr<std::string> head,
                       std::shared_ptr<const std::vector<uint8_t>> body,
                       bool keep_alive);
+  void write_response(int status,
+                      std::unique_ptr<std::string> head,
+                      std::vector<BodyPart> body,
+                      bool keep_alive);
+  // Full 200 for an entry carrying a pre-rendered head; builds no strings.
+  void write_cached_response(const LRUCache::Entry& entry, BodyPart whole, bool head_only, bool keep_alive);
+  // Likewise a 304, from the entry's head_304.
+  void write_cached_not_modified(const LRUCache::Entry& entry, bool keep_alive);
+  // Appends an empty response to the queue for the caller to fill in.
+  Outgoing& queue_response(int status, bool keep_alive);
+  // Access-log record for a queued response, if the access log is on.
+  void log_access(int status, std::uint64_t body_bytes);
+  void start_write();
+
+  void write_pending();
+  // Adds `out`'s next buffers to the write; stops short, with `missing`
+  // set, at a segmented part whose next segment is not in memory.
+  bool gather(Outgoing& out, std::size_t& bytes, bool& resolved_segment, BodyPart*& missing,
+              std::chrono::steady_clock::time_point now);
+  // Loads the segment `part` is waiting on, then carries on writing.
+  void load_segment(const BodyPart& part);
+  void send_file_part();
+
+  void on_write(boost::system::error_code ec);
+
+  // What a session needs only while it has a request in progress. An idle
+  // keep-alive connection holds none of it: it is borrowed from a
+  // per-thread pool when data arrives and handed back once nothing is
+  // parsed, parked, queued or being written. Pooled ones keep the capacity
+  // they grew, so steady-state requests still allocate nothing.
+  struct Working {
+    HttpRequest request;  // the request being answered; views into parser_
+    LRUCache::Entry entry;  // lookup target, reused so its ETag keeps its buffer
+    RecyclingQueue<Outgoing> outgoing;  // answered, in request order
+    std::vector<boost::asio::const_buffer> write_bufs;  // the write in flight
+    // Handler storage for the write; its composed operation carries the
+    // buffer sequence, so it needs more room than the read's.
+    HandlerMemory<1, 512> write_mem;
+    Working* next = nullptr;  // free-list link while pooled
+  };
+  // Hands a Working back to the pool of the thread that drops it.
+  struct WorkingRelease {
+    void operator()(Working* w) const noexcept;
+  };
+  void borrow_working();
+  void return_working();
+
+  // A read or write deadline on the Server's timer wheels; when it
+  // passes, the session is closed on its executor.
+  struct Deadline final : TimerWheel::Timer {
+    explicit Deadline(BasicSession& s) : session(s) {}
+    BasicSession& session;
+    const char* what = "";  // "read", "idle" or "write", for the log line
 
-  void on_write(std::unique_ptr<std::string> head,
-                std::shared_ptr<const std::vector<uint8_t>> body,
-                bool keep_alive,
-                boost::system::error_code ec,
-                std::size_t n);
+  private:
+    std::shared_ptr<void> pin() override;
+    void expire(std::uint64_t generation) override;
+  };
 
-  void arm_idle_timer();
-  void cancel_timers();
+  void arm(Deadline& d, const char* what, int timeout_ms);
+  void on_deadline(Deadline& d, std::uint64_t generation);
+  void cancel_deadlines();
   void close();
 
-  boost::asio::ip::tcp::socket socket_;
-  Config cfg_;
+  Socket socket_;
+  std::shared_ptr<const Config> cfg_;  // shared by every session of a Server
   std::shared_ptr<LRUCache> cache_;
+  std::shared_ptr<SingleFlight> flights_;
+  std::shared_ptr<PathResolver> paths_;
+  std::shared_ptr<AsyncFileReader> files_;  // null: misses are read inline
+  std::shared_ptr<TimerWheels> wheels_;
 
-  std::vector<char> inbuf_;
   HttpParser parser_;
+  // Borrowed only while a request is in progress (see Working).
+  std::unique_ptr<Working, WorkingRelease> work_;
 
-  std::deque<HttpRequest> pending_;
+  bool reading_ = false;
   bool writing_ = false;
+  bool parked_ = false;   // request_ is waiting on a single-flight load
   bool closing_after_ = false;
+  bool answered_ = false;  // a request has been parsed; later reads are keep-alive waits
+  bool cache_hit_ = false;  // request_'s body came from the cache
 
-  boost::asio::steady_timer read_timer_;
-  boost::asio::steady_timer write_timer_;
-  boost::asio::steady_timer idle_timer_;
+  std::chrono::steady_clock::time_point read_at_;          // the last read's completion
+  std::chrono::steady_clock::time_point request_started_;  // read_at_ when request_ was parsed
+
+  // The pending read is bounded by the read timeout mid-request and by the
+  // keep-alive timeout between requests; queued responses by the write
+  // timeout.
+  Deadline read_deadline_{*this};
+  Deadline write_deadline_{*this};
+
+  // Handler storage for the pending read, which an idle connection always
+  // has; the write's is in Working.
+  HandlerMemory<> read_mem_;
 
   bool closed_ = false;
-};
\ No newline at end of file
+};
+
+using Session = BasicSession<boost::asio::strand<boost::asio::io_context::executor_type>>;
+using CoreSession = BasicSession<boost::asio::io_context::executor_type>;
+
+// Both are instantiated in session.cpp.
+extern template class BasicSession<boost::asio::strand<boost::asio::io_context::executor_type>>;
+extern template class BasicSession<boost::asio::io_context::executor_type>;
@@ -1,14 +1,18 @@
 #pragma once
 #include <boost/asio.hpp>
+#include <vector>
 
 class SignalHandler {
 public:
   explicit SignalHandler(boost::asio::io_context& ioc);
   void register_signals();
+  // Another context to stop on shutdown (per-core workers).
+  void stop_also(boost::asio::io_context& ioc) { others_.push_back(&ioc); }
 
 private:
   void on_signal(const boost::system::error_code& ec, int signo);
 
   boost::asio::io_context& ioc_;
   boost::asio::signal_set signals_;
+  std::vector<boost::asio::io_context*> others_;
 };
\ No newline at end of file
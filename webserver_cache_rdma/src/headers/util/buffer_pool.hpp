@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+
+// Per-thread pool of the fixed-size buffers sessions read requests into.
+// A session borrows one only while a request is arriving or being
+// answered, so an idle keep-alive connection holds none. A buffer handed
+// back on another thread simply feeds that thread's pool.
+class ReadBufferPool {
+public:
+  struct Release {
+    std::size_t size = 0;
+    void operator()(char* p) const noexcept;
+  };
+  using Buffer = std::unique_ptr<char[], Release>;
+
+  static Buffer acquire(std::size_t size);
+};
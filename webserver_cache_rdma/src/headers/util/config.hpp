@@ -5,19 +5,58 @@
 struct Config {
   unsigned short port = 8080;
   unsigned threads = 0; // 0 -> hardware_concurrency
+  // One io_context, SO_REUSEPORT acceptor and pinned thread per worker
+  bool thread_per_core = false;
   std::string doc_root = "./public";
 
   // Cache
   unsigned cache_mem_mb = 128;
+  unsigned cache_shards = 16;
+  std::string cache_policy = "lru"; // lru | sieve | wtinylfu | gdsf
+  // Files larger than this are cached as independent segments of this size (0 = off)
+  std::size_t cache_segment_bytes = 1024 * 1024;
+  // Keep compressible entries gzip-encoded in memory (needs ENABLE_CACHE_COMPRESSION)
+  bool cache_compress = false;
+  std::size_t cache_compress_min_bytes = 1024;
+
+  // Invalidate cached files when they change under doc_root (inotify)
+  bool watch_doc_root = true;
+
+  // Remember not-found/rejected URLs (bounded, expiring; 0 entries = off)
+  std::size_t negative_cache_entries = 4096;
+  int negative_cache_ttl_ms = 5000;
+
+  // Read cache misses through io_uring (needs ENABLE_IO_URING)
+  bool io_uring = false;
+
+  // Otherwise misses are read by a pool of blocking loader threads
+  // (0 = read on the requesting thread); beyond the queue bound misses
+  // are answered 503.
+  unsigned file_load_threads = 2;
+  std::size_t file_load_queue = 1024;
+
+  // Bodies at least this large skip the memory cache and go out via sendfile
+  // (0 = off); checked before cache_segment_bytes, so keep it above that
+  std::size_t sendfile_min_bytes = 16 * 1024 * 1024;
+
+  // Logging: level (debug | info | warn | error | off), lines per second
+  // per call site and thread (0 = unlimited), binary access log (empty = off)
+  std::string log_level = "info";
+  unsigned log_rate_limit = 10;
+  std::string access_log;
 
   // Limits
   std::size_t max_request_line = 8192;
   std::size_t max_header_bytes = 32 * 1024;
+  std::size_t max_header_fields = 100;  // more: 431 Request Header Fields Too Large
 
   // Timeouts (ms)
   int read_timeout_ms = 5000;
   int write_timeout_ms = 5000;
   int keepalive_timeout_ms = 10000;
+  // Granularity of the timer wheels that enforce them; a timeout fires up
+  // to one tick late
+  int timer_tick_ms = 100;
 
   // RDMA (effective if compiled with ENABLE_RDMA)
   bool rdma_enable = false;
@@ -0,0 +1,98 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Reusable storage for the handlers of one kind of asynchronous operation
+// (a session's reads, its writes, one timer's waits). asio allocates every
+// pending operation through the handler's associated allocator, so
+// wrapping a handler with make_alloc_handler() makes that allocation come
+// from here instead of the heap. `Slots` covers operations that overlap:
+// a re-armed timer's new wait is started before the cancelled one has
+// completed. When every slot is taken, or an operation is larger than a
+// slot, it falls back to operator new.
+template <std::size_t Slots = 1, std::size_t SlotSize = 256>
+class HandlerMemory {
+public:
+  HandlerMemory() = default;
+  HandlerMemory(const HandlerMemory&) = delete;
+  HandlerMemory& operator=(const HandlerMemory&) = delete;
+
+  void* allocate(std::size_t size) {
+    if (size <= SlotSize) {
+      for (std::size_t i = 0; i < Slots; ++i) {
+        if (!in_use_[i]) {
+          in_use_[i] = true;
+          return &storage_[i];
+        }
+      }
+    }
+    return ::operator new(size);
+  }
+
+  void deallocate(void* p) {
+    for (std::size_t i = 0; i < Slots; ++i) {
+      if (p == &storage_[i]) {
+        in_use_[i] = false;
+        return;
+      }
+    }
+    ::operator delete(p);
+  }
+
+private:
+  std::aligned_storage_t<SlotSize, alignof(std::max_align_t)> storage_[Slots];
+  bool in_use_[Slots] = {};
+};
+
+// Minimal allocator over a HandlerMemory, as asio's associated_allocator
+// expects it.
+template <class T, class Memory>
+class HandlerAllocator {
+public:
+  using value_type = T;
+
+  explicit HandlerAllocator(Memory& mem) : mem_(&mem) {}
+  template <class U>
+  HandlerAllocator(const HandlerAllocator<U, Memory>& other) noexcept : mem_(other.mem_) {}
+
+  T* allocate(std::size_t n) const { return static_cast<T*>(mem_->allocate(sizeof(T) * n)); }
+  void deallocate(T* p, std::size_t) const { mem_->deallocate(p); }
+
+  template <class U>
+  bool operator==(const HandlerAllocator<U, Memory>& other) const noexcept { return mem_ == other.mem_; }
+  template <class U>
+  bool operator!=(const HandlerAllocator<U, Memory>& other) const noexcept { return mem_ != other.mem_; }
+
+private:
+  template <class, class> friend class HandlerAllocator;
+  Memory* mem_;
+};
+
+// A completion handler that advertises a HandlerAllocator. The memory must
+// outlive the operation, so it belongs to the object the handler keeps
+// alive (a session holds it and each handler holds the session).
+template <class Handler, class Memory>
+class AllocHandler {
+public:
+  using allocator_type = HandlerAllocator<void, Memory>;
+
+  AllocHandler(Memory& mem, Handler h) : mem_(mem), handler_(std::move(h)) {}
+
+  allocator_type get_allocator() const noexcept { return allocator_type(mem_); }
+
+  template <class... Args>
+  void operator()(Args&&... args) {
+    handler_(std::forward<Args>(args)...);
+  }
+
+private:
+  Memory& mem_;
+  Handler handler_;
+};
+
+template <class Handler, class Memory>
+AllocHandler<std::decay_t<Handler>, Memory> make_alloc_handler(Memory& mem, Handler&& h) {
+  return AllocHandler<std::decay_t<Handler>, Memory>(mem, std::forward<Handler>(h));
+}
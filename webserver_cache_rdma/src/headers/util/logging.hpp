@@ -1,12 +1,129 @@
 #pragma once
-#include <fmt/core.h>
+#include <fmt/format.h>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
 
-inline void log_info(const char* fmt, auto&&... args) {
-  fmt::print(fmt, std::forward<decltype(args)>(args)...);
+enum class LogLevel : std::uint8_t { Debug, Info, Warn, Error, Off };
+
+// "debug" | "info" | "warn" | "error" | "off"
+bool parse_log_level(std::string_view name, LogLevel& out);
+
+// Asynchronous logger. Every thread formats its lines into a ring of
+// fixed-size records of its own (one producer, one consumer, no locks),
+// and a background thread writes them out in time order, so a log call on
+// an io_context thread never waits on the terminal or the disk. Lines
+// below the runtime level are skipped before formatting. Each call site is
+// rate limited per thread; what it suppresses is noted on its next line
+// that gets through. A full ring drops lines (log_dropped). Before start()
+// and after stop(), lines are written synchronously.
+class Logger {
+public:
+  static Logger& instance();
+  ~Logger();
+
+  void set_level(LogLevel level) { level_.store(level, std::memory_order_relaxed); }
+  bool enabled(LogLevel level) const { return level >= level_.load(std::memory_order_relaxed); }
+  // Lines per second for each call site on each thread; 0 = unlimited.
+  void set_rate_limit(unsigned per_second) { rate_limit_.store(per_second, std::memory_order_relaxed); }
+
+  // Starts the flusher thread, and the binary access log if a path is
+  // given; false with `err` set if that file cannot be opened.
+  bool start(const std::string& access_log_path, std::string& err);
+  // Writes out everything logged so far and joins the flusher. Idempotent.
+  void stop();
+
+  template <class... T>
+  void log(LogLevel level, fmt::format_string<T...> format, T&&... args) {
+    if (!enabled(level)) return;
+    const std::int64_t now = now_us();
+    std::uint32_t suppressed = 0;
+    if (!admit(fmt::string_view(format).data(), now, suppressed)) return;
+    Record* r = claim();
+    if (!r) return;
+    const auto res = fmt::format_to_n(r->text, sizeof(r->text), format, std::forward<T>(args)...);
+    r->time_us = now;
+    r->kind = static_cast<std::uint8_t>(level);
+    r->suppressed = suppressed;
+    r->len = static_cast<std::uint16_t>(std::min(res.size, sizeof(r->text)));
+    publish(*r);
+  }
+
+  bool access_log_enabled() const { return access_log_.load(std::memory_order_relaxed); }
+  // One response for the binary access log (see the README for the record
+  // layout); the path is truncated to fit a record.
+  void access(int status, std::string_view method, std::string_view path, std::uint64_t bytes);
+
+private:
+  static constexpr std::uint8_t kAccess = 0xff;  // Record::kind of an access-log record
+
+  struct Record {
+    std::int64_t time_us = 0;  // system_clock, since the epoch
+    std::uint64_t bytes = 0;   // access: body bytes
+    std::uint32_t suppressed = 0;
+    std::uint16_t len = 0;     // of text
+    std::uint16_t status = 0;  // access
+    std::uint8_t kind = 0;     // a LogLevel, or kAccess
+    std::uint8_t method_len = 0;  // access: text is method then path
+    char text[226];
+  };
+  struct Ring;
+
+  Logger() = default;
+
+  static std::int64_t now_us();
+  bool admit(const char* site, std::int64_t now, std::uint32_t& suppressed);
+  Ring& local_ring();
+  Record* claim();
+  void publish(Record& r);
+
+  void run();
+  void drain(const std::vector<std::shared_ptr<Ring>>& rings);
+  void render(const Record& r);
+  void write_out();
+
+  std::atomic<LogLevel> level_{LogLevel::Info};
+  std::atomic<unsigned> rate_limit_{0};
+  std::atomic<bool> running_{false};
+  std::atomic<bool> access_log_{false};
+
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  std::vector<std::shared_ptr<Ring>> rings_;  // one per producer thread, under mtx_
+  std::thread flusher_;
+
+  // Flusher only, reused across drains.
+  std::vector<const Record*> batch_;
+  std::vector<std::uint64_t> tails_;
+
+  // Rendering and writing: the flusher, or a synchronous caller.
+  std::mutex write_mtx_;
+  std::string out_, err_, access_buf_;  // under write_mtx_
+  std::FILE* access_file_ = nullptr;    // under write_mtx_
+};
+
+template <class... T>
+void log_debug(fmt::format_string<T...> format, T&&... args) {
+  Logger::instance().log(LogLevel::Debug, format, std::forward<T>(args)...);
+}
+template <class... T>
+void log_info(fmt::format_string<T...> format, T&&... args) {
+  Logger::instance().log(LogLevel::Info, format, std::forward<T>(args)...);
+}
+template <class... T>
+void log_warn(fmt::format_string<T...> format, T&&... args) {
+  Logger::instance().log(LogLevel::Warn, format, std::forward<T>(args)...);
 }
-inline void log_warn(const char* fmt, auto&&... args) {
-  fmt::print(stderr, fmt, std::forward<decltype(args)>(args)...);
+template <class... T>
+void log_error(fmt::format_string<T...> format, T&&... args) {
+  Logger::instance().log(LogLevel::Error, format, std::forward<T>(args)...);
 }
-inline void log_error(const char* fmt, auto&&... args) {
-  fmt::print(stderr, fmt, std::forward<decltype(args)>(args)...);
-}
\ No newline at end of file
@@ -1,21 +1,204 @@
 #pragma once
+#include <algorithm>
 #include <atomic>
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
+
+// A run of cells for Counters and Histograms, owned by one thread, which
+// is the only one that writes it. A thread attaches a chunk the first time
+// it updates a cell in it, so a thread that records into a few latency
+// series holds a few chunks, not the whole index space.
+struct alignas(64) CounterChunk {
+  static constexpr std::size_t kCells = 64;  // 512 bytes
+  std::atomic<unsigned long long> cells[kCells];
+};
+
+namespace metrics_detail {
+// Cells one process can allocate, across every Counter and Histogram.
+constexpr std::size_t kMaxChunks = 64;
+constexpr std::size_t kCapacity = kMaxChunks * CounterChunk::kCells;
+
+inline thread_local CounterChunk* tls_chunks[kMaxChunks] = {};
+// Attaches chunk `c` for this thread; nullptr once the thread is exiting.
+CounterChunk* attach_chunk(std::size_t c);
+void add_orphan(std::size_t index, unsigned long long n) noexcept;
+// Reserves `n` consecutive cells; throws once kCapacity is used up.
+std::size_t allocate(std::size_t n);
+// Sums cells [first, first + n) over every thread into `out`.
+void sum(std::size_t first, std::size_t n, unsigned long long* out);
+
+inline void add(std::size_t index, unsigned long long n) noexcept {
+  const std::size_t c = index / CounterChunk::kCells;
+  CounterChunk* chunk = tls_chunks[c];
+  if (!chunk && !(chunk = attach_chunk(c))) {
+    add_orphan(index, n);
+    return;
+  }
+  auto& cell = chunk->cells[index % CounterChunk::kCells];
+  cell.store(cell.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+} // namespace metrics_detail
+
+// A counter sharded per thread. An update is a plain store to the calling
+// thread's own cache-line-aligned chunk, so cores never contend on a line;
+// load() sums the chunks and is only meant for scrapes. fetch_add and
+// fetch_sub keep the std::atomic spelling but return nothing. Gauges work
+// as well: cells wrap, and the sum comes out right modulo 2^64.
+class Counter {
+public:
+  Counter() : index_(metrics_detail::allocate(1)) {}
+  Counter(const Counter&) = delete;
+  Counter& operator=(const Counter&) = delete;
+
+  void fetch_add(unsigned long long n, std::memory_order = std::memory_order_relaxed) noexcept {
+    metrics_detail::add(index_, n);
+  }
+  void fetch_sub(unsigned long long n, std::memory_order = std::memory_order_relaxed) noexcept {
+    metrics_detail::add(index_, 0ULL - n);
+  }
+  unsigned long long load(std::memory_order = std::memory_order_relaxed) const;
+  // Sets the value seen by load(); updates already in flight may land
+  // on either side of it.
+  Counter& operator=(unsigned long long value);
+
+private:
+  std::size_t index_;
+  std::atomic<unsigned long long> base_{0};  // subtracted by load(), set by operator=
+};
+
+// Latency histogram in microseconds, log-linear in the manner of HDR
+// histograms: two linear buckets per power of two up to 2^25 us (about
+// 34 s), then an overflow bucket, so a bucket is never more than half as
+// wide as its lower bound. Buckets are per-thread cells like a Counter's,
+// and merging threads is a per-bucket sum.
+class Histogram {
+public:
+  static constexpr std::size_t kBounds = 50;  // finite upper bounds; bucket kBounds is the overflow
+
+  struct Snapshot {
+    unsigned long long buckets[kBounds + 1] = {};  // not cumulative
+    unsigned long long count = 0;
+    unsigned long long sum_us = 0;
+  };
+
+  Histogram() : first_(metrics_detail::allocate(kCells)) {}
+  Histogram(const Histogram&) = delete;
+  Histogram& operator=(const Histogram&) = delete;
+
+  void record(std::uint64_t us) noexcept {
+    metrics_detail::add(first_ + bucket_of(us), 1);
+    metrics_detail::add(first_ + kBounds + 1, us);
+  }
+
+  // Bucket b holds (upper_bound_us(b - 1), upper_bound_us(b)].
+  static std::size_t bucket_of(std::uint64_t us) noexcept {
+    if (us <= 4) return us == 0 ? 0 : static_cast<std::size_t>(us - 1);
+    const std::uint64_t w = us - 1;
+    const int e = 63 - __builtin_clzll(w);
+    const std::size_t b = 4 + 2 * static_cast<std::size_t>(e - 2) + ((w >> (e - 1)) & 1);
+    return std::min(b, kBounds);
+  }
+  static std::uint64_t upper_bound_us(std::size_t bucket) noexcept {
+    if (bucket < 4) return bucket + 1;
+    const std::size_t e = (bucket - 4) / 2 + 2;
+    return (std::uint64_t{1} << e) + (((bucket - 4) % 2) + 1) * (std::uint64_t{1} << (e - 1));
+  }
+
+  Snapshot snapshot() const;
+  void reset();
+
+private:
+  static constexpr std::size_t kCells = kBounds + 2;  // buckets, then the sum
+
+  std::size_t first_;
+  std::atomic<unsigned long long> base_[kCells] = {};  // subtracted by snapshot(), set by reset()
+};
 
 struct Metrics {
-  std::atomic<unsigned long long> requests_total{0};
-  std::atomic<unsigned long long> responses_2xx{0};
-  std::atomic<unsigned long long> responses_4xx{0};
-  std::atomic<unsigned long long> responses_5xx{0};
-  std::atomic<unsigned long long> cache_hits{0};
-  std::atomic<unsigned long long> cache_misses{0};
-  std::atomic<unsigned long long> bytes_served{0};
+  Counter requests_total;
+  Counter responses_2xx;
+  Counter responses_304;
+  Counter responses_4xx;
+  Counter responses_5xx;
+  Counter cache_hits;
+  Counter cache_misses;
+  Counter cache_segment_hits;
+  Counter cache_segment_misses;
+  Counter path_cache_hits;
+  Counter path_cache_misses;
+  Counter negative_cache_hits;
+  Counter cache_coalesced_loads;  // misses that waited on another request's load
+  Counter cache_invalidations;    // doc_root change events applied to the cache
+  Counter cache_stale_loads;      // loads not cached: their file was invalidated meanwhile
+
+  // Gauges for gzip-compressed cache entries currently resident
+  Counter cache_gzip_entries;
+  Counter cache_gzip_stored_bytes;
+  Counter cache_gzip_original_bytes;
+
+  // Every LRUCache lookup (segments and variants included), for the
+  // policy hit/byte-hit ratios. The cache cannot size a miss, so miss
+  // bytes are counted by whoever resolves it, once the file's size is
+  // known, whether or not the result is then stored.
+  std::atomic<const char*> cache_policy{"lru"};
+  Counter cache_lookup_hits;
+  Counter cache_lookup_misses;
+  Counter cache_hit_bytes;
+  Counter cache_miss_bytes;
+  Counter cache_evictions;
+  Counter bytes_served;
+  Counter bytes_saved_304;  // body bytes not sent thanks to 304s
+  Counter sendfile_responses;
+  Counter range_responses;
+  Counter precompressed_responses;
+  Counter write_batches;  // gathered writes of queued responses
+  Counter timeouts;  // connections closed by a read, idle or write deadline
+
+  // Gauges for request read buffers (ReadBufferPool): borrowed by sessions
+  // with a request in progress, and idle in the per-thread pools.
+  Counter read_buffers_in_use;
+  Counter read_buffers_pooled;
+
+  // Log lines lost: to a full per-thread ring, or to the rate limit
+  Counter log_dropped;
+  Counter log_suppressed;
+
+  // Blocking-I/O pool that reads cache misses (FileLoadPool). Latencies
+  // are summed in microseconds; divide by file_loads for the mean.
+  Counter file_load_queue_depth;  // gauge: reads waiting for a loader thread
+  Counter file_loads;
+  Counter file_loads_rejected;  // queue full, answered 503
+  Counter file_load_wait_us;
+  Counter file_load_read_us;
 
   // RDMA counters
-  std::atomic<unsigned long long> rdma_reqs{0};
-  std::atomic<unsigned long long> rdma_ok{0};
-  std::atomic<unsigned long long> rdma_err{0};
-  std::atomic<unsigned long long> rdma_bytes{0};
+  Counter rdma_reqs;
+  Counter rdma_ok;
+  Counter rdma_err;
+  Counter rdma_bytes;
+
+  // Latency series are labelled with the status class (2xx..5xx) and
+  // whether the body came from the cache; HTTP ones also with the method
+  // (GET, HEAD or other).
+  static constexpr std::size_t kHttpSeries = 2 * 3 * 4;
+  static constexpr std::size_t kRdmaSeries = 2 * 4;
+  static std::size_t status_class(int status) { return static_cast<std::size_t>(std::clamp(status / 100, 2, 5) - 2); }
+  static std::size_t http_series(bool cache_hit, std::string_view method, int status) {
+    const std::size_t m = method == "GET" ? 0 : method == "HEAD" ? 1 : 2;
+    return (cache_hit ? 0 : 12) + m * 4 + status_class(status);
+  }
+  static std::size_t rdma_series(bool cache_hit, int status) {
+    return (cache_hit ? 0 : 4) + status_class(status);
+  }
+
+  // HTTP: from the read that delivered a request until its response head
+  // is handed to the socket, and until its last byte is.
+  Histogram http_ttfb[kHttpSeries];
+  Histogram http_response_time[kHttpSeries];
+  // RDMA GET: from the receive completion until the response is posted.
+  Histogram rdma_get_service[kRdmaSeries];
 
   static Metrics& instance() {
     static Metrics m;
@@ -25,29 +208,52 @@ struct Metrics {
   void reset() {
     requests_total = 0;
     responses_2xx = 0;
+    responses_304 = 0;
     responses_4xx = 0;
     responses_5xx = 0;
     cache_hits = 0;
     cache_misses = 0;
+    cache_segment_hits = 0;
+    cache_segment_misses = 0;
+    path_cache_hits = 0;
+    path_cache_misses = 0;
+    negative_cache_hits = 0;
+    cache_coalesced_loads = 0;
+    cache_invalidations = 0;
+    cache_stale_loads = 0;
+    cache_gzip_entries = 0;
+    cache_gzip_stored_bytes = 0;
+    cache_gzip_original_bytes = 0;
+    cache_lookup_hits = 0;
+    cache_lookup_misses = 0;
+    cache_hit_bytes = 0;
+    cache_miss_bytes = 0;
+    cache_evictions = 0;
     bytes_served = 0;
+    bytes_saved_304 = 0;
+    sendfile_responses = 0;
+    range_responses = 0;
+    precompressed_responses = 0;
+    write_batches = 0;
+    timeouts = 0;
+    read_buffers_in_use = 0;
+    read_buffers_pooled = 0;
+    log_dropped = 0;
+    log_suppressed = 0;
+    file_load_queue_depth = 0;
+    file_loads = 0;
+    file_loads_rejected = 0;
+    file_load_wait_us = 0;
+    file_load_read_us = 0;
     rdma_reqs = 0;
     rdma_ok = 0;
     rdma_err = 0;
     rdma_bytes = 0;
+    for (auto& h : http_ttfb) h.reset();
+    for (auto& h : http_response_time) h.reset();
+    for (auto& h : rdma_get_service) h.reset();
   }
 
-  std::string render_text() const {
-    return
-      "requests_total " + std::to_string(requests_total.load()) + "\n" +
-      "responses_2xx " + std::to_string(responses_2xx.load()) + "\n" +
-      "responses_4xx " + std::to_string(responses_4xx.load()) + "\n" +
-      "responses_5xx " + std::to_string(responses_5xx.load()) + "\n" +
-      "cache_hits " + std::to_string(cache_hits.load()) + "\n" +
-      "cache_misses " + std::to_string(cache_misses.load()) + "\n" +
-      "bytes_served " + std::to_string(bytes_served.load()) + "\n" +
-      "rdma_requests " + std::to_string(rdma_reqs.load()) + "\n" +
-      "rdma_ok " + std::to_string(rdma_ok.load()) + "\n" +
-      "rdma_err " + std::to_string(rdma_err.load()) + "\n" +
-      "rdma_bytes " + std::to_string(rdma_bytes.load()) + "\n";
-  }
-};
\ No newline at end of file
+  // Prometheus text exposition format.
+  std::string render_text() const;
+};
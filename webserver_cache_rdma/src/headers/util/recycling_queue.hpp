@@ -0,0 +1,46 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// FIFO whose popped elements are reset in place (T::reset()) rather than
+// destroyed, so their members keep any capacity they grew (a vector of
+// body parts, say) and steady-state use allocates nothing. Storage only
+// grows; push may move elements and invalidate references to them.
+template <class T>
+class RecyclingQueue {
+public:
+  using iterator = typename std::vector<T>::iterator;
+
+  bool empty() const { return head_ == tail_; }
+  std::size_t size() const { return tail_ - head_; }
+
+  T& front() { return items_[head_]; }
+  iterator begin() { return items_.begin() + static_cast<std::ptrdiff_t>(head_); }
+  iterator end() { return items_.begin() + static_cast<std::ptrdiff_t>(tail_); }
+
+  // Appends an element in its reset state and returns it for filling in.
+  T& push_back() {
+    if (tail_ == items_.size()) {
+      if (head_ > 0) {
+        // Reuse the reset slots at the front.
+        std::rotate(items_.begin(), items_.begin() + static_cast<std::ptrdiff_t>(head_), items_.end());
+        tail_ -= head_;
+        head_ = 0;
+      } else {
+        items_.emplace_back();
+      }
+    }
+    return items_[tail_++];
+  }
+
+  void pop_front() {
+    items_[head_].reset();
+    if (++head_ == tail_) head_ = tail_ = 0;
+  }
+
+private:
+  std::vector<T> items_;  // [head_, tail_) live, the rest reset
+  std::size_t head_ = 0;
+  std::size_t tail_ = 0;
+};
@@ -2,6 +2,10 @@
 #include <string>
 #include <chrono>
 #include <ctime>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string_view>
 
 inline std::string format_http_date(std::time_t t) {
   char buf[64]{0};
@@ -17,4 +21,81 @@ inline std::string format_http_date(std::time_t t) {
 
 inline std::string now_http_date() {
   return format_http_date(std::time(nullptr));
-}
\ No newline at end of file
+}
+
+// "Date: <now>\r\n", rendered at most once per second per thread. Shared so
+// a write still in flight keeps its copy when the next second ticks over.
+// Two lines take turns: the next second goes into whichever one no write
+// holds, so a tick in the middle of a pipelined batch does not allocate.
+inline std::shared_ptr<const std::string> date_header_line() {
+  thread_local std::time_t rendered = -1;
+  thread_local std::shared_ptr<std::string> lines[2];
+  thread_local unsigned current = 0;
+  const std::time_t now = std::time(nullptr);
+  if (now != rendered) {
+    char buf[64];
+    std::tm gm{};
+#if defined(_WIN32)
+    gmtime_s(&gm, &now);
+#else
+    gmtime_r(&now, &gm);
+#endif
+    const std::size_t n = std::strftime(buf, sizeof(buf), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &gm);
+    if (!lines[0]) {
+      for (auto& l : lines) {
+        l = std::make_shared<std::string>();
+        l->reserve(64);
+      }
+    }
+    if (lines[current].use_count() > 1) current ^= 1;
+    auto& line = lines[current];
+    if (line.use_count() == 1) line->assign(buf, n);
+    else line = std::make_shared<std::string>(buf, n);
+    rendered = now;
+  }
+  return lines[current];
+}
+
+// Parses an IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT"), the only format
+// we emit and the one every current client sends back.
+inline bool parse_http_date(std::string_view s, std::time_t& out) {
+  char text[64]{0};
+  if (s.size() >= sizeof(text)) return false;
+  s.copy(text, s.size());
+  std::tm gm{};
+  char wday[4]{0}, mon[4]{0};
+  int mday = 0, year = 0, hh = 0, mm = 0, ss = 0, used = 0;
+  // %n only lands once the trailing " GMT" has matched; nothing may follow.
+  if (std::sscanf(text, "%3s, %d %3s %d %d:%d:%d GMT%n", wday, &mday, mon, &year, &hh, &mm, &ss, &used) != 7 ||
+      static_cast<std::size_t>(used) != s.size() || year < 1970) {
+    return false;
+  }
+  static const char* months[] = {"Jan","Feb","Mar","Apr","May","Jun","Jul","Aug","Sep","Oct","Nov","Dec"};
+  int m = -1;
+  for (int i = 0; i < 12; ++i) {
+    if (std::strcmp(mon, months[i]) == 0) { m = i; break; }
+  }
+  if (m < 0) return false;
+  gm.tm_year = year - 1900;
+  gm.tm_mon = m;
+  gm.tm_mday = mday;
+  gm.tm_hour = hh;
+  gm.tm_min = mm;
+  gm.tm_sec = ss;
+#if defined(_WIN32)
+  out = _mkgmtime(&gm);
+#else
+  out = timegm(&gm);
+#endif
+  if (out == static_cast<std::time_t>(-1)) return false;
+  // timegm() normalizes "32 Nov" or "24:00:00" instead of failing; such a
+  // date does not come back out the same.
+  std::tm back{};
+#if defined(_WIN32)
+  gmtime_s(&back, &out);
+#else
+  gmtime_r(&out, &back);
+#endif
+  return back.tm_mday == mday && back.tm_mon == m && back.tm_year == year - 1900 && back.tm_hour == hh &&
+         back.tm_min == mm && back.tm_sec == ss;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Hashed timer wheel for coarse connection deadlines. Time advances in
+// ticks of a fixed length; a deadline lives in the slot of the tick it is
+// due in, on an intrusive list, so arming and cancelling are O(1) and no
+// heap is kept ordered. Each tick takes the lock once and expires the
+// whole slot as a batch. Deadlines longer than a full turn of the wheel
+// simply stay in their slot until their tick comes round. A deadline
+// fires between its timeout and one tick later.
+class TimerWheels;
+
+class TimerWheel {
+public:
+  // A deadline, embedded in its owner. Only one wheel may hold it at a
+  // time; the owner must cancel it before it is destroyed.
+  class Timer {
+  public:
+    Timer() = default;
+    Timer(const Timer&) = delete;
+    Timer& operator=(const Timer&) = delete;
+
+    // Changes on every arm() and cancel(), so an owner that learns of an
+    // expiry late can tell whether it still applies.
+    std::uint64_t generation() const { return generation_; }
+
+  protected:
+    ~Timer() = default;
+
+  private:
+    friend class TimerWheel;
+    friend class TimerWheels;
+
+    // Under the wheel's lock, when the deadline has passed: a reference
+    // keeping the owner alive until expire() returns, or null if the
+    // owner is already being destroyed.
+    virtual std::shared_ptr<void> pin() = 0;
+    // Outside the lock, on the wheel's io_context, with the owner pinned.
+    virtual void expire(std::uint64_t generation) = 0;
+
+    TimerWheel* wheel_ = nullptr;  // last armed on; set and read by the owner
+    Timer* prev_ = nullptr;
+    Timer* next_ = nullptr;
+    std::uint64_t due_ = 0;  // tick
+    std::uint64_t generation_ = 0;
+    bool linked_ = false;
+  };
+
+  TimerWheel(boost::asio::io_context& ioc, std::chrono::milliseconds tick, std::size_t slots = 512);
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  // Starts ticking on the io_context.
+  void start();
+
+  // (Re)arms `t` to expire after `timeout`, moving it here if another
+  // wheel holds it. Thread-safe across timers; calls for one timer must
+  // not race each other (its owner's executor serializes them).
+  void arm(Timer& t, std::chrono::milliseconds timeout);
+  // Disarms `t` on whichever wheel holds it; thread-safe likewise.
+  void cancel(Timer& t);
+
+private:
+  struct Expired {
+    std::shared_ptr<void> owner;
+    Timer* timer;
+    std::uint64_t generation;
+  };
+
+  void schedule_tick();
+  void on_tick();
+  void link(Timer& t);
+  void unlink(Timer& t);
+
+  boost::asio::steady_timer ticker_;
+  const std::chrono::steady_clock::duration tick_;
+  const std::chrono::steady_clock::time_point origin_;
+
+  std::mutex mtx_;
+  std::vector<Timer*> slots_;  // list heads, under mtx_
+  std::uint64_t now_ = 0;      // last tick expired, under mtx_
+
+  std::vector<Expired> batch_;  // reused by on_tick()
+};
+
+// The wheels of a Server. A shared io_context runs each session's handlers
+// on whichever worker thread is free, so a session-owned wheel would have
+// every worker taking its lock. Here each thread arms on a wheel of its
+// own instead: the lock is then taken by that thread, by its wheel's tick
+// and by a cancel from the thread that ran the completion, never by every
+// worker at once. A per-core server has one wheel and one thread.
+class TimerWheels {
+public:
+  TimerWheels(boost::asio::io_context& ioc, std::chrono::milliseconds tick, unsigned count);
+
+  void start();
+
+  // On the calling thread's wheel.
+  void arm(TimerWheel::Timer& t, std::chrono::milliseconds timeout) { local().arm(t, timeout); }
+  // On the wheel that holds it.
+  void cancel(TimerWheel::Timer& t) {
+    if (t.wheel_) t.wheel_->cancel(t);
+  }
+
+private:
+  TimerWheel& local();
+
+  std::vector<std::unique_ptr<TimerWheel>> wheels_;
+};
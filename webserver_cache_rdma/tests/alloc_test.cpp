@@ -0,0 +1,175 @@
+// A warmed-up keep-alive connection must not allocate: every operator new
+// in the process is counted while a client on this thread drives a Server
+// running on its own thread, and after the warm-up round the count must
+// not move, under every eviction policy. The mix covers cache hits, a 304
+// and two pipelined requests answered in one write. Once the connection
+// is idle it must hold no read buffer.
+#include "../src/headers/server.hpp"
+#include "../src/headers/util/config.hpp"
+#include "../src/headers/util/metrics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+
+namespace {
+std::atomic<unsigned long long> g_news{0};
+}
+
+void* operator new(std::size_t n) {
+  g_news.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+
+void* operator new(std::size_t n, std::align_val_t al) {
+  g_news.fetch_add(1, std::memory_order_relaxed);
+  const auto a = static_cast<std::size_t>(al);
+  if (void* p = std::aligned_alloc(a, (n + a - 1) / a * a)) return p;
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { std::free(p); }
+
+namespace {
+
+using boost::asio::ip::tcp;
+
+char g_in[1 << 16];
+
+// Reads `responses` whole responses (head plus Content-Length bytes) from
+// the socket into a fixed buffer; false on a short read or a non-200/304.
+bool read_responses(tcp::socket& sock, int responses) {
+  std::size_t have = 0;
+  while (responses > 0) {
+    const char* head_end = static_cast<const char*>(memmem(g_in, have, "\r\n\r\n", 4));
+    if (head_end) {
+      const std::size_t head_len = static_cast<std::size_t>(head_end - g_in) + 4;
+      if (std::strncmp(g_in, "HTTP/1.1 200", 12) != 0 && std::strncmp(g_in, "HTTP/1.1 304", 12) != 0) return false;
+      std::size_t body = 0;
+      if (const char* cl = static_cast<const char*>(memmem(g_in, head_len, "Content-Length: ", 16))) {
+        body = std::strtoul(cl + 16, nullptr, 10);
+      }
+      if (std::strncmp(g_in, "HTTP/1.1 304", 12) == 0) body = 0;
+      if (have >= head_len + body) {
+        std::memmove(g_in, g_in + head_len + body, have - head_len - body);
+        have -= head_len + body;
+        --responses;
+        continue;
+      }
+    }
+    boost::system::error_code ec;
+    const std::size_t n = sock.read_some(boost::asio::buffer(g_in + have, sizeof(g_in) - have), ec);
+    if (ec) return false;
+    have += n;
+  }
+  return have == 0;
+}
+
+bool send(tcp::socket& sock, std::string_view bytes) {
+  boost::system::error_code ec;
+  boost::asio::write(sock, boost::asio::buffer(bytes.data(), bytes.size()), ec);
+  return !ec;
+}
+
+// One server with the given eviction policy, one keep-alive client.
+int run(const std::string& dir, const char* policy) {
+  Config cfg;
+  cfg.port = 0;
+  cfg.doc_root = dir;
+  cfg.cache_policy = policy;
+  auto cache = std::make_shared<LRUCache>(static_cast<std::size_t>(cfg.cache_mem_mb) * 1024 * 1024,
+                                          cfg.cache_shards, cfg.cache_policy);
+  auto paths = std::make_shared<PathResolver>(cfg.doc_root, true);
+  boost::asio::io_context ioc(1);
+  Server server{ioc, cfg, cache, std::make_shared<SingleFlight>(), paths, nullptr};
+  server.start();
+  std::thread worker([&ioc] { ioc.run(); });
+
+  tcp::socket sock(ioc);
+  sock.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), server.port()));
+
+  // The ETag the 304 request revalidates against, taken from a first GET.
+  std::string etag;
+  {
+    send(sock, "GET /index.html HTTP/1.1\r\nHost: t\r\n\r\n");
+    read_responses(sock, 1);
+    const char* e = static_cast<const char*>(memmem(g_in, sizeof(g_in), "ETag: ", 6));
+    if (e) etag.assign(e + 6, static_cast<const char*>(std::memchr(e, '\r', 64)));
+  }
+  const std::string conditional = "GET /index.html HTTP/1.1\r\nHost: t\r\nIf-None-Match: " + etag + "\r\n\r\n";
+
+  const auto round = [&](int n) {
+    for (int i = 0; i < n; ++i) {
+      if (!send(sock, "GET /index.html HTTP/1.1\r\nHost: t\r\nAccept-Encoding: gzip, deflate, br\r\n\r\n") ||
+          !read_responses(sock, 1)) return false;
+      if (!send(sock, conditional) || !read_responses(sock, 1)) return false;
+      if (!send(sock, "GET /site.css HTTP/1.1\r\nHost: t\r\n\r\nGET / HTTP/1.1\r\nHost: t\r\n\r\n") ||
+          !read_responses(sock, 2)) return false;
+    }
+    return true;
+  };
+
+  int status = 0;
+  if (!round(200)) {
+    std::fprintf(stderr, "FAIL [%s] warm-up requests\n", policy);
+    status = 1;
+  }
+  const unsigned long long before = g_news.load();
+  constexpr int kRounds = 2000;
+  if (status == 0 && !round(kRounds)) {
+    std::fprintf(stderr, "FAIL [%s] requests\n", policy);
+    status = 1;
+  }
+  const unsigned long long allocations = g_news.load() - before;
+  std::printf("%s: %llu allocations over %d requests\n", policy, allocations, kRounds * 4);
+  if (status == 0 && allocations != 0) status = 1;
+
+  // Idle again: the session must have handed its read buffer back. The
+  // last response can reach us just before the server gets there.
+  auto& m = Metrics::instance();
+  for (int i = 0; i < 1000 && m.read_buffers_in_use.load() != 0; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  if (m.read_buffers_in_use.load() != 0) {
+    std::fprintf(stderr, "FAIL [%s] %llu read buffers still borrowed by an idle connection\n", policy,
+                 m.read_buffers_in_use.load());
+    status = 1;
+  }
+
+  sock.close();
+  ioc.stop();
+  worker.join();
+  return status;
+}
+
+} // namespace
+
+int main() {
+  char dir[] = "/tmp/alloc_test.XXXXXX";
+  if (!::mkdtemp(dir)) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  std::ofstream(std::string(dir) + "/index.html") << std::string(4096, 'x');
+  std::ofstream(std::string(dir) + "/site.css") << "body { color: black; }\n";
+
+  // Every eviction policy: a hit must not allocate under any of them.
+  int status = 0;
+  for (const char* policy : {"lru", "sieve", "wtinylfu", "gdsf"}) {
+    if (run(dir, policy) != 0) status = 1;
+  }
+  std::filesystem::remove_all(dir);
+  return status;
+}
@@ -0,0 +1,147 @@
+// LRUCache with every eviction policy, one shard and several: lookups see
+// what was put, replacements and erases take effect, erase_file drops a
+// file's segments, and the byte budget holds. Then threads hammer a small
+// cache with hits, puts and erases at once; under SIEVE the hits run under
+// the shard's shared lock while puts evict under the exclusive one. Each
+// body names its key, so a lookup that returns another key's entry fails.
+#include "../src/headers/cache/lru_cache.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const char* what, const char* policy, std::size_t shards) {
+  if (ok) return;
+  if (++failures <= 20) std::fprintf(stderr, "FAIL %s [%s, %zu shards]\n", what, policy, shards);
+}
+
+LRUCache::Entry entry_for(const std::string& key, std::size_t bytes) {
+  LRUCache::Entry e;
+  e.body = std::make_shared<std::vector<uint8_t>>(bytes, 'x');
+  std::copy(key.begin(), key.begin() + std::min(key.size(), bytes), e.body->begin());
+  e.size = bytes;
+  e.etag = "\"" + key + "\"";
+  return e;
+}
+
+bool names(const LRUCache::Entry& e, const std::string& key) {
+  return e.body && e.etag == "\"" + key + "\"" && e.body->size() >= key.size() &&
+         std::equal(key.begin(), key.end(), e.body->begin());
+}
+
+void test_basics(const char* policy, std::size_t shards) {
+  LRUCache cache(64 * 1024, shards, policy);
+  LRUCache::Entry out;
+
+  cache.put("/a", entry_for("/a", 100));
+  expect(cache.get("/a", out) && names(out, "/a"), "get after put", policy, shards);
+  expect(!cache.get("/b", out), "miss", policy, shards);
+
+  cache.put("/a", entry_for("/a", 300));
+  expect(cache.get("/a", out) && out.size == 300, "replacement", policy, shards);
+  expect(cache.items() == 1 && cache.size_bytes() == 300, "replacement charge", policy, shards);
+
+  cache.erase("/a");
+  expect(!cache.get("/a", out) && cache.size_bytes() == 0, "erase", policy, shards);
+
+  LRUCache::Entry manifest;
+  manifest.size = 2500;
+  manifest.segment_size = 1000;
+  cache.put("/big", manifest);
+  for (std::size_t i = 0; i < 3; ++i) {
+    const std::string k = LRUCache::segment_key("/big", i);
+    cache.put(k, entry_for(k, 1000));
+  }
+  expect(cache.items() == 4, "segments stored", policy, shards);
+  cache.erase_file("/big");
+  expect(cache.items() == 0, "erase_file drops segments", policy, shards);
+
+  cache.put("/dir/x", entry_for("/dir/x", 10));
+  cache.put("/dir/y", entry_for("/dir/y", 10));
+  cache.put("/other", entry_for("/other", 10));
+  cache.erase_prefix("/dir/");
+  expect(cache.items() == 1 && cache.get("/other", out), "erase_prefix", policy, shards);
+
+  // Far more than fits: the budget holds and the last put is still there
+  // unless the policy declined to admit it.
+  for (int i = 0; i < 1000; ++i) {
+    const std::string k = "/fill/" + std::to_string(i);
+    cache.put(k, entry_for(k, 512));
+  }
+  expect(cache.size_bytes() <= cache.capacity_bytes(), "byte budget", policy, shards);
+  expect(cache.items() > 0, "something resident after eviction", policy, shards);
+}
+
+void test_concurrent(const char* policy, std::size_t shards) {
+  // Room for about a third of the keys, so puts keep evicting while other
+  // threads hit.
+  constexpr std::size_t kKeys = 600;
+  constexpr std::size_t kBytes = 256;
+  LRUCache cache(kKeys / 3 * kBytes, shards, policy);
+  std::vector<std::string> keys;
+  for (std::size_t i = 0; i < kKeys; ++i) keys.push_back("/k/" + std::to_string(i));
+
+  std::vector<int> bad(8, 0);
+  std::vector<std::thread> pool;
+  for (unsigned t = 0; t < bad.size(); ++t) {
+    pool.emplace_back([&, t] {
+      std::uint32_t seed = 88172645u + t * 104729u;
+      LRUCache::Entry out;
+      for (int i = 0; i < 40000; ++i) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        // Skewed: the low keys are hit far more often.
+        const std::string& k = keys[(seed % kKeys) * (seed % kKeys) / kKeys];
+        const unsigned op = (seed >> 24) % 100;
+        if (op < 85) {
+          if (cache.get(k, out) && !names(out, k)) ++bad[t];
+          else if (!out.body) cache.put(k, entry_for(k, kBytes));
+        } else if (op < 97) {
+          cache.put(k, entry_for(k, kBytes));
+        } else {
+          cache.erase(k);
+        }
+        out.clear();
+      }
+    });
+  }
+  for (auto& th : pool) th.join();
+
+  int wrong = 0;
+  for (int b : bad) wrong += b;
+  expect(wrong == 0, "concurrent lookup returned another key's entry", policy, shards);
+  expect(cache.size_bytes() <= cache.capacity_bytes(), "concurrent byte budget", policy, shards);
+  LRUCache::Entry out;
+  std::size_t resident = 0;
+  for (const auto& k : keys) {
+    if (!cache.get(k, out)) continue;
+    expect(names(out, k), "entry after concurrent run", policy, shards);
+    ++resident;
+  }
+  expect(resident == cache.items(), "item count after concurrent run", policy, shards);
+}
+
+} // namespace
+
+int main() {
+  for (const char* policy : {"lru", "sieve", "wtinylfu", "gdsf"}) {
+    for (std::size_t shards : {1, 4}) {
+      test_basics(policy, shards);
+      test_concurrent(policy, shards);
+    }
+  }
+  if (failures > 0) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,129 @@
+// Conditional GET evaluation (RFC 7232) against a table of requests:
+// If-None-Match with weak and strong forms of our tag, lists, "*" and
+// malformed lists, precedence over If-Modified-Since, methods other than
+// GET/HEAD, and If-Modified-Since dates before, at and after the file's
+// mtime. Then IMF-fixdate parsing on its own, including the obsolete
+// formats and out-of-range fields it must refuse.
+#include "../src/headers/http/conditional.hpp"
+#include "../src/headers/util/time.hpp"
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+constexpr std::time_t kMtime = 784111777;  // Sun, 06 Nov 1994 08:49:37 GMT
+const std::string kEtag = "W/\"4096-784111777\"";
+
+HttpRequest request(const char* method, const char* inm, const char* ims) {
+  HttpRequest r;
+  r.method = method;
+  r.target = "/index.html";
+  r.version = "HTTP/1.1";
+  if (inm) r.headers[r.header_count++] = {"If-None-Match", inm};
+  if (ims) r.headers[r.header_count++] = {"if-modified-since", ims};
+  return r;
+}
+
+void test_is_not_modified() {
+  const struct {
+    const char* method;
+    const char* inm;
+    const char* ims;
+    bool want;
+  } cases[] = {
+    // If-None-Match compares weakly: W/ or not, the opaque tag decides.
+    {"GET", "W/\"4096-784111777\"", nullptr, true},
+    {"GET", "\"4096-784111777\"", nullptr, true},
+    {"HEAD", "W/\"4096-784111777\"", nullptr, true},
+    {"GET", "W/\"4096-784111778\"", nullptr, false},
+    {"GET", "W/\"4096-784111777-gzip\"", nullptr, false},  // another representation
+    {"GET", "\"a\", W/\"b\",\tW/\"4096-784111777\"", nullptr, true},
+    {"GET", "\"a\",W/\"b\"", nullptr, false},
+    {"GET", "*", nullptr, true},
+    {"GET", " * ", nullptr, true},
+    {"GET", "\"a\", *", nullptr, true},
+    {"GET", "W/\"4096-784111777", nullptr, false},  // unterminated
+    {"GET", ",,,", nullptr, false},
+    {"GET", "4096-784111777", nullptr, false},       // unquoted: not our tag
+    // If-None-Match wins over If-Modified-Since, either way round.
+    {"GET", "\"other\"", "Sun, 06 Nov 1994 08:49:37 GMT", false},
+    {"GET", "W/\"4096-784111777\"", "Sat, 01 Jan 1994 00:00:00 GMT", true},
+    // If-Modified-Since alone.
+    {"GET", nullptr, "Sun, 06 Nov 1994 08:49:37 GMT", true},   // same second
+    {"GET", nullptr, "Mon, 07 Nov 1994 00:00:00 GMT", true},   // later
+    {"GET", nullptr, "Sun, 06 Nov 1994 08:49:36 GMT", false},  // a second earlier
+    {"GET", nullptr, "Sunday, 06-Nov-94 08:49:37 GMT", false}, // RFC 850: not parsed, so modified
+    {"GET", nullptr, "Sun Nov  6 08:49:37 1994", false},       // asctime: likewise
+    {"GET", nullptr, "garbage", false},
+    {"GET", nullptr, "", false},
+    // Only GET and HEAD are ever answered with 304.
+    {"POST", "*", nullptr, false},
+    {"PUT", "W/\"4096-784111777\"", nullptr, false},
+    {"DELETE", nullptr, "Mon, 07 Nov 1994 00:00:00 GMT", false},
+    // No validators at all.
+    {"GET", nullptr, nullptr, false},
+  };
+  for (const auto& c : cases) {
+    const HttpRequest req = request(c.method, c.inm, c.ims);
+    if (is_not_modified(req, kEtag, kMtime) != c.want && ++failures <= 20) {
+      std::fprintf(stderr, "FAIL %s If-None-Match: %s If-Modified-Since: %s, want %d\n", c.method,
+                   c.inm ? c.inm : "-", c.ims ? c.ims : "-", c.want);
+    }
+  }
+}
+
+void test_parse_http_date() {
+  const struct {
+    const char* text;
+    bool ok;
+    std::time_t want;
+  } cases[] = {
+    {"Sun, 06 Nov 1994 08:49:37 GMT", true, 784111777},
+    {"Thu, 01 Jan 1970 00:00:00 GMT", true, 0},
+    {"Tue, 29 Feb 2000 12:00:00 GMT", true, 951825600},
+    {"Fri, 31 Dec 9999 23:59:59 GMT", true, 253402300799},
+    {"Sun, 06 Nov 1994 08:49:37", false, 0},        // no zone
+    {"Sun, 06 Foo 1994 08:49:37 GMT", false, 0},    // no such month
+    {"Sun, 32 Nov 1994 08:49:37 GMT", false, 0},    // no such day
+    {"Sun, 00 Nov 1994 08:49:37 GMT", false, 0},
+    {"Sun, 06 Nov 1994 24:00:00 GMT", false, 0},    // no such hour
+    {"Sun, 06 Nov 1994 08:60:00 GMT", false, 0},
+    {"Sun, 06 Nov 1994 08:49:61 GMT", false, 0},
+    {"Sun, 06 Nov 1969 08:49:37 GMT", false, 0},    // before the epoch
+    {"Sunday, 06-Nov-94 08:49:37 GMT", false, 0},
+    {"Sun Nov  6 08:49:37 1994", false, 0},
+    {"", false, 0},
+  };
+  for (const auto& c : cases) {
+    std::time_t t = -1;
+    const bool ok = parse_http_date(c.text, t);
+    if ((ok != c.ok || (ok && t != c.want)) && ++failures <= 20) {
+      std::fprintf(stderr, "FAIL parse_http_date(\"%s\") = %d, %lld\n", c.text, ok, static_cast<long long>(t));
+    }
+  }
+
+  // What we send parses back to the same second.
+  for (std::time_t t : {std::time_t{0}, kMtime, std::time_t{1700000000}, std::time_t{4102444800}}) {
+    std::time_t back = -1;
+    if ((!parse_http_date(format_http_date(t), back) || back != t) && ++failures <= 20) {
+      std::fprintf(stderr, "FAIL round trip of %lld through \"%s\"\n", static_cast<long long>(t),
+                   format_http_date(t).c_str());
+    }
+  }
+}
+
+} // namespace
+
+int main() {
+  test_is_not_modified();
+  test_parse_http_date();
+  if (failures > 0) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,122 @@
+// Accept-Encoding negotiation against a table of headers: q-values, q=0
+// exclusions (explicit and through "*"), wildcards, case, whitespace and
+// parameters around q. Then precompressed sibling discovery on a real
+// directory: only siblings that exist are offered, and a resolver that
+// caches the lookup picks up a sibling once the watcher reports it.
+#include "../src/headers/fs/path_resolver.hpp"
+#include "../src/headers/http/encoding.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+  if (ok) return;
+  if (++failures <= 20) std::fprintf(stderr, "FAIL %s\n", what);
+}
+
+void test_encoding_quality() {
+  const struct {
+    const char* accept;
+    const char* coding;
+    double want;
+  } cases[] = {
+    {"gzip, deflate, br", "br", 1.0},
+    {"gzip, deflate, br", "gzip", 1.0},
+    {"gzip, deflate", "br", 0.0},
+    {"gzip;q=0.5, br;q=0.8", "gzip", 0.5},
+    {"gzip;q=0.5, br;q=0.8", "br", 0.8},
+    {"gzip ; q=0.3", "gzip", 0.3},
+    {"gzip;Q=0.3", "gzip", 0.3},
+    {"GZIP", "gzip", 1.0},
+    {"Br", "br", 1.0},
+    // q=0 means "not acceptable", whatever else the header says.
+    {"br;q=0", "br", 0.0},
+    {"br;q=0.000", "br", 0.0},
+    {"br;q=0, *", "br", 0.0},
+    {"*, br;q=0", "br", 0.0},
+    {"gzip;level=9;q=0", "gzip", 0.0},
+    {"gzip;q=0;level=9", "gzip", 0.0},
+    // The wildcard covers codings not listed.
+    {"*", "br", 1.0},
+    {"*;q=0.2", "br", 0.2},
+    {"*;q=0", "br", 0.0},
+    {"*;q=0, gzip", "gzip", 1.0},
+    {"*;q=0, gzip", "br", 0.0},
+    // Out-of-range q-values are clamped; other tokens are not aliases.
+    {"br;q=2", "br", 1.0},
+    {"br;q=-1", "br", 0.0},
+    {"x-gzip", "gzip", 0.0},
+    {"gzipx", "gzip", 0.0},
+    {"identity", "gzip", 0.0},
+    {"", "gzip", 0.0},
+    {" , ,", "gzip", 0.0},
+  };
+  for (const auto& c : cases) {
+    const double q = encoding_quality(c.accept, c.coding);
+    if (std::fabs(q - c.want) > 1e-9 && ++failures <= 20) {
+      std::fprintf(stderr, "FAIL encoding_quality(\"%s\", %s) = %g, want %g\n", c.accept, c.coding, q, c.want);
+    }
+  }
+}
+
+bool offers(const PathMapResult& r, const char* coding) {
+  for (const auto& v : r.variants) {
+    if (std::string(v.coding) == coding) return true;
+  }
+  return false;
+}
+
+void test_variants() {
+  char dir[] = "/tmp/encoding_test.XXXXXX";
+  if (!::mkdtemp(dir)) {
+    std::perror("mkdtemp");
+    ++failures;
+    return;
+  }
+  const std::string root = dir;
+  std::ofstream(root + "/app.js") << "console.log(1);\n";
+  std::ofstream(root + "/app.js.br") << "br";
+  std::ofstream(root + "/style.css") << "body{}\n";
+  std::filesystem::create_directory(root + "/style.css.gz");  // not a regular file
+
+  const auto app = map_url_to_fs(root, "/app.js");
+  expect(app.exists && offers(app, "br") && !offers(app, "gzip"), "only the .br sibling that exists");
+  expect(app.variants.size() == 1 && app.variants[0].cache_key == "/app.js?br", "variant cache key");
+  const auto style = map_url_to_fs(root, "/style.css");
+  expect(style.exists && style.variants.empty(), "a directory named like a sibling is not one");
+
+  // A caching resolver remembers the absent .gz until it is told.
+  PathResolver resolver(root, true);
+  expect(!offers(*resolver.resolve("/app.js"), "gzip"), "no .gz before it exists");
+  std::ofstream(root + "/app.js.gz") << "gz";
+  expect(!offers(*resolver.resolve("/app.js"), "gzip"), "cached lookup until invalidated");
+  resolver.invalidate("/app.js.gz", false);
+  expect(offers(*resolver.resolve("/app.js"), "gzip"), ".gz offered once its creation is reported");
+  std::filesystem::remove(root + "/app.js.br");
+  resolver.invalidate("/app.js.br", false);
+  const auto after = resolver.resolve("/app.js");
+  expect(!offers(*after, "br") && offers(*after, "gzip"), ".br withdrawn once its removal is reported");
+
+  std::filesystem::remove_all(root);
+}
+
+} // namespace
+
+int main() {
+  test_encoding_quality();
+  test_variants();
+  if (failures > 0) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
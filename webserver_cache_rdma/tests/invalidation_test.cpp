@@ -0,0 +1,251 @@
+// A file that changes while its cache miss is being loaded must not leave
+// the old load in the cache. A Server reads misses through a reader that
+// holds each read until told; the file is rewritten while a load is
+// parked there and the doc root watcher reports it, then the read goes
+// ahead. The entry must not be cached, and the next request must get the
+// new file. Then a segmented file whose segments are all resident is
+// changed with no one reporting it: the manifest hit must notice.
+#include "../src/headers/fs/doc_root_watcher.hpp"
+#include "../src/headers/fs/file_reader.hpp"
+#include "../src/headers/server.hpp"
+#include "../src/headers/util/config.hpp"
+#include "../src/headers/util/metrics.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using boost::asio::ip::tcp;
+using namespace std::chrono_literals;
+
+int failures = 0;
+
+void expect(bool ok, const char* what) {
+  if (ok) return;
+  if (++failures <= 20) std::fprintf(stderr, "FAIL %s\n", what);
+}
+
+// Holds every read until release(); then reads through the descriptor
+// the session opened, as the real readers do.
+class GatedReader final : public AsyncFileReader {
+public:
+  const char* name() const override { return "gated"; }
+
+  void read_range(FileOpenResult opened, std::uint64_t offset, std::size_t len, Callback done) override {
+    std::lock_guard<std::mutex> lk(mtx_);
+    opened_ = std::move(opened);
+    offset_ = offset;
+    len_ = len;
+    done_ = std::move(done);
+    cv_.notify_all();
+  }
+
+  bool wait_parked() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    return cv_.wait_for(lk, 5s, [this] { return static_cast<bool>(done_); });
+  }
+
+  void release() {
+    Callback done;
+    FileOpenResult opened;
+    std::uint64_t offset;
+    std::size_t len;
+    {
+      std::lock_guard<std::mutex> lk(mtx_);
+      done.swap(done_);
+      opened = std::move(opened_);
+      offset = offset_;
+      len = len_;
+    }
+    if (done) done(read_file(opened, offset, len));
+  }
+
+private:
+  std::mutex mtx_;
+  std::condition_variable cv_;
+  FileOpenResult opened_;
+  std::uint64_t offset_ = 0;
+  std::size_t len_ = 0;
+  Callback done_;
+};
+
+void write_file(const std::string& path, const std::string& text) {
+  std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+}
+
+bool send(tcp::socket& sock, const std::string& bytes) {
+  boost::system::error_code ec;
+  boost::asio::write(sock, boost::asio::buffer(bytes), ec);
+  return !ec;
+}
+
+// One response: its status line and body (by Content-Length).
+bool read_response(tcp::socket& sock, std::string& status, std::string& body) {
+  std::string in;
+  char buf[8192];
+  std::size_t head_end = std::string::npos;
+  std::size_t length = 0;
+  for (;;) {
+    if (head_end == std::string::npos && (head_end = in.find("\r\n\r\n")) != std::string::npos) {
+      const std::size_t cl = in.find("Content-Length: ");
+      if (cl != std::string::npos && cl < head_end) length = std::strtoul(in.c_str() + cl + 16, nullptr, 10);
+      head_end += 4;
+    }
+    if (head_end != std::string::npos && in.size() >= head_end + length) break;
+    boost::system::error_code ec;
+    const std::size_t n = sock.read_some(boost::asio::buffer(buf), ec);
+    if (ec) return false;
+    in.append(buf, n);
+  }
+  status = in.substr(0, in.find("\r\n"));
+  body = in.substr(head_end, length);
+  return true;
+}
+
+std::string get(tcp::socket& sock, const char* path, std::string& status) {
+  std::string body;
+  if (!send(sock, std::string("GET ") + path + " HTTP/1.1\r\nHost: t\r\n\r\n") ||
+      !read_response(sock, status, body)) {
+    status = "no response";
+  }
+  return body;
+}
+
+struct Running {
+  boost::asio::io_context ioc{1};
+  std::shared_ptr<LRUCache> cache;
+  std::unique_ptr<Server> server;
+  std::thread worker;
+
+  Running(const Config& cfg, std::shared_ptr<PathResolver> paths, std::shared_ptr<AsyncFileReader> files)
+    : cache(std::make_shared<LRUCache>(std::size_t{16} << 20, 4)) {
+    server = std::make_unique<Server>(ioc, cfg, cache, std::make_shared<SingleFlight>(), std::move(paths),
+                                      std::move(files));
+    server->start();
+  }
+  void run() {
+    worker = std::thread([this] { ioc.run(); });
+  }
+  ~Running() {
+    ioc.stop();
+    if (worker.joinable()) worker.join();
+  }
+};
+
+void test_parked_load(const std::string& root) {
+  const std::string file = root + "/page.html";
+  write_file(file, "version one\n");
+
+  Config cfg;
+  cfg.port = 0;
+  cfg.doc_root = root;
+  auto reader = std::make_shared<GatedReader>();
+  auto paths = std::make_shared<PathResolver>(root, true);
+  Running r(cfg, paths, reader);
+
+  // Wired as main() wires it.
+  std::atomic<int> reported{0};
+  DocRootWatcher watcher{r.ioc, root};
+  auto cache = r.cache;
+  watcher.add_listener([cache, paths, &reported](const std::string& url_path, bool is_dir) {
+    invalidate_cached_path(*cache, url_path, is_dir);
+    paths->invalidate(url_path, is_dir);
+    if (url_path == "/page.html") reported.fetch_add(1);
+  });
+  if (!watcher.start()) {
+    std::fprintf(stderr, "no inotify; skipping the parked-load case\n");
+    return;
+  }
+  r.run();
+
+  tcp::socket sock(r.ioc);
+  sock.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), r.server->port()));
+  auto& m = Metrics::instance();
+  const auto stale_before = m.cache_stale_loads.load();
+
+  std::string status, body;
+  std::thread client([&] { body = get(sock, "/page.html", status); });
+  expect(reader->wait_parked(), "the miss reached the reader");
+
+  // Rewritten, and reported, while the load waits.
+  write_file(file, "version two, longer\n");
+  for (int i = 0; i < 500 && reported.load() == 0; ++i) std::this_thread::sleep_for(10ms);
+  expect(reported.load() > 0, "the watcher reported the change");
+  reader->release();
+  client.join();
+  expect(status == "HTTP/1.1 200 OK", "the parked request was answered");
+
+  LRUCache::Entry e;
+  expect(!r.cache->get("/page.html", e), "a load invalidated mid-read is not cached");
+  expect(m.cache_stale_loads.load() - stale_before == 1, "cache_stale_loads counts it");
+
+  // The next request loads the new file, and that one is kept.
+  std::thread next([&] { body = get(sock, "/page.html", status); });
+  expect(reader->wait_parked(), "the next request misses");
+  reader->release();
+  next.join();
+  expect(status == "HTTP/1.1 200 OK" && body == "version two, longer\n", "the next request gets the new file");
+  const FileOpenResult now = open_file(file);
+  expect(r.cache->get("/page.html", e) && e.size == body.size() && e.etag == make_etag(now.size, now.last_modified),
+         "the new file is cached under its own ETag");
+  sock.close();
+}
+
+void test_manifest_hit(const std::string& root) {
+  const std::string file = root + "/big.bin";
+  write_file(file, std::string(4096, 'a'));
+
+  Config cfg;
+  cfg.port = 0;
+  cfg.doc_root = root;
+  cfg.cache_segment_bytes = 1024;
+  // Not watched: nothing reports the change below.
+  Running r(cfg, std::make_shared<PathResolver>(root, false), nullptr);
+  r.run();
+
+  tcp::socket sock(r.ioc);
+  sock.connect(tcp::endpoint(boost::asio::ip::address_v4::loopback(), r.server->port()));
+  auto& m = Metrics::instance();
+  std::string status;
+  expect(get(sock, "/big.bin", status) == std::string(4096, 'a'), "segmented file served");
+  const auto segment_misses = m.cache_segment_misses.load();
+  expect(get(sock, "/big.bin", status) == std::string(4096, 'a'), "served again from its segments");
+  expect(m.cache_segment_misses.load() == segment_misses, "every segment resident");
+
+  write_file(file, std::string(4096, 'b'));
+  fs::last_write_time(file, fs::last_write_time(file) + 10s);
+  expect(get(sock, "/big.bin", status) == std::string(4096, 'b'), "a manifest hit notices the changed file");
+  expect(get(sock, "/big.bin", status) == std::string(4096, 'b'), "and keeps serving the new one");
+  sock.close();
+}
+
+} // namespace
+
+int main() {
+  char dir[] = "/tmp/invalidation_test.XXXXXX";
+  if (!::mkdtemp(dir)) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  test_parked_load(dir);
+  test_manifest_hit(dir);
+  fs::remove_all(dir);
+  if (failures > 0) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,266 @@
+// URL to file mapping: sanitize_url_path() against a table of targets
+// (dot segments, "..", repeated slashes, query and fragment), then the
+// traversal check on a real doc root: ".." that would climb out, encoded
+// dots that are just a name, and symlinks leading out of the root,
+// including into a sibling whose name merely starts with the root's. Then
+// PathResolver's cache: repeat lookups hit, symlinked paths are never
+// kept, and invalidate() forgets files, subtrees and "/" for index.html.
+// Last the negative cache: misses and rejections remembered until their
+// TTL, the oldest dropped at capacity, and forgotten on invalidate().
+#include "../src/headers/fs/path_resolver.hpp"
+#include "../src/headers/util/metrics.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const char* what, const std::string& path) {
+  if (ok) return;
+  if (++failures <= 20) std::fprintf(stderr, "FAIL %s [%s]\n", what, path.c_str());
+}
+
+void test_sanitize() {
+  const struct {
+    const char* url;
+    const char* want;
+  } cases[] = {
+    {"/", "/"},
+    {"", "/"},
+    {"/index.html", "/index.html"},
+    {"/a/b/c.txt", "/a/b/c.txt"},
+    {"//a///b//", "/a/b"},
+    {"/./a/./b", "/a/b"},
+    {"/a/b/../c", "/a/c"},
+    {"/a/b/../../c", "/c"},
+    {"/..", "/"},
+    {"/../../etc/passwd", "/etc/passwd"},
+    {"/a/../../../b", "/b"},
+    {"a/b", "/a/b"},
+    {"/a?x=/../../etc", "/a"},
+    {"/a#/../../etc", "/a"},
+    {"/a/..?", "/"},
+    {"/%2e%2e/etc/passwd", "/%2e%2e/etc/passwd"},  // not decoded: a file name
+    {"/...", "/..."},
+    {"/.hidden", "/.hidden"},
+  };
+  std::string reused = "left over from a previous request";
+  for (const auto& c : cases) {
+    const std::string got = sanitize_url_path(c.url);
+    sanitize_url_path(c.url, reused);
+    if ((got != c.want || reused != c.want) && ++failures <= 20) {
+      std::fprintf(stderr, "FAIL sanitize_url_path(\"%s\") = \"%s\" / \"%s\", want \"%s\"\n", c.url, got.c_str(),
+                   reused.c_str(), c.want);
+    }
+  }
+}
+
+void write(const std::string& path, const char* text) { std::ofstream(path) << text; }
+
+void test_traversal(const std::string& root) {
+  const struct {
+    const char* url;
+    bool ok;
+    bool exists;
+  } cases[] = {
+    {"/", true, true},
+    {"/index.html", true, true},
+    {"/sub/page.html", true, true},
+    {"/../index.html", true, true},                  // clamped to the root
+    {"/sub/../../../../etc/passwd", true, false},    // likewise: /etc/passwd under root
+    {"/%2e%2e/secret.txt", true, false},             // a literal name, not found
+    {"/..%2fsecret.txt", true, false},
+    {"/inside_link/page.html", true, true},          // a symlink that stays inside
+    {"/out_link/secret.txt", false, false},          // a symlink to a sibling directory
+    {"/prefix_link/secret.txt", false, false},       // ... whose name starts with the root's
+    {"/file_link", false, false},                    // a symlink to a file outside
+    {"/missing.html", true, false},
+  };
+  const fs::path canon_root = fs::canonical(root);
+  for (const auto& c : cases) {
+    const PathMapResult r = map_url_to_fs(root, c.url);
+    bool ok = r.ok == c.ok && r.exists == c.exists;
+    if (ok && r.ok) {
+      // Whatever was allowed resolves inside the root.
+      const std::string rel = fs::path(r.fs_path).lexically_relative(canon_root).generic_string();
+      ok = !rel.empty() && rel != ".." && rel.compare(0, 3, "../") != 0;
+    }
+    if (ok && !r.ok) ok = r.error == "Path traversal" && r.fs_path.empty();
+    if (!ok && ++failures <= 20) {
+      std::fprintf(stderr, "FAIL map_url_to_fs(\"%s\"): ok %d exists %d fs_path \"%s\" error \"%s\"\n", c.url, r.ok,
+                   r.exists, r.fs_path.c_str(), r.error.c_str());
+    }
+  }
+
+  const PathMapResult via = map_url_to_fs(root, "/inside_link/page.html");
+  expect(via.via_symlink && via.cache_key == "/sub/page.html", "symlinked path keyed by its target",
+         "/inside_link/page.html");
+  const PathMapResult direct = map_url_to_fs(root, "/");
+  expect(!direct.via_symlink && direct.cache_key == "/index.html", "\"/\" keyed as /index.html", "/");
+}
+
+void test_resolver(const std::string& root) {
+  auto& m = Metrics::instance();
+  PathResolver resolver(root, true);
+
+  // A repeat lookup is the same cached result, spelled any way.
+  const auto first = resolver.resolve("/sub/page.html");
+  const auto hits = m.path_cache_hits.load();
+  expect(resolver.resolve("/sub/page.html") == first, "repeat lookup hits", "/sub/page.html");
+  expect(resolver.resolve("/sub/./page.html?v=2") == first, "sanitized spelling hits", "/sub/./page.html?v=2");
+  expect(resolver.resolve("//sub//x/../page.html") == first, "dot segments hit", "//sub//x/../page.html");
+  expect(m.path_cache_hits.load() - hits == 3, "path_cache_hits counts them", "/sub/page.html");
+
+  // Neither a symlinked path nor a rejected one is kept.
+  const std::size_t before = resolver.size();
+  const auto via = resolver.resolve("/inside_link/page.html");
+  expect(via->exists && resolver.size() == before, "symlinked path not cached", "/inside_link/page.html");
+  expect(resolver.resolve("/inside_link/page.html") != via, "symlinked path mapped again", "/inside_link/page.html");
+  expect(!resolver.resolve("/out_link/secret.txt")->ok && resolver.size() == before, "traversal not cached",
+         "/out_link/secret.txt");
+
+  // invalidate() of a file forgets just that file.
+  const auto index = resolver.resolve("/");
+  const auto other = resolver.resolve("/other.html");
+  resolver.invalidate("/sub/page.html", false);
+  expect(resolver.resolve("/sub/page.html") != first, "file invalidated", "/sub/page.html");
+  expect(resolver.resolve("/other.html") == other, "other files kept", "/other.html");
+
+  // "/" is served from /index.html, so an event on one forgets both.
+  resolver.invalidate("/index.html", false);
+  expect(resolver.resolve("/") != index, "\"/\" forgotten with /index.html", "/");
+
+  // A directory event forgets the whole subtree, and nothing else.
+  const auto page = resolver.resolve("/sub/page.html");
+  const auto deep = resolver.resolve("/sub/deeper/leaf.html");
+  const auto sibling = resolver.resolve("/subway.html");
+  resolver.invalidate("/sub", true);
+  expect(resolver.resolve("/sub/page.html") != page, "subtree forgotten", "/sub/page.html");
+  expect(resolver.resolve("/sub/deeper/leaf.html") != deep, "nested subtree forgotten", "/sub/deeper/leaf.html");
+  expect(resolver.resolve("/subway.html") == sibling, "name sharing the prefix kept", "/subway.html");
+
+  // "/" as a directory forgets everything.
+  const auto again = resolver.resolve("/other.html");
+  resolver.invalidate("/", true);
+  expect(resolver.resolve("/other.html") != again, "root event forgets all", "/other.html");
+
+  // A resolver that is not told about changes does not cache.
+  PathResolver uncached(root, false);
+  expect(uncached.resolve("/other.html") != uncached.resolve("/other.html") && uncached.size() == 0,
+         "no caching without a watcher", "/other.html");
+}
+
+void test_negative_cache(const std::string& root) {
+  using namespace std::chrono_literals;
+  auto& m = Metrics::instance();
+  const auto negative_hits = [&m] { return m.negative_cache_hits.load(); };
+
+  // Misses and rejections are remembered until the TTL runs out.
+  {
+    PathResolver resolver(root, false, 16, 100ms);
+    const auto missing = resolver.resolve("/nope.html");
+    const auto rejected = resolver.resolve("/out_link/secret.txt");
+    const auto hits = negative_hits();
+    expect(resolver.resolve("/nope.html") == missing, "miss remembered", "/nope.html");
+    expect(resolver.resolve("/./nope.html?x") == missing, "any spelling of it", "/./nope.html?x");
+    expect(resolver.resolve("/out_link/secret.txt") == rejected, "rejection remembered", "/out_link/secret.txt");
+    expect(negative_hits() - hits == 3, "negative_cache_hits counts them", "/nope.html");
+    expect(resolver.size() == 0, "misses are not positive entries", "/nope.html");
+
+    std::this_thread::sleep_for(150ms);
+    const auto again = resolver.resolve("/nope.html");
+    expect(again != missing && negative_hits() - hits == 3, "expired after the TTL", "/nope.html");
+    expect(resolver.resolve("/nope.html") == again, "remembered afresh", "/nope.html");
+  }
+
+  // Bounded: the oldest miss goes first.
+  {
+    PathResolver resolver(root, false, 3, 60s);
+    const auto a = resolver.resolve("/a.html");
+    const auto b = resolver.resolve("/b.html");
+    resolver.resolve("/c.html");
+    expect(resolver.resolve("/a.html") == a, "within capacity", "/a.html");  // a hit does not refresh
+    const auto d = resolver.resolve("/d.html");
+    expect(resolver.resolve("/a.html") != a, "oldest dropped at capacity", "/a.html");
+    // Re-remembering /a.html dropped /b.html in turn.
+    expect(resolver.resolve("/b.html") != b, "next oldest dropped", "/b.html");
+    expect(resolver.resolve("/d.html") == d, "newest kept", "/d.html");
+  }
+
+  // A file created under a remembered miss is served once reported, and a
+  // directory event forgets the misses below it.
+  {
+    PathResolver resolver(root, true, 16, 60s);
+    expect(!resolver.resolve("/late.html")->exists, "not there yet", "/late.html");
+    write(root + "/late.html", "late\n");
+    expect(!resolver.resolve("/late.html")->exists, "remembered miss until reported", "/late.html");
+    resolver.invalidate("/late.html", false);
+    expect(resolver.resolve("/late.html")->exists, "found once reported", "/late.html");
+
+    expect(!resolver.resolve("/sub/new.html")->exists, "not there yet", "/sub/new.html");
+    write(root + "/sub/new.html", "new\n");
+    resolver.invalidate("/sub", true);
+    expect(resolver.resolve("/sub/new.html")->exists, "found after a directory event", "/sub/new.html");
+    fs::remove(root + "/late.html");
+    fs::remove(root + "/sub/new.html");
+  }
+
+  // No TTL, no negative cache.
+  {
+    PathResolver resolver(root, false, 16, 0ms);
+    const auto hits = negative_hits();
+    expect(resolver.resolve("/nope.html") != resolver.resolve("/nope.html") && negative_hits() == hits,
+           "off without a TTL", "/nope.html");
+  }
+}
+
+} // namespace
+
+int main() {
+  char dir[] = "/tmp/path_resolver_test.XXXXXX";
+  if (!::mkdtemp(dir)) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  const std::string root = dir;
+  const std::string outside = root + "2";  // shares the root's name as a prefix
+  const std::string elsewhere = root + ".out";
+  fs::create_directories(root + "/sub/deeper");
+  fs::create_directories(outside);
+  fs::create_directories(elsewhere);
+  write(root + "/index.html", "<h1>index</h1>\n");
+  write(root + "/other.html", "other\n");
+  write(root + "/subway.html", "subway\n");
+  write(root + "/sub/page.html", "page\n");
+  write(root + "/sub/deeper/leaf.html", "leaf\n");
+  write(outside + "/secret.txt", "secret\n");
+  write(elsewhere + "/secret.txt", "secret\n");
+  fs::create_directory_symlink("sub", root + "/inside_link");
+  fs::create_directory_symlink(elsewhere, root + "/out_link");
+  fs::create_directory_symlink(outside, root + "/prefix_link");
+  fs::create_symlink(outside + "/secret.txt", root + "/file_link");
+
+  test_sanitize();
+  test_traversal(root);
+  test_resolver(root);
+  test_negative_cache(root);
+
+  fs::remove_all(root);
+  fs::remove_all(outside);
+  fs::remove_all(elsewhere);
+  if (failures > 0) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,142 @@
+// Range header parsing (RFC 7233) against a table of headers: single,
+// suffix, open-ended, multiple, overlapping and out-of-order ranges,
+// ranges clipped to the body, unsatisfiable ones (416) and malformed ones
+// (ignored, so the full body is sent). Then If-Range validators.
+#include "../src/headers/http/range.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+struct Case {
+  const char* header;
+  std::uint64_t size;
+  RangeResult want;
+  std::vector<ByteRange> ranges;  // when Satisfiable
+};
+
+const char* name_of(RangeResult r) {
+  switch (r) {
+    case RangeResult::None: return "None";
+    case RangeResult::Satisfiable: return "Satisfiable";
+    case RangeResult::Unsatisfiable: return "Unsatisfiable";
+  }
+  return "?";
+}
+
+std::string many_ranges(int n) {
+  std::string v = "bytes=";
+  for (int i = 0; i < n; ++i) v += (i ? "," : "") + std::to_string(i * 10) + "-" + std::to_string(i * 10 + 1);
+  return v;
+}
+
+void test_parse_range() {
+  const std::string sixteen = many_ranges(16);
+  const std::string seventeen = many_ranges(17);
+  const std::vector<Case> cases = {
+    // One range, in its three forms, and clipped to the body.
+    {"bytes=0-499", 1000, RangeResult::Satisfiable, {{0, 499}}},
+    {"bytes=500-", 1000, RangeResult::Satisfiable, {{500, 999}}},
+    {"bytes=-200", 1000, RangeResult::Satisfiable, {{800, 999}}},
+    {"bytes=-2000", 1000, RangeResult::Satisfiable, {{0, 999}}},
+    {"bytes=990-2000", 1000, RangeResult::Satisfiable, {{990, 999}}},
+    {"bytes=999-999", 1000, RangeResult::Satisfiable, {{999, 999}}},
+    {"  bytes= 10 - 20 ", 1000, RangeResult::Satisfiable, {{10, 20}}},
+    // Several: kept in the order asked for; overlapping ones are not merged.
+    {"bytes=0-0,-1", 1000, RangeResult::Satisfiable, {{0, 0}, {999, 999}}},
+    {"bytes=100-199,0-50", 1000, RangeResult::Satisfiable, {{100, 199}, {0, 50}}},
+    {"bytes=0-499,400-999", 1000, RangeResult::Satisfiable, {{0, 499}, {400, 999}}},
+    {"bytes=0-,0-", 10, RangeResult::Satisfiable, {{0, 9}, {0, 9}}},
+    {"bytes=,,0-1,", 1000, RangeResult::Satisfiable, {{0, 1}}},
+    // Unsatisfiable parts are dropped while another one is satisfiable.
+    {"bytes=2000-3000,0-1", 1000, RangeResult::Satisfiable, {{0, 1}}},
+    {sixteen.c_str(), 1000, RangeResult::Satisfiable, {}},
+    // Well-formed, but nothing overlaps the body: 416.
+    {"bytes=1000-", 1000, RangeResult::Unsatisfiable, {}},
+    {"bytes=1000-1001,2000-", 1000, RangeResult::Unsatisfiable, {}},
+    {"bytes=-0", 1000, RangeResult::Unsatisfiable, {}},
+    {"bytes=0-", 0, RangeResult::Unsatisfiable, {}},
+    {"bytes=-5", 0, RangeResult::Unsatisfiable, {}},
+    // Malformed, another unit, or too many ranges: ignored, full 200.
+    {"", 1000, RangeResult::None, {}},
+    {"bytes=", 1000, RangeResult::None, {}},
+    {"bytes=5-3", 1000, RangeResult::None, {}},
+    {"bytes=abc", 1000, RangeResult::None, {}},
+    {"bytes=a-5", 1000, RangeResult::None, {}},
+    {"bytes=1-2-3", 1000, RangeResult::None, {}},
+    {"bytes=-", 1000, RangeResult::None, {}},
+    {"bytes=0-1,junk", 1000, RangeResult::None, {}},
+    {"bytes=+1-5", 1000, RangeResult::None, {}},
+    {"bytes=18446744073709551616-", 1000, RangeResult::None, {}},
+    {"items=0-5", 1000, RangeResult::None, {}},
+    {"Bytes 0-5", 1000, RangeResult::None, {}},
+    {seventeen.c_str(), 1000, RangeResult::None, {}},
+  };
+
+  for (const Case& c : cases) {
+    std::vector<ByteRange> got;
+    const RangeResult r = parse_range(c.header, c.size, got);
+    bool ok = r == c.want;
+    if (ok && r == RangeResult::Satisfiable && !c.ranges.empty()) {
+      ok = got.size() == c.ranges.size();
+      for (std::size_t i = 0; ok && i < got.size(); ++i) {
+        ok = got[i].first == c.ranges[i].first && got[i].last == c.ranges[i].last;
+      }
+    }
+    if (ok && r == RangeResult::Satisfiable) {
+      for (const ByteRange& b : got) ok = ok && b.first <= b.last && b.last < c.size;
+    }
+    if (ok && r != RangeResult::Satisfiable) ok = got.empty();
+    if (!ok && ++failures <= 20) {
+      std::fprintf(stderr, "FAIL parse_range(\"%s\", %llu): %s with %zu ranges, want %s\n", c.header,
+                   static_cast<unsigned long long>(c.size), name_of(r), got.size(), name_of(c.want));
+    }
+  }
+
+  // The limit is a parameter.
+  std::vector<ByteRange> got;
+  if (parse_range("bytes=0-1,2-3,4-5", 100, got, 2) != RangeResult::None) {
+    ++failures;
+    std::fprintf(stderr, "FAIL max_ranges=2 accepted three ranges\n");
+  }
+}
+
+void test_if_range() {
+  const std::string etag = "W/\"1000-1700000000\"";
+  const std::string date = "Tue, 14 Nov 2023 22:13:20 GMT";
+  const struct {
+    const char* value;
+    bool want;
+  } cases[] = {
+    {"", true},  // no validator: ranges apply
+    {"W/\"1000-1700000000\"", true},
+    {"  W/\"1000-1700000000\"  ", true},
+    {"Tue, 14 Nov 2023 22:13:20 GMT", true},
+    {"W/\"1000-1699999999\"", false},  // the file changed: send it whole
+    {"\"1000-1700000000\"", false},    // not the tag we sent
+    {"Mon, 13 Nov 2023 22:13:20 GMT", false},
+    {"*", false},
+  };
+  for (const auto& c : cases) {
+    if (if_range_matches(c.value, etag, date) != c.want && ++failures <= 20) {
+      std::fprintf(stderr, "FAIL if_range_matches(\"%s\") != %d\n", c.value, c.want);
+    }
+  }
+}
+
+} // namespace
+
+int main() {
+  test_parse_range();
+  test_if_range();
+  if (failures > 0) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,167 @@
+// Differential test of the HTTP byte-scanning kernels: every SIMD variant
+// the CPU supports must agree with the scalar one (and the scalar one with
+// std::string_view::find) for every buffer length across several 16- and
+// 32-byte blocks, every start alignment and every delimiter position, so
+// delimiters split across block boundaries are covered. Each buffer is its
+// own exact-size allocation, so an ASan build also catches reads past end.
+// Then the parser itself, with requests split at every byte.
+#include "../src/headers/http/parser.hpp"
+#include "../src/headers/http/scan.hpp"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void fail(const char* what, const char* kernel, std::string_view text, std::size_t start) {
+  if (++failures > 20) return;
+  std::string shown;
+  for (char c : text) {
+    if (c == '\r') shown += "\\r";
+    else if (c == '\n') shown += "\\n";
+    else if (c < 32 || c > 126) shown += '?';
+    else shown += c;
+  }
+  std::fprintf(stderr, "FAIL %s [%s] start=%zu \"%s\"\n", what, kernel, start, shown.c_str());
+}
+
+const char* ref_skip_token(const char* p, const char* end) {
+  while (p < end && is_token_char(*p)) ++p;
+  return p;
+}
+
+// Every kernel from each start offset in [0, max_start] against the reference.
+void compare(const std::vector<const ScanKernels*>& kernels, std::string_view text, std::size_t max_start = 33) {
+  std::unique_ptr<char[]> owned(new char[text.size() + 1]);
+  char* b = owned.get() + 1;  // odd address, and nothing to read past the end
+  std::memcpy(b, text.data(), text.size());
+  const char* e = b + text.size();
+
+  for (std::size_t s = 0; s <= text.size() && s <= max_start; ++s) {
+    const char* p = b + s;
+    const std::size_t head = text.find("\r\n\r\n", s);
+    const std::size_t crlf = text.find("\r\n", s);
+    const char* want_head = head == std::string_view::npos ? e : b + head;
+    const char* want_crlf = crlf == std::string_view::npos ? e : b + crlf;
+    const char* want_token = ref_skip_token(p, e);
+    for (const ScanKernels* k : kernels) {
+      if (k->find_head_end(p, e) != want_head) fail("find_head_end", k->name, text, s);
+      if (k->find_crlf(p, e) != want_crlf) fail("find_crlf", k->name, text, s);
+      if (k->skip_token(p, e) != want_token) fail("skip_token", k->name, text, s);
+    }
+  }
+}
+
+void test_kernels() {
+  const auto kernels = available_scan_kernels();
+  for (const ScanKernels* k : kernels) std::printf("kernel: %s\n", k->name);
+
+  static const char* const kPatterns[] = {"\r\n\r\n", "\r\n", "\r\r\n\n", "\r\n\r", "\n\r\n", "\r\n\r\r\n\r\n"};
+  for (std::size_t len = 0; len <= 100; ++len) {
+    // A delimiter at every position, cut short at the end of the buffer.
+    for (const char* pat : kPatterns) {
+      for (std::size_t pos = 0; pos < len; ++pos) {
+        std::string text(len, 'a');
+        for (std::size_t i = 0; pat[i] && pos + i < len; ++i) text[pos + i] = pat[i];
+        compare(kernels, text);
+      }
+    }
+    // Dense mixes of the interesting bytes.
+    std::uint32_t seed = 12345u + static_cast<std::uint32_t>(len);
+    static const char kAlphabet[] = "\r\n\r\n:a ,\t\x80Z";
+    for (int round = 0; round < 40; ++round) {
+      std::string text(len, 'a');
+      for (char& c : text) {
+        seed = seed * 1664525u + 1013904223u;
+        c = kAlphabet[(seed >> 16) % (sizeof(kAlphabet) - 1)];
+      }
+      compare(kernels, text);
+    }
+  }
+
+  // skip_token must stop at each of the 256 byte values, wherever it sits.
+  for (int v = 0; v < 256; ++v) {
+    for (std::size_t pos = 0; pos < 70; ++pos) {
+      std::string text(70, 'x');
+      text[pos] = static_cast<char>(v);
+      compare(kernels, text, 0);
+    }
+  }
+}
+
+constexpr std::string_view kBrowserRequest =
+  "GET /static/app.js?v=3 HTTP/1.1\r\n"
+  "Host: www.example.com\r\n"
+  "Connection: keep-alive\r\n"
+  "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+  "sec-ch-ua-mobile: ?0\r\n"
+  "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+  "sec-ch-ua-platform: \"Linux\"\r\n"
+  "Accept: */*\r\n"
+  "Sec-Fetch-Site: same-origin\r\n"
+  "Sec-Fetch-Mode: no-cors\r\n"
+  "Sec-Fetch-Dest: script\r\n"
+  "Referer: https://www.example.com/\r\n"
+  "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+  "Accept-Language: en-US,en;q=0.9\r\n"
+  "\r\n";
+
+void expect(bool ok, const char* what, std::size_t split) {
+  if (ok) return;
+  if (++failures <= 20) std::fprintf(stderr, "FAIL parser: %s (split at %zu)\n", what, split);
+}
+
+// Two pipelined requests arriving in two reads, split at every byte.
+void test_parser_splits() {
+  std::string wire(kBrowserRequest);
+  wire += "HEAD / HTTP/1.1\r\nHost: www.example.com\r\n\r\n";
+
+  for (std::size_t split = 0; split <= wire.size(); ++split) {
+    HttpParser parser(8192, 32768, 100);
+    HttpRequest req;
+    std::memcpy(parser.read_ptr(), wire.data(), split);
+    parser.commit(split);
+    int parsed = 0;
+    auto drain = [&] {
+      for (ParseState st; (st = parser.next(req)) != ParseState::Incomplete; parser.release()) {
+        expect(st == ParseState::Done, "state", split);
+        if (parsed == 0) {
+          expect(req.method == "GET", "method", split);
+          expect(req.target == "/static/app.js?v=3", "target", split);
+          expect(req.header_count == 13, "header count", split);
+          expect(req.header("accept-encoding") == "gzip, deflate, br, zstd", "header value", split);
+        } else {
+          expect(req.method == "HEAD", "second method", split);
+          expect(req.header("host") == "www.example.com", "second host", split);
+        }
+        ++parsed;
+      }
+    };
+    drain();
+    std::memcpy(parser.read_ptr(), wire.data() + split, wire.size() - split);
+    parser.commit(wire.size() - split);
+    drain();
+    expect(parsed == 2, "request count", split);
+    parser.reset();
+  }
+}
+
+} // namespace
+
+int main() {
+  test_kernels();
+  test_parser_splits();
+  if (failures > 0) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
@@ -0,0 +1,160 @@
+// Concurrent misses on one key through SingleFlight, the way sessions and
+// RDMA connections drive it: look up the cache, join the flight on a miss,
+// and either load and complete() as the leader or wait for the waiter to
+// hand over the leader's result. The leader holds its load until every
+// other thread has joined, so each round is deterministic: exactly one
+// load and one put, and every follower woken exactly once with the
+// leader's outcome, on success and on failure alike.
+#include "../src/headers/cache/single_flight.hpp"
+#include "../src/headers/util/metrics.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+void expect(bool ok, const char* what, const std::string& key) {
+  if (ok) return;
+  if (++failures <= 20) std::fprintf(stderr, "FAIL %s [%s]\n", what, key.c_str());
+}
+
+struct Outcome {
+  bool hit = false;
+  bool led = false;
+  FlightResult result;
+};
+
+// `threads` concurrent misses on `key`; the leader's load fails if `fail`.
+std::vector<Outcome> miss_together(SingleFlight& flights, LRUCache& cache, const std::string& key, bool fail,
+                                   int threads, std::atomic<int>& loads) {
+  std::vector<Outcome> out(static_cast<std::size_t>(threads));
+  std::atomic<int> followers{0};
+  std::atomic<int> wakeups{0};
+  std::vector<std::thread> pool;
+  for (int t = 0; t < threads; ++t) {
+    pool.emplace_back([&, t] {
+      Outcome& o = out[static_cast<std::size_t>(t)];
+      LRUCache::Entry e;
+      if (cache.get(key, e)) {
+        o.hit = true;
+        o.result.ok = true;
+        o.result.entry = e;
+        return;
+      }
+      std::promise<FlightResult> handed;
+      auto got = handed.get_future();
+      o.led = flights.join(key, [&handed, &wakeups](const FlightResult& r) {
+        wakeups.fetch_add(1);
+        handed.set_value(r);
+      });
+      if (!o.led) {
+        followers.fetch_add(1);
+        o.result = got.get();
+        return;
+      }
+      // Everyone else must be parked on this load before it finishes.
+      while (followers.load() < threads - 1) std::this_thread::yield();
+      loads.fetch_add(1);
+      FlightResult r;
+      if (fail) {
+        r.error = "Read failed";
+      } else {
+        r.entry.body = std::make_shared<std::vector<uint8_t>>(64, 'x');
+        r.entry.size = 64;
+        r.entry.etag = "\"" + key + "\"";
+        cache.put(key, r.entry);
+        r.ok = true;
+      }
+      flights.complete(key, r);
+      o.result = r;
+    });
+  }
+  for (auto& th : pool) th.join();
+  int led = 0;
+  for (const Outcome& o : out) led += o.led;
+  if (led > 0) expect(wakeups.load() == threads - 1, "every follower woken exactly once", key);
+  return out;
+}
+
+void check_round(const std::vector<Outcome>& out, bool fail, const std::string& key) {
+  int leaders = 0;
+  for (const Outcome& o : out) {
+    expect(!o.hit, "no hit before the load completed", key);
+    if (o.led) ++leaders;
+    expect(o.result.ok == !fail, "follower got the leader's outcome", key);
+    if (fail) {
+      expect(o.result.error == "Read failed", "follower got the leader's error", key);
+    } else {
+      expect(o.result.entry.etag == "\"" + key + "\"" && o.result.entry.body, "follower got the leader's entry", key);
+    }
+  }
+  expect(leaders == 1, "exactly one leader", key);
+}
+
+} // namespace
+
+int main() {
+  constexpr int kThreads = 16;
+  auto& m = Metrics::instance();
+  LRUCache cache(1 << 20, 4);
+  SingleFlight flights;
+
+  // A failed load: every follower sees the error and nothing is cached.
+  {
+    std::atomic<int> loads{0};
+    const auto coalesced = m.cache_coalesced_loads.load();
+    const auto out = miss_together(flights, cache, "/fail.html", true, kThreads, loads);
+    check_round(out, true, "/fail.html");
+    expect(loads.load() == 1, "one load for the failed key", "/fail.html");
+    expect(m.cache_coalesced_loads.load() - coalesced == kThreads - 1, "coalesced_loads counts followers",
+           "/fail.html");
+    LRUCache::Entry e;
+    expect(!cache.get("/fail.html", e), "a failed load caches nothing", "/fail.html");
+  }
+
+  // The failed flight is over, so the next miss leads a fresh load, which
+  // succeeds: one load, one put, everyone gets the entry.
+  {
+    std::atomic<int> loads{0};
+    const auto out = miss_together(flights, cache, "/fail.html", false, kThreads, loads);
+    check_round(out, false, "/fail.html");
+    expect(loads.load() == 1, "one load after a failed one", "/fail.html");
+  }
+
+  // Now it is cached: every lookup hits and nothing is loaded.
+  {
+    std::atomic<int> loads{0};
+    const auto out = miss_together(flights, cache, "/fail.html", false, kThreads, loads);
+    for (const Outcome& o : out) expect(o.hit && o.result.ok, "hit once cached", "/fail.html");
+    expect(loads.load() == 0, "no load once cached", "/fail.html");
+  }
+
+  // Different keys at once do not coalesce with each other.
+  {
+    std::atomic<int> loads_a{0}, loads_b{0};
+    std::vector<Outcome> a, b;
+    std::thread ta([&] { a = miss_together(flights, cache, "/a.css", false, kThreads / 2, loads_a); });
+    std::thread tb([&] { b = miss_together(flights, cache, "/b.js", false, kThreads / 2, loads_b); });
+    ta.join();
+    tb.join();
+    check_round(a, false, "/a.css");
+    check_round(b, false, "/b.js");
+    expect(loads_a.load() == 1 && loads_b.load() == 1, "one load per key", "/a.css, /b.js");
+  }
+
+  // Completing a key nobody is loading is a no-op.
+  flights.complete("/nobody.html", FlightResult{});
+
+  if (failures > 0) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
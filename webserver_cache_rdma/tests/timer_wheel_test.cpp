@@ -0,0 +1,188 @@
+// Deadlines on a 512-slot TimerWheel with a 2 ms tick, driven by a real
+// io_context: each fires once, no earlier than its timeout and about a
+// tick later; a cancelled one never fires; a re-armed one fires at its new
+// deadline only, including when it re-arms itself from expire(). Deadlines
+// more than a turn away share a slot with nearer ones and wait for their
+// own turn. After a stall longer than a turn, everything that came due
+// expires in one batch and the rest stays armed. Then TimerWheels: a timer
+// re-armed or cancelled from another thread leaves the first thread's
+// wheel.
+#include "../src/headers/util/timer_wheel.hpp"
+
+#include <atomic>
+#include <boost/asio/executor_work_guard.hpp>
+#include <boost/asio/post.hpp>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+
+namespace {
+
+using namespace std::chrono_literals;
+using Clock = std::chrono::steady_clock;
+
+constexpr auto kTick = 2ms;
+// How late a deadline may fire on a loaded machine, beyond its one tick.
+constexpr auto kSlack = 300ms;
+
+int failures = 0;
+
+void expect(bool ok, const char* what, const char* name) {
+  if (ok) return;
+  if (++failures <= 20) std::fprintf(stderr, "FAIL %s [%s]\n", what, name);
+}
+
+struct Probe final : TimerWheel::Timer, std::enable_shared_from_this<Probe> {
+  explicit Probe(const char* n) : name(n) {}
+
+  const char* name;
+  std::atomic<int> fired{0};
+  Clock::time_point armed_at;
+  Clock::time_point fired_at;
+  std::uint64_t fired_generation = 0;
+  // Re-arms this many more times from expire(), `every` apart.
+  TimerWheel* rearm_on = nullptr;
+  int rearms = 0;
+  std::chrono::milliseconds every{0};
+
+  void arm(TimerWheel& w, std::chrono::milliseconds timeout) {
+    armed_at = Clock::now();
+    w.arm(*this, timeout);
+  }
+
+private:
+  std::shared_ptr<void> pin() override { return shared_from_this(); }
+
+  void expire(std::uint64_t generation) override {
+    fired_at = Clock::now();
+    fired_generation = generation;
+    if (rearm_on && rearms > 0) {
+      --rearms;
+      expect(fired_at - armed_at >= every, "periodic deadline not early", name);
+      arm(*rearm_on, every);
+    }
+    fired.fetch_add(1, std::memory_order_release);
+  }
+};
+
+std::shared_ptr<Probe> probe(const char* name) { return std::make_shared<Probe>(name); }
+
+// Fired once, within [timeout, timeout + tick + slack] of its last arm().
+void expect_fired_in_time(const Probe& p, std::chrono::milliseconds timeout) {
+  expect(p.fired.load(std::memory_order_acquire) == 1, "fired exactly once", p.name);
+  expect(p.fired_at - p.armed_at >= timeout, "not early", p.name);
+  expect(p.fired_at - p.armed_at <= timeout + kTick + kSlack, "not late", p.name);
+  expect(p.fired_generation == p.generation(), "expired with its current generation", p.name);
+}
+
+void test_arm_cancel_rearm(TimerWheel& wheel) {
+  auto a = probe("a"), b = probe("b"), c = probe("c"), d = probe("d"), e = probe("e");
+  a->arm(wheel, 20ms);
+  b->arm(wheel, 40ms);
+  c->arm(wheel, 20ms);
+  wheel.cancel(*c);
+  d->arm(wheel, 20ms);
+  d->arm(wheel, 60ms);  // replaces the 20 ms deadline
+  e->rearm_on = &wheel;
+  e->rearms = 4;
+  e->every = 10ms;
+  e->arm(wheel, 10ms);
+  std::this_thread::sleep_for(60ms + kTick + kSlack);
+
+  expect_fired_in_time(*a, 20ms);
+  expect_fired_in_time(*b, 40ms);
+  expect(c->fired.load() == 0, "cancelled deadline never fires", "c");
+  expect_fired_in_time(*d, 60ms);
+  expect(e->fired.load(std::memory_order_acquire) == 5 && e->rearms == 0, "re-armed from expire()", "e");
+
+  // Cancelling after expiry, or twice, is harmless.
+  wheel.cancel(*a);
+  wheel.cancel(*c);
+  wheel.cancel(*c);
+  wheel.cancel(*e);
+}
+
+void test_wrap(TimerWheel& wheel) {
+  // 550 ticks away lands in (or next to) the slot of one 38 ticks away:
+  // the near one fires on the first pass, the far one waits a turn.
+  auto near = probe("near"), far = probe("far");
+  far->arm(wheel, 1100ms);
+  near->arm(wheel, 76ms);
+  std::this_thread::sleep_for(150ms);
+  expect_fired_in_time(*near, 76ms);
+  expect(far->fired.load() == 0, "a deadline a turn away waits for its turn", "far");
+  std::this_thread::sleep_for(1100ms - (Clock::now() - far->armed_at) + kTick + kSlack);
+  expect_fired_in_time(*far, 1100ms);
+}
+
+void test_stall(TimerWheel& wheel, boost::asio::io_context& ioc) {
+  // The io_context stalls past a whole turn (512 ticks = 1024 ms).
+  auto h1 = probe("h1"), h2 = probe("h2"), h3 = probe("h3"), h4 = probe("h4");
+  h1->arm(wheel, 10ms);
+  h2->arm(wheel, 600ms);
+  h3->arm(wheel, 1200ms);  // 600 ticks: past the end of the wheel
+  h4->arm(wheel, 2500ms);
+  const auto stall_start = Clock::now();
+  boost::asio::post(ioc, [] { std::this_thread::sleep_for(1500ms); });
+  std::this_thread::sleep_for(1500ms + kTick + kSlack);
+
+  for (const Probe* p : {h1.get(), h2.get(), h3.get()}) {
+    expect(p->fired.load(std::memory_order_acquire) == 1, "came due during the stall", p->name);
+    expect(p->fired_at - stall_start >= 1500ms, "expired once the stall ended", p->name);
+  }
+  expect(h3->fired_at - h1->fired_at <= 5ms, "expired together in one batch", "h1..h3");
+  expect(h4->fired.load() == 0, "not yet due after the stall", "h4");
+
+  std::this_thread::sleep_for(2500ms - (Clock::now() - h4->armed_at) + kTick + kSlack);
+  expect_fired_in_time(*h4, 2500ms);
+}
+
+void test_wheels(TimerWheels& wheels) {
+  // Armed on one thread's wheel, re-armed from another: it moves, and
+  // only the second deadline fires; the first wheel no longer has it when
+  // the first deadline's slot comes round.
+  auto moved = probe("moved"), cancelled = probe("cancelled");
+  std::thread([&] {
+    moved->armed_at = Clock::now();
+    wheels.arm(*moved, 60ms);
+    cancelled->armed_at = Clock::now();
+    wheels.arm(*cancelled, 20ms);
+  }).join();
+  std::thread([&] {
+    moved->armed_at = Clock::now();
+    wheels.arm(*moved, 20ms);
+    wheels.cancel(*cancelled);
+  }).join();
+  std::this_thread::sleep_for(60ms + kTick + kSlack);
+  expect_fired_in_time(*moved, 20ms);
+  expect(cancelled->fired.load() == 0, "cancelled from another thread", "cancelled");
+  wheels.cancel(*moved);
+}
+
+} // namespace
+
+int main() {
+  boost::asio::io_context ioc(1);
+  auto guard = boost::asio::make_work_guard(ioc);
+  TimerWheel wheel(ioc, kTick, 512);
+  TimerWheels wheels(ioc, kTick, 2);
+  wheel.start();
+  wheels.start();
+  std::thread worker([&ioc] { ioc.run(); });
+
+  test_arm_cancel_rearm(wheel);
+  test_wrap(wheel);
+  test_stall(wheel, ioc);
+  test_wheels(wheels);
+
+  guard.reset();
+  ioc.stop();
+  worker.join();
+  if (failures > 0) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}
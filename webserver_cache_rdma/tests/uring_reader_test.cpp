@@ -0,0 +1,206 @@
+// UringReader round trips (built with ENABLE_IO_URING only). Files of
+// awkward sizes come back byte for byte when every READ is capped far
+// below their size, so each takes many rounds. A pipe fed a piece at a
+// time gives real short reads, each resubmitted for the rest; a file
+// truncated after it was opened ends in a short read and then EOF, which
+// must fail the read rather than hand back a zero-filled tail. Last the
+// backlog: two pipe reads that cannot finish hold both slots of a
+// two-entry ring, the reads behind them wait (and are not done on the
+// caller's thread), and all complete once the pipes are fed.
+#include "../src/headers/fs/uring_reader.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+using namespace std::chrono_literals;
+
+int failures = 0;
+
+void expect(bool ok, const char* what, const std::string& detail = {}) {
+  if (ok) return;
+  if (++failures <= 20) std::fprintf(stderr, "FAIL %s %s\n", what, detail.c_str());
+}
+
+std::vector<std::uint8_t> pattern(std::size_t size, unsigned seed) {
+  std::vector<std::uint8_t> v(size);
+  for (std::size_t i = 0; i < size; ++i) v[i] = static_cast<std::uint8_t>(i * 31 + seed);
+  return v;
+}
+
+void write_bytes(const std::string& path, const std::vector<std::uint8_t>& bytes) {
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+    .write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+}
+
+// The read end of a pipe, passed off as an opened file of `size` bytes.
+FileOpenResult open_pipe(int& write_fd, std::size_t size) {
+  int fds[2];
+  FileOpenResult r;
+  if (::pipe(fds) != 0) return r;
+  r.ok = true;
+  r.file = std::make_shared<OpenFile>(fds[0]);
+  r.size = size;
+  write_fd = fds[1];
+  return r;
+}
+
+bool feed(int fd, const std::uint8_t* p, std::size_t n) {
+  while (n > 0) {
+    const ssize_t w = ::write(fd, p, n);
+    if (w <= 0) return false;
+    p += w;
+    n -= static_cast<std::size_t>(w);
+  }
+  return true;
+}
+
+bool wait_for(const std::atomic<int>& n, int want, std::chrono::milliseconds limit = 5s) {
+  const auto until = std::chrono::steady_clock::now() + limit;
+  while (n.load() < want && std::chrono::steady_clock::now() < until) std::this_thread::sleep_for(1ms);
+  return n.load() >= want;
+}
+
+void test_round_trip(UringReader& reader, const std::string& dir) {
+  const std::size_t sizes[] = {0, 1, 4095, 4096, 4097, 65536 + 7, (1u << 20) + 13};
+  std::atomic<int> done{0};
+  std::vector<FileReadResult> results(std::size(sizes));
+  std::vector<std::time_t> mtimes(std::size(sizes));
+  for (std::size_t i = 0; i < std::size(sizes); ++i) {
+    const std::string path = dir + "/f" + std::to_string(i);
+    write_bytes(path, pattern(sizes[i], static_cast<unsigned>(i)));
+    FileOpenResult opened = open_file(path);
+    mtimes[i] = opened.last_modified;
+    reader.read(std::move(opened), [&results, &done, i](FileReadResult fr) {
+      results[i] = std::move(fr);
+      done.fetch_add(1);
+    });
+  }
+  expect(wait_for(done, static_cast<int>(std::size(sizes))), "every file read completes");
+  for (std::size_t i = 0; i < std::size(sizes); ++i) {
+    const std::string size = std::to_string(sizes[i]) + " bytes";
+    expect(results[i].ok && results[i].data == pattern(sizes[i], static_cast<unsigned>(i)), "bytes round trip", size);
+    expect(results[i].last_modified == mtimes[i], "mtime from the open", size);
+  }
+
+  FileOpenResult missing = open_file(dir + "/missing");
+  std::atomic<int> failed{0};
+  reader.read(std::move(missing), [&failed](FileReadResult fr) { failed.fetch_add(!fr.ok && !fr.error.empty()); });
+  expect(wait_for(failed, 1), "a failed open is reported, not read");
+}
+
+void test_short_reads(UringReader& reader, const std::string& dir) {
+  // Real short reads: each READ returns what the pipe holds so far.
+  const auto bytes = pattern(40000, 7);
+  int wfd = -1;
+  FileOpenResult opened = open_pipe(wfd, bytes.size());
+  std::atomic<int> done{0};
+  FileReadResult result;
+  reader.read(std::move(opened), [&](FileReadResult fr) {
+    result = std::move(fr);
+    done.fetch_add(1);
+  });
+  for (std::size_t off = 0; off < bytes.size(); off += 10000) {
+    std::this_thread::sleep_for(20ms);
+    expect(done.load() == 0, "not finished before its last byte");
+    feed(wfd, bytes.data() + off, 10000);
+  }
+  expect(wait_for(done, 1) && result.ok && result.data == bytes, "pipe read in pieces round trips");
+  ::close(wfd);
+
+  // Shrunk after the open: a short read, then EOF.
+  const std::string path = dir + "/shrinks";
+  write_bytes(path, pattern(300000, 3));
+  FileOpenResult shrunk = open_file(path);
+  std::filesystem::resize_file(path, 100000);
+  std::atomic<int> shrunk_done{0};
+  FileReadResult shrunk_result;
+  reader.read(std::move(shrunk), [&](FileReadResult fr) {
+    shrunk_result = std::move(fr);
+    shrunk_done.fetch_add(1);
+  });
+  expect(wait_for(shrunk_done, 1), "a shrunk file's read completes");
+  expect(!shrunk_result.ok && shrunk_result.data.empty() && !shrunk_result.error.empty(), "and fails");
+}
+
+void test_backlog(UringReader& reader, const std::string& dir) {
+  // Both slots of the ring held by reads that wait on their pipes.
+  const auto piped = pattern(5000, 11);
+  int wfd[2] = {-1, -1};
+  std::atomic<int> pipes_done{0};
+  for (int& fd : wfd) {
+    reader.read(open_pipe(fd, piped.size()), [&](FileReadResult fr) {
+      expect(fr.ok && fr.data == piped, "pipe read behind the backlog");
+      pipes_done.fetch_add(1);
+    });
+  }
+
+  constexpr int kQueued = 64;
+  const auto bytes = pattern(20000, 5);
+  const std::string path = dir + "/queued";
+  write_bytes(path, bytes);
+  const auto caller = std::this_thread::get_id();
+  std::atomic<int> done{0}, good{0}, on_caller{0};
+  for (int i = 0; i < kQueued; ++i) {
+    reader.read(open_file(path), [&](FileReadResult fr) {
+      good.fetch_add(fr.ok && fr.data == bytes);
+      on_caller.fetch_add(std::this_thread::get_id() == caller);
+      done.fetch_add(1);
+    });
+  }
+  std::this_thread::sleep_for(100ms);
+  expect(done.load() == 0, "reads wait while the ring is full", std::to_string(done.load()) + " done");
+
+  for (int fd : wfd) feed(fd, piped.data(), piped.size());
+  expect(wait_for(pipes_done, 2), "the pipe reads finish once fed");
+  expect(wait_for(done, kQueued), "the backlog drains", std::to_string(done.load()) + " done");
+  expect(good.load() == kQueued, "every queued read round trips");
+  expect(on_caller.load() == 0, "none read on the caller's thread");
+  for (int fd : wfd) ::close(fd);
+}
+
+} // namespace
+
+int main() {
+  char dir[] = "/tmp/uring_reader_test.XXXXXX";
+  if (!::mkdtemp(dir)) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  boost::asio::io_context ioc(1);
+  auto guard = boost::asio::make_work_guard(ioc);
+  std::string err;
+  // Two entries, and every READ capped at 4 KiB.
+  auto reader = UringReader::create(ioc, 2, err, 4096);
+  if (!reader) {
+    std::fprintf(stderr, "io_uring unavailable (%s); skipping\n", err.c_str());
+    std::filesystem::remove_all(dir);
+    return 0;
+  }
+  std::thread worker([&ioc] { ioc.run(); });
+
+  test_round_trip(*reader, dir);
+  test_short_reads(*reader, dir);
+  test_backlog(*reader, dir);
+
+  guard.reset();
+  ioc.stop();
+  worker.join();
+  reader.reset();
+  std::filesystem::remove_all(dir);
+  if (failures > 0) {
+    std::fprintf(stderr, "%d failures\n", failures);
+    return 1;
+  }
+  std::printf("ok\n");
+  return 0;
+}